@@ -0,0 +1,225 @@
+#ifndef _ASYNC_C_
+#define _ASYNC_C_
+
+#include "async.h"
+#include <stdlib.h>     /* malloc(), free() */
+#include <time.h>       /* clock_gettime() */
+#include <pthread.h>    /* pthread_*() */
+
+
+/* Request of move. Player works in a thread of its own on a private copy of */
+/* board, so caller's board may be used meanwhile.                           */
+struct move_request_struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;       /* Signalled when move is ready */
+    player_t* player;
+    conn4_state* board;         /* Private copy of board */
+    move_ctl ctl;               /* Limits of request */
+    int done;                   /* Flag: move is ready */
+    int column;                 /* Chosen move, -1 if none */
+    double finished;            /* Monotonic time when move was ready */
+};
+
+
+/* Function: monotonic_time                                                   */
+/* Returns:                                                                   */
+/*   Current value of monotonic clock in seconds.                             */
+double monotonic_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* Function: move_cancelled                                                   */
+/*   Checks if request is cancelled (by other thread).                        */
+/* Parameter(s):                                                              */
+/*   ctl - limits of request, or NULL if there are none                       */
+/* Returns:                                                                   */
+/*   1 if request is cancelled, 0 otherwise.                                  */
+int move_cancelled(const move_ctl* ctl) {
+    return (ctl != NULL && __atomic_load_n(&ctl->cancelled, __ATOMIC_ACQUIRE));
+}
+
+
+/* Function: move_stopped                                                     */
+/*   Checks if player should stop thinking.                                   */
+/* Parameter(s):                                                              */
+/*   ctl - limits of request, or NULL if there are none                       */
+/* Returns:                                                                   */
+/*   1 if request is cancelled or its deadline has passed, 0 otherwise.       */
+int move_stopped(const move_ctl* ctl) {
+    return move_stopped_before(ctl, 0.0);
+}
+
+
+/* Function: move_stopped_before                                              */
+/*   Checks if player should stop thinking to have its move ready before      */
+/*   deadline (move made at deadline is late, see await_move()).              */
+/* Parameter(s):                                                              */
+/*   ctl    - limits of request, or NULL if there are none                    */
+/*   margin - time in seconds that player needs to finish its move            */
+/* Returns:                                                                   */
+/*   1 if request is cancelled or less than margin is left till deadline, 0  */
+/*   otherwise.                                                               */
+int move_stopped_before(const move_ctl* ctl, double margin) {
+    if (ctl == NULL) {
+        return 0;
+    }
+    return (move_cancelled(ctl) || (ctl->deadline > 0.0 &&
+            monotonic_time() + margin >= ctl->deadline));
+}
+
+
+/* Function: run_request                                                      */
+/*   Thread function that asks player for move and signals when it is ready.  */
+/* Parameter(s):                                                              */
+/*   arg - request structure                                                  */
+static void* run_request(void* arg) {
+    move_request* request = arg;
+    int column;
+
+    if (request->player->get_move_timed != NULL) {
+        column = request->player->get_move_timed(request->board,
+                &request->ctl);
+    } else {
+        column = request->player->get_move(request->board);
+    }
+
+    pthread_mutex_lock(&request->lock);
+    request->column = column;
+    request->finished = monotonic_time();
+    request->done = 1;
+    pthread_cond_broadcast(&request->ready);
+    pthread_mutex_unlock(&request->lock);
+    return NULL;
+}
+
+
+/* Function: request_move                                                     */
+/*   Starts request of player's move. Function returns at once; the move is   */
+/*   obtained by poll_move() or await_move().                                 */
+/* Parameter(s):                                                              */
+/*   player  - player to move                                                 */
+/*   board   - board structure (copied)                                       */
+/*   seconds - time limit, or 0 if there is none                              */
+/* Returns:                                                                   */
+/*   New request, or NULL if it can't be started.                             */
+move_request* request_move(player_t* player, conn4_state* board,
+        double seconds) {
+    move_request* request = malloc(sizeof(*request));
+
+    if (request == NULL) {
+        return NULL;
+    }
+    request->board = create_board();
+    if (request->board == NULL) {
+        free(request);
+        return NULL;
+    }
+    board_copy(request->board, board);
+    request->player = player;
+    request->ctl.deadline = (seconds > 0.0 ? monotonic_time() + seconds : 0.0);
+    request->ctl.cancelled = 0;
+    request->done = 0;
+    request->column = -1;
+    request->finished = 0.0;
+    pthread_mutex_init(&request->lock, NULL);
+    pthread_cond_init(&request->ready, NULL);
+    if (pthread_create(&request->thread, NULL, run_request, request) != 0) {
+        pthread_mutex_destroy(&request->lock);
+        pthread_cond_destroy(&request->ready);
+        destruct_board(request->board);
+        free(request);
+        return NULL;
+    }
+    return request;
+}
+
+
+/* Function: request_result                                                   */
+/*   Classifies result of finished request. Move made at or after deadline  */
+/*   is late and counts as timeout, like no move at all.                      */
+/* Parameter(s):                                                              */
+/*   request - finished request (its lock is held)                            */
+/* Returns:                                                                   */
+/*   Chosen move, MOVE_TIMEOUT or MOVE_FAILED.                                */
+static int request_result(const move_request* request) {
+    if (request->ctl.deadline > 0.0 &&
+            request->finished >= request->ctl.deadline) {
+        return MOVE_TIMEOUT;
+    }
+    return (request->column < 0 ? MOVE_FAILED : request->column);
+}
+
+
+/* Function: poll_move                                                        */
+/*   Checks if move is ready without blocking.                                */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+/*   column  - where chosen move (or MOVE_TIMEOUT or MOVE_FAILED, see        */
+/*             await_move()) will be written if ready                         */
+/* Returns:                                                                   */
+/*   1 if move is ready, 0 otherwise.                                         */
+int poll_move(move_request* request, int* column) {
+    int done;
+
+    pthread_mutex_lock(&request->lock);
+    done = request->done;
+    if (done) {
+        *column = request_result(request);
+    }
+    pthread_mutex_unlock(&request->lock);
+    return done;
+}
+
+
+/* Function: await_move                                                       */
+/*   Waits until move is ready.                                               */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+/* Returns:                                                                   */
+/*   Chosen move; MOVE_TIMEOUT if player didn't move before deadline (move   */
+/*   made too late is rejected); MOVE_FAILED if player gave up before it     */
+/*   (e.g. end of input) or request was cancelled.                            */
+int await_move(move_request* request) {
+    int column;
+
+    pthread_mutex_lock(&request->lock);
+    while (!request->done) {
+        pthread_cond_wait(&request->ready, &request->lock);
+    }
+    column = request_result(request);
+    pthread_mutex_unlock(&request->lock);
+    return column;
+}
+
+
+/* Function: cancel_move                                                      */
+/*   Cancels request. Player notices it at its next check and stops.         */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+void cancel_move(move_request* request) {
+    __atomic_store_n(&request->ctl.cancelled, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+
+/* Function: release_move                                                     */
+/*   Waits for player's thread to finish and releases request.                */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+void release_move(move_request* request) {
+    if (request != NULL) {
+        pthread_join(request->thread, NULL);
+        pthread_mutex_destroy(&request->lock);
+        pthread_cond_destroy(&request->ready);
+        destruct_board(request->board);
+        free(request);
+    }
+    return;
+}
+
+
+#endif /* _ASYNC_C_ */
@@ -0,0 +1,50 @@
+#ifndef _ASYNC_H_
+#define _ASYNC_H_
+
+#include "player.h"
+
+
+/* Asynchronous request of player's move                                      */
+typedef struct move_request_struct move_request;
+
+/* Time in seconds reserved by players before deadline of request, so that   */
+/* their move is published in time. Search of computer adds to it the longest */
+/* pause it has measured between its checks of time (thread may be            */
+/* preempted), and resumable search adds its last quantum and the last wait   */
+/* for quantum.                                                               */
+#define DEADLINE_MARGIN 0.01
+
+/* Results of request besides chosen column (see await_move())               */
+#define MOVE_FAILED     (-1)    /* Player gave up (input failure, cancel) */
+#define MOVE_TIMEOUT    (-2)    /* Player didn't move before deadline */
+
+/* Current value of monotonic clock in seconds.                               */
+double monotonic_time(void);
+
+/* Checks if request is cancelled.                                            */
+int move_cancelled(const move_ctl* ctl);
+
+/* Checks if request is cancelled or its deadline has passed.                 */
+int move_stopped(const move_ctl* ctl);
+
+/* Checks if request is cancelled or less than margin is left till deadline.  */
+int move_stopped_before(const move_ctl* ctl, double margin);
+
+/* Starts request of player's move with selected time limit.                  */
+move_request* request_move(player_t* player, conn4_state* board,
+        double seconds);
+
+/* Checks if move is ready without blocking.                                  */
+int poll_move(move_request* request, int* column);
+
+/* Waits until move is ready.                                                 */
+int await_move(move_request* request);
+
+/* Cancels request; player stops as soon as possible.                         */
+void cancel_move(move_request* request);
+
+/* Waits for player to stop and releases request.                             */
+void release_move(move_request* request);
+
+
+#endif /* _ASYNC_H_ */
@@ -0,0 +1,254 @@
+#ifndef _CACHE_C_
+#define _CACHE_C_
+
+#include "cache.h"
+#include <string.h>     /* memcpy(), memcmp() */
+#include <fcntl.h>      /* open(), fcntl() */
+#include <unistd.h>     /* close(), ftruncate(), pwrite() */
+#include <sys/mman.h>   /* mmap(), munmap() */
+#include <sys/stat.h>   /* fstat() */
+#include <pthread.h>    /* pthread_mutex_lock(), pthread_mutex_unlock() */
+
+
+/* Signature of cache file                                                    */
+#define CACHE_MAGIC     "CONN4CA1"
+/* Number of entries in one bucket. Key is stored in any entry of bucket.    */
+#define BUCKET_SIZE     4
+
+
+/* Header of cache file                                                       */
+typedef struct {
+    char magic[8];              /* CACHE_MAGIC */
+    unsigned int entries;       /* Number of entries (power of two) */
+    unsigned int generation;    /* Incremented by every process that opens */
+} cache_header;
+
+/* Entry of cache. Entries are written and read without locks by two 64-bit  */
+/* words: data and key xor data. A reader accepts entry only if xor of two   */
+/* words gives the key, so entry torn by concurrent writer is never used.    */
+typedef struct {
+    unsigned long long check;   /* key ^ data */
+    unsigned long long data;    /* Packed score, move, depth and generation */
+} cache_entry;
+
+
+/* Mapped cache file, or NULL if cache is closed                              */
+static cache_header* header = NULL;
+static cache_entry* table = NULL;
+static size_t mapped = 0;
+static int fd = -1;
+/* Generation of this process (low 8 bits)                                    */
+static unsigned int generation = 0;
+/* Record locks of cache file serialize processes but not threads of one      */
+/* process, so writers of this process are serialized by mutex as well        */
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* Macros: Packing of data word: score (32 bits), move (16 bits), depth      */
+/* (8 bits) and generation (8 bits)                                           */
+#define DATA_DEPTH(data)        ((unsigned int)((data) >> 8) & 0xff)
+#define DATA_GENERATION(data)   ((unsigned int)(data) & 0xff)
+#define DATA_MOVE(data)         ((int)((data) >> 16) & 0xffff)
+#define DATA_SCORE(data)        ((unsigned int)((data) >> 32))
+
+
+/* Function: lock_file                                                        */
+/*   Locks or unlocks cache file for writing.                                 */
+/* Parameter(s):                                                              */
+/*   type - F_WRLCK to lock, F_UNLCK to unlock                                */
+static void lock_file(short type) {
+    struct flock lock;
+
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = 0;
+    fcntl(fd, F_SETLKW, &lock);
+    return;
+}
+
+
+/* Function: cache_open                                                       */
+/*   Opens cache file and maps it to memory. If the file doesn't exist, it is */
+/*   created with selected number of entries; size of existing file is never  */
+/*   changed, so it bounds memory and disk used by cache.                     */
+/* Parameter(s):                                                              */
+/*   filename - name of cache file                                            */
+/*   entries  - number of entries of new file (power of two)                  */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if cache can't be used.                               */
+int cache_open(const char* filename, unsigned int entries) {
+    struct stat st;
+    cache_header init;
+    void* map;
+
+    cache_close();
+    fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+    lock_file(F_WRLCK);
+    if (fstat(fd, &st) == 0 && st.st_size == 0) {
+        /* New file: write header, the rest of file is filled with zeros */
+        memset(&init, 0, sizeof(init));
+        memcpy(init.magic, CACHE_MAGIC, sizeof(init.magic));
+        init.entries = entries;
+        if (ftruncate(fd, sizeof(init) + (off_t)entries * sizeof(*table)) ||
+                pwrite(fd, &init, sizeof(init), 0) != sizeof(init)) {
+            lock_file(F_UNLCK);
+            cache_close();
+            return 0;
+        }
+        st.st_size = sizeof(init) + (off_t)entries * sizeof(*table);
+    }
+    map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        lock_file(F_UNLCK);
+        cache_close();
+        return 0;
+    }
+    header = map;
+    mapped = st.st_size;
+    table = (cache_entry*)(header + 1);
+    /* Check that file is a cache file of consistent size */
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+            header->entries < BUCKET_SIZE ||
+            (header->entries & (header->entries - 1)) != 0 ||
+            mapped != sizeof(*header) + header->entries * sizeof(*table)) {
+        lock_file(F_UNLCK);
+        cache_close();
+        return 0;
+    }
+    /* Generation 0 is skipped, so that valid data word is never zero */
+    generation = ++(header->generation) & 0xff;
+    if (generation == 0) {
+        generation = ++(header->generation) & 0xff;
+    }
+    lock_file(F_UNLCK);
+    return 1;
+}
+
+
+/* Function: cache_close                                                      */
+/*   Unmaps and closes cache file.                                            */
+void cache_close(void) {
+    if (header != NULL) {
+        munmap(header, mapped);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    header = NULL;
+    table = NULL;
+    fd = -1;
+    return;
+}
+
+
+/* Function: cache_key                                                        */
+/*   Computes key of position on board. Dimensions are mixed in, so that     */
+/*   positions of boards of different sizes don't share entries.             */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   Key of position.                                                         */
+unsigned long long cache_key(conn4_state* board) {
+    unsigned long long key = board_hash(board);
+    key ^= ((unsigned long long)get_cols() << 48) ^
+            ((unsigned long long)get_rows() << 32);
+    /* Final mixing (from MurmurHash3) spreads dimensions over all bits */
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+
+/* Function: cache_probe                                                      */
+/*   Looks up result of search for position. Reading needs no locks.          */
+/* Parameter(s):                                                              */
+/*   key    - key of position                                                 */
+/*   result - where result will be written if found                           */
+/* Returns:                                                                   */
+/*   1 if found, 0 otherwise.                                                 */
+int cache_probe(unsigned long long key, cache_result* result) {
+    unsigned int i, score;
+    unsigned long long check, data;
+    cache_entry* bucket;
+
+    if (table == NULL) {
+        return 0;
+    }
+    bucket = table + (key & (header->entries - 1) & ~(BUCKET_SIZE - 1ULL));
+    for (i = 0; i < BUCKET_SIZE; ++i) {
+        check = __atomic_load_n(&bucket[i].check, __ATOMIC_ACQUIRE);
+        data = __atomic_load_n(&bucket[i].data, __ATOMIC_ACQUIRE);
+        if ((check ^ data) == key && data != 0) {
+            score = DATA_SCORE(data);
+            memcpy(&result->score, &score, sizeof(result->score));
+            result->move = DATA_MOVE(data);
+            result->depth = DATA_DEPTH(data);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/* Function: cache_store                                                      */
+/*   Stores result of search for position, unless cache already has deeper   */
+/*   result of it. Writers are serialized by mutex (threads) and by lock of   */
+/*   cache file (processes). If bucket is full, entry written by the oldest  */
+/*   process is evicted, and of those the one with the lowest depth.          */
+/* Parameter(s):                                                              */
+/*   key    - key of position                                                 */
+/*   result - result of search                                                */
+void cache_store(unsigned long long key, const cache_result* result) {
+    unsigned int i, victim = 0, score;
+    unsigned int age, victim_age = 0;
+    unsigned long long data;
+    cache_entry* bucket;
+
+    if (table == NULL) {
+        return;
+    }
+    memcpy(&score, &result->score, sizeof(score));
+    data = ((unsigned long long)score << 32) |
+            ((unsigned long long)(result->move & 0xffff) << 16) |
+            ((result->depth > 0xff ? 0xff : result->depth) << 8) | generation;
+
+    pthread_mutex_lock(&write_lock);
+    lock_file(F_WRLCK);
+    bucket = table + (key & (header->entries - 1) & ~(BUCKET_SIZE - 1ULL));
+    for (i = 0; i < BUCKET_SIZE; ++i) {
+        if (bucket[i].data != 0 &&
+                (bucket[i].check ^ bucket[i].data) == key &&
+                DATA_DEPTH(bucket[i].data) > DATA_DEPTH(data)) {
+            /* Deeper result of the same position is kept */
+            lock_file(F_UNLCK);
+            pthread_mutex_unlock(&write_lock);
+            return;
+        }
+        if (bucket[i].data == 0 || (bucket[i].check ^ bucket[i].data) == key) {
+            victim = i;
+            break;  /* Free entry or the same position */
+        }
+        /* Age is distance in generations; lower depth breaks ties */
+        age = ((generation - DATA_GENERATION(bucket[i].data)) & 0xff) * 256 +
+                (0xff - DATA_DEPTH(bucket[i].data));
+        if (age >= victim_age) {
+            victim_age = age;
+            victim = i;
+        }
+    }
+    /* Invalidate entry first, so readers never match half-written entry */
+    __atomic_store_n(&bucket[victim].data, 0ULL, __ATOMIC_RELEASE);
+    __atomic_store_n(&bucket[victim].check, key ^ data, __ATOMIC_RELEASE);
+    __atomic_store_n(&bucket[victim].data, data, __ATOMIC_RELEASE);
+    lock_file(F_UNLCK);
+    pthread_mutex_unlock(&write_lock);
+    return;
+}
+
+
+#endif /* _CACHE_C_ */
@@ -0,0 +1,35 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include "conn4.h"
+
+
+#define CACHE_FILENAME  "analysis.cache"
+/* Default number of entries of cache file (16 bytes each)                   */
+#define CACHE_ENTRIES   (1U << 20)
+
+
+/* Result of search remembered by cache                                       */
+typedef struct {
+    unsigned int depth; /* Depth of search */
+    float score;        /* Estimation of best move */
+    int move;           /* Best move */
+} cache_result;
+
+/* Opens (or creates) cache file shared by all processes.                     */
+int cache_open(const char* filename, unsigned int entries);
+
+/* Closes cache file.                                                         */
+void cache_close(void);
+
+/* Computes key of position on board, including dimensions of board.        */
+unsigned long long cache_key(conn4_state* board);
+
+/* Looks up result of search for position.                                    */
+int cache_probe(unsigned long long key, cache_result* result);
+
+/* Stores result of search for position.                                      */
+void cache_store(unsigned long long key, const cache_result* result);
+
+
+#endif /* _CACHE_H_ */
@@ -2,8 +2,18 @@
 #define _COMPUTER_C_
 
 #include "computer.h"
+#include "threats.h"
+#include "kernels.h"
+#include "engine.h"
+#include "cache.h"
+#include "async.h"
+#include "tablebase.h"
+#include "pns.h"
+#include "trace.h"
+#include "nnue.h"
 #include <time.h>       /* time(), clock() */
-#include <stdlib.h>     /* srand(), rand() */
+#include <stdlib.h>     /* srand(), rand(), malloc(), free(), qsort() */
+#include <string.h>     /* memcpy() */
 #include <stdio.h>
 
 
@@ -24,6 +34,156 @@
 /* Macros: Determines greater value of two                                    */
 #define MAX(a,b)    ((a) > (b) ? (a) : (b))
 
+/* Number of searched positions between checks of limits of request           */
+#define CHECK_INTERVAL  4096
+
+/* Radius (in columns) around placed disks where moves are searched on wide */
+/* boards. Disk put further away can't join any alignment with disks        */
+/* already on board.                                                          */
+#define LOCAL_RADIUS    (COUNT_TO_WIN - 1)
+
+
+/* Frame of resumable search: state of one call of eval_rec() kept on        */
+/* explicit stack, so search can be suspended at any position.               */
+typedef struct {
+    unsigned int i;     /* Index of move being searched in order of search */
+    unsigned int move;  /* Move being searched */
+    int depth;          /* Maximal depth of search */
+    int forced;         /* Flag: move is necessary (see force_move()) */
+    float best;         /* The best estimation for opponent's move */
+} search_frame;
+
+/* Resumable search of computer's move. It is iterative deepening of         */
+/* computer_move_timed() with recursion of eval_rec() unrolled into explicit */
+/* stack, but without its proof-number pre-pass (which can't be split into   */
+/* quanta), so proven results deeper than search aren't found and proven     */
+/* loss isn't met by the longest resisting move. Between steps the search    */
+/* holds no thread.                                                           */
+struct search_task_struct {
+    conn4_state* board;         /* Private copy of board */
+    const move_ctl* ctl;        /* Limits of request, or NULL */
+    double deadline;            /* Deadline of search (monotonic clock) */
+    double stop;                /* Deadline less DEADLINE_MARGIN */
+    double step_time;           /* Duration of the last quantum */
+    double step_end;            /* End of the last quantum, or 0 */
+    double wait;                /* Wait between the last two quanta */
+    double iter_start;          /* Start of current iteration */
+    double iter_time;           /* Duration of the last complete iteration */
+    search_frame* stack;        /* Frames of eval_rec() calls */
+    unsigned int sp;            /* Number of frames on stack */
+    int call;                   /* Flag: call of eval_rec() is pending */
+    unsigned int call_column;   /* Column of last move of pending call */
+    int call_depth;             /* Depth of pending call */
+    int ret;                    /* Flag: return from eval_rec() is pending */
+    float value;                /* Value returned by eval_rec() */
+    unsigned int depth;         /* Maximal depth of current iteration */
+    unsigned int root_i;        /* Index of root move being searched */
+    unsigned int root_move;     /* Root move being searched */
+    int root_column;            /* Best root move of current iteration */
+    float root_best;            /* Its estimation */
+    int column;                 /* Move of the last complete iteration */
+    float score;                /* Its estimation */
+    int forced;                 /* Flag: move is necessary */
+    int done;                   /* Flag: search is finished */
+    unsigned long long key;     /* Key of position in analysis cache */
+};
+
+
+/* Limits of move request served by search running in this thread. Several   */
+/* requests may be searched concurrently (see async.h), so state is per      */
+/* thread.                                                                    */
+static THREAD_LOCAL const move_ctl* search_ctl = NULL;
+static THREAD_LOCAL unsigned int search_nodes = 0;
+static THREAD_LOCAL int search_aborted = 0;
+/* Time of the last check of limits and the longest time between checks     */
+static THREAD_LOCAL double search_checked = 0.0;
+static THREAD_LOCAL double search_gap = 0.0;
+
+/* Principal variations collected by eval_rec() for computer_analyse(). Row  */
+/* of table is the best line from position at that ply (triangular table).   */
+typedef struct {
+    unsigned int root;                  /* Moves on board at root */
+    unsigned int length[MAX_PV + 1];    /* Lengths of lines */
+    int moves[MAX_PV + 1][MAX_PV];      /* Lines of moves */
+} pv_table;
+
+/* Table of analysis running in this thread, or NULL                          */
+static THREAD_LOCAL pv_table* search_pv = NULL;
+
+
+/* Function: search_stopped                                                   */
+/*   Checks (every CHECK_INTERVAL calls) if search of current request should  */
+/*   be aborted. Search stops DEADLINE_MARGIN before deadline, and earlier by */
+/*   the longest time between two checks, since the next check may come that */
+/*   late. Once aborted, search stays aborted till the next request.          */
+/* Returns:                                                                   */
+/*   1 if search is aborted, 0 otherwise.                                     */
+static int search_stopped(void) {
+    double now;
+
+    if (search_ctl != NULL && !search_aborted &&
+            ++search_nodes % CHECK_INTERVAL == 0) {
+        now = monotonic_time();
+        if (search_checked > 0.0 && now - search_checked > search_gap) {
+            search_gap = now - search_checked;
+        }
+        search_checked = now;
+        search_aborted = move_stopped_before(search_ctl,
+                DEADLINE_MARGIN + search_gap);
+    }
+    return search_aborted;
+}
+
+
+/* Function: pv_clear                                                         */
+/*   Empties principal variation from position on board (search ends here).   */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+static void pv_clear(conn4_state* board) {
+    if (search_pv != NULL && board->moves - search_pv->root <= MAX_PV) {
+        search_pv->length[board->moves - search_pv->root] = 0;
+    }
+    return;
+}
+
+
+/* Function: pv_update                                                        */
+/*   Makes move (already made on board) followed by the best line from its    */
+/*   position the best line of the previous ply.                              */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   move  - column of the last move                                          */
+static void pv_update(conn4_state* board, int move) {
+    unsigned int i, ply;
+
+    if (search_pv == NULL || board->moves - search_pv->root > MAX_PV) {
+        return;
+    }
+    ply = board->moves - search_pv->root - 1;
+    search_pv->moves[ply][0] = move;
+    for (i = 0; i < search_pv->length[ply + 1] && i + 1 < MAX_PV; ++i) {
+        search_pv->moves[ply][i + 1] = search_pv->moves[ply + 1][i];
+    }
+    search_pv->length[ply] = i + 1;
+    return;
+}
+
+
+/* Function: mask_moves                                                       */
+/*   Counts columns of mask of moves.                                         */
+/* Parameter(s):                                                              */
+/*   mask - columns of moves (bit per column)                                 */
+/*   move - where the rightmost column will be written (if mask isn't empty)  */
+/* Returns:                                                                   */
+/*   Number of moves.                                                         */
+static int mask_moves(unsigned long long mask, int* move) {
+    if (mask == 0) {
+        return 0;
+    }
+    *move = 63 - __builtin_clzll(mask);
+    return __builtin_popcountll(mask);
+}
+
 
 /* Function: count_win_moves                                                  */
 /*   Searches for moves that yields winning alignment of disks immediately.   */
@@ -36,7 +196,12 @@
 int count_win_moves(conn4_state* board, char disk, int* move) {
     int count = 0;
     int column;
+    win_masks masks;
 
+    if (get_cols() <= WIN_MASK_COLUMNS) {
+        get_win_masks(board, &masks);
+        return mask_moves(masks.wins[disk == CELL_O], move);
+    }
     for (column = 0; column < get_cols(); ++column) {
         if (set_cell(board, column, disk)) {
             if (check_win(board, column)) {
@@ -51,6 +216,36 @@ int count_win_moves(conn4_state* board, char disk, int* move) {
 }
 
 
+/* Function: is_local                                                         */
+/*   Checks if move should be searched. On boards wider than MAX_COLUMNS only */
+/*   columns within LOCAL_RADIUS of nonempty columns are searched, so that    */
+/*   branching factor doesn't grow with width of the board.                   */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of move                                                  */
+/* Returns:                                                                   */
+/*   1 if move should be searched, 0 otherwise.                               */
+int is_local(conn4_state* board, unsigned int column) {
+    unsigned int c, last;
+
+    if (get_cols() <= MAX_COLUMNS) {
+        return 1;
+    }
+    if (board->moves == 0) {
+        return (column == get_cols() / 2);
+    }
+    last = (column + LOCAL_RADIUS < get_cols()
+            ? column + LOCAL_RADIUS : get_cols() - 1);
+    for (c = (column > LOCAL_RADIUS ? column - LOCAL_RADIUS : 0);
+            c <= last; ++c) {
+        if (get_height(board, c) > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
 /* Function: quick_win                                                        */
 /*   Evaluates position on board and checks if it is possible to win in just  */
 /*   one or two moves. It is assumed that current player placed disk in       */
@@ -64,20 +259,48 @@ int count_win_moves(conn4_state* board, char disk, int* move) {
 /*   Estimation is returned via pointer only if result of check is positive.  */
 int quick_win(conn4_state* board, unsigned int column, float* est) {
     int count;      /* Number of winning moves */
+    int lost;       /* Number of winning moves of opponent */
     int move;       /* Winning move */
     int ret = 1;    /* Result of this function */
+    int threats;    /* Flag indicating that threats are known */
+    unsigned int row;
     char disk = PREV_PLAYER(board);     /* Disk type of current player */
     char opponent = CURR_PLAYER(board); /* Disk type of opponent */
+    win_masks masks;
 
     if (check_win(board, column)) {
         *est = WIN; /* Winning alignment already on board! */
-    } else if (board->moves == get_size()) {
+        return 1;
+    }
+    if (board->moves == get_size()) {
         *est = DRAW;/* Board is full and noone won */
-    } else if (count_win_moves(board, opponent, &move) > 0) {
+        return 1;
+    }
+    /* Winning moves of both players are found by one query of board */
+    if (get_cols() <= WIN_MASK_COLUMNS) {
+        threats = get_win_masks(board, &masks);
+        lost = mask_moves(masks.wins[opponent == CELL_O], &move);
+        count = mask_moves(masks.wins[disk == CELL_O], &move);
+    } else {
+        threats = 0;
+        lost = count_win_moves(board, opponent, &move);
+        count = count_win_moves(board, disk, &move);
+    }
+
+    if (lost > 0) {
         *est = LOSS;/* Opponent wins in next move */
-    } else if ((count = count_win_moves(board, disk, &move)) > 1) {
+    } else if (count > 1) {
         *est = WIN; /* Player has at least two different winning moves, hence */
                     /* opponent can't block all winning moves - it's a win!   */
+    } else if (count == 1 && threats) {
+        /* Opponent blocks player's only winning move; player wins anyway if */
+        /* the cell right above is a threat too.                             */
+        row = get_height(board, move) + 1;
+        ret = (row < get_rows() && ((masks.threats[disk == CELL_O] >>
+                (move * (get_rows() + 1) + row)) & 1));
+        if (ret) {
+            *est = WIN;
+        }
     } else if (count == 1) {
         ret = 0;
         /* Assume that opponent will block player's only winning move.        */
@@ -99,131 +322,116 @@ int quick_win(conn4_state* board, unsigned int column, float* est) {
 }
 
 
-/* Function: win_alignment_right                                              */
-/*   Checks if selected cell completes winning alignment to the right if      */
-/*   player's disk is put at this cell.                                       */
+/* Function: open_alignment                                                   */
+/*   Checks if cell completes winning alignment to one side (horizontally or  */
+/*   diagonally) if player's disk is put at this cell.                        */
 /* Parameter(s):                                                              */
 /*   board - board structure                                                  */
 /*   col   - selected column                                                  */
 /*   row   - selected row                                                     */
 /*   disk  - player's disk type                                               */
+/*   dir   - side: -1 to the left, +1 to the right                            */
 /* Returns:                                                                   */
-/*   1 if cell completes winning alignment to the right, 0 otherwise.         */
-unsigned int win_alignment_right(conn4_state* board, unsigned int col,
-        unsigned int row, char disk) {
-    unsigned int count;
+/*   1 if cell completes winning alignment, 0 otherwise.                      */
+static unsigned int open_alignment(conn4_state* board, int col, int row,
+        char disk, int dir) {
+    static const int rise[3] = {0, +1, -1};
+    int count, c, r;
+    unsigned int i;
 
-    if (col + COUNT_TO_WIN > get_cols()) {
-        return 0;   /* Not enough space to right to make winning alignment */
-    }
-    /* Check horizontal alignment */
-    for (count = 1; count < COUNT_TO_WIN; ++count) {
-        if (get_cell(board, col + count, row) != disk) {
-            break;
-        }
-    }
-    if (count == COUNT_TO_WIN) {
-        return 1;   /* Horizontal win alignment of disks */
-    }
-    /* Check diagonal alignment (diagonal rises up) */
-    if (row + COUNT_TO_WIN <= get_rows()) {
+    for (i = 0; i < 3; ++i) {
         for (count = 1; count < COUNT_TO_WIN; ++count) {
-            if (get_cell(board, col + count, row + count) != disk) {
+            c = col + dir * count;
+            r = row + rise[i] * count;
+            if (c < 0 || c >= (int)get_cols() || r < 0 ||
+                    r >= (int)get_rows() || get_cell(board, c, r) != disk) {
                 break;
             }
         }
         if (count == COUNT_TO_WIN) {
-            return 1;   /* Rising diagonal win alignment of disks */
+            return 1;
         }
     }
-    /* Check diagonal alignment (diagonal falls down) */
-    if (row + 1 >= COUNT_TO_WIN) {
-        for (count = 1; count < COUNT_TO_WIN; ++count) {
-            if (get_cell(board, col + count, row - count) != disk) {
-                break;
-            }
-        }
-        if (count == COUNT_TO_WIN) {
-            return 1;   /* Rising diagonal win alignment of disks */
-        }
-    }
-    /* Chosen cell doesn't make any winning alignment to the right */
     return 0;
 }
 
 
-/* Function: win_alignment_left                                               */
-/*   Checks if selected cell completes winning alignment to the left if       */
-/*   player's disk is put at this cell.                                       */
+/* Function: count_open_scan                                                  */
+/*   Counts open cells (see count_open_pos()) cell by cell. Used if grid of   */
+/*   board too large for stack (see GRID_FITS()) can't be allocated.          */
 /* Parameter(s):                                                              */
 /*   board - board structure                                                  */
-/*   col   - selected column                                                  */
-/*   row   - selected row                                                     */
 /*   disk  - player's disk type                                               */
 /* Returns:                                                                   */
-/*   1 if cell completes winning alignment to the left, 0 otherwise .         */
-unsigned int win_alignment_left(conn4_state* board, unsigned int col,
-        unsigned int row, char disk) {
-    unsigned int count;
+/*   Number of open cells.                                                    */
+static unsigned int count_open_scan(conn4_state* board, char disk) {
+    unsigned int count = 0;
+    unsigned int column, row;
 
-    if (col + 1 < COUNT_TO_WIN) {
-        return 0;   /* Not enough space to left to make winning alignment */
-    }
-    /* Check horizontal alignment */
-    for (count = 1; count < COUNT_TO_WIN; ++count) {
-        if (get_cell(board, col - count, row) != disk) {
-            break;
+    for (column = 0; column < get_cols(); ++column) {
+        for (row = get_height(board, column) + 1; row < get_rows(); ++row) {
+            count += (open_alignment(board, column, row, disk, -1) |
+                    open_alignment(board, column, row, disk, +1));
         }
     }
-    if (count == COUNT_TO_WIN) {
-        return 1;   /* Horizontal win alignment of disks */
+    return count;
+}
+
+
+/* Function: count_opens                                                      */
+/*   Counts open cells (see count_open_pos()) of both players. Grids of both */
+/*   players are built by one pass over board, on stack if board fits in      */
+/*   GRID_MAX_BYTES, on heap otherwise.                                       */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   opens - where numbers of open cells of 'X' and 'O' will be written      */
+static void count_opens(conn4_state* board, unsigned int* opens) {
+    const board_engine* engine = get_engine();
+    unsigned char local[2 * GRID_MAX_BYTES + MAX_COLUMNS];
+    unsigned char* grid = local;
+    size_t bytes = GRID_BYTES(get_cols(), get_rows());
+
+    if (engine != NULL) {
+        opens[0] = engine->count_open(board, CELL_X);
+        opens[1] = engine->count_open(board, CELL_O);
+        return;
     }
-    /* Check diagonal alignment (diagonal rises up) */
-    if (row + COUNT_TO_WIN <= get_rows()) {
-        for (count = 1; count < COUNT_TO_WIN; ++count) {
-            if (get_cell(board, col - count, row + count) != disk) {
-                break;
-            }
-        }
-        if (count == COUNT_TO_WIN) {
-            return 1;   /* Rising diagonal win alignment of disks */
+    if (!GRID_FITS()) {
+        grid = malloc(2 * bytes + get_cols());
+        if (grid == NULL) {
+            opens[0] = count_open_scan(board, CELL_X);
+            opens[1] = count_open_scan(board, CELL_O);
+            return;
         }
     }
-    /* Check diagonal alignment (diagonal falls down) */
-    if (row + 1 >= COUNT_TO_WIN) {
-        for (count = 1; count < COUNT_TO_WIN; ++count) {
-            if (get_cell(board, col - count, row - count) != disk) {
-                break;
-            }
-        }
-        if (count == COUNT_TO_WIN) {
-            return 1;   /* Rising diagonal win alignment of disks */
-        }
+    board_to_grids(board, grid, grid + bytes, grid + 2 * bytes);
+    opens[0] = kernels.count_open(grid, grid + 2 * bytes, get_cols(),
+            get_rows());
+    opens[1] = kernels.count_open(grid + bytes, grid + 2 * bytes, get_cols(),
+            get_rows());
+    if (grid != local) {
+        free(grid);
     }
-    /* Chosen cell doesn't make any winning alignment to the left */
-    return 0;
+    return;
 }
 
+
 /* Function: count_open_pos                                                   */
 /*   Counts how many cells on the board can complete winning alignment except */
-/*   of those accessible immediately.                                         */
+/*   of those accessible immediately. Only cells that are ends of alignments  */
+/*   (to the left or to the right, horizontally or diagonally) are counted.   */
+/*   Counting is done by engine specialized for dimensions of board, if       */
+/*   there is one, or by kernel selected for this processor.                  */
 /* Parameter(s):                                                              */
-/*   board - board structure                                                  
+/*   board - board structure                                                  */
 /*   disk  - player's disk type                                               */
 /* Returns:                                                                   */
-/*   1 if cell completes winning alignment to the right, 0 otherwise.         */
+/*   Number of open cells.                                                    */
 unsigned int count_open_pos(conn4_state* board, char disk) {
-    unsigned int count = 0U;
-    unsigned int column, row;
-
-    for (column = 0; column < get_cols(); ++column) {
-        for (row = get_height(board, column) + 1; row < get_rows(); ++row) {
-            count += (win_alignment_left(board, column, row, disk)
-                    | win_alignment_right(board, column, row, disk));
-        }
-    }
+    unsigned int opens[2];
 
-    return count;
+    count_opens(board, opens);
+    return opens[disk == CELL_O];
 }
 
 
@@ -242,14 +450,20 @@ unsigned int count_open_pos(conn4_state* board, char disk) {
 float eval(conn4_state* board, unsigned int column) {
     float est;              /* Estimation of chances to win */
     int opens, opponent;    /* Number of open positions of player and opponent*/
+    unsigned int counts[2]; /* Number of open positions of 'X' and 'O' */
 
     /* Find out if any player wins in two nearest moves */
     if (quick_win(board, column, &est)) {
         return est;
     }
+    /* Learned network (if loaded) replaces counting of open positions */
+    if (nnue_active()) {
+        return -nnue_eval(board);
+    }
     /* Evaluate open position for both players */
-    opens = count_open_pos(board, CURR_PLAYER(board));
-    opponent = count_open_pos(board, NEXT_PLAYER(board));
+    count_opens(board, counts);
+    opens = counts[CURR_PLAYER(board) == CELL_O];
+    opponent = counts[NEXT_PLAYER(board) == CELL_O];
     /* Return the following value: difference between counts of open positions*/
     /* divided by total number of positions for two players plus 1.           */
     /* Such estimator is strictly between -1 and +1 (both ends exclusively)   */
@@ -267,6 +481,15 @@ float eval(conn4_state* board, unsigned int column) {
 /* Returns:                                                                   */
 /*   1 if certain move is required, 0 otherwise.                              */
 int force_move(conn4_state* board, int* move) {
+    win_masks masks;
+
+    /* Winning moves of both players are found by one query of board */
+    if (get_cols() <= WIN_MASK_COLUMNS) {
+        get_win_masks(board, &masks);
+        return (mask_moves(masks.wins[CURR_PLAYER(board) == CELL_O], move) >
+                0 || mask_moves(masks.wins[NEXT_PLAYER(board) == CELL_O],
+                move) > 0);
+    }
     if (count_win_moves(board, CURR_PLAYER(board), move) > 0) {
         return 1;   /* Can win immediately! */
     }
@@ -299,6 +522,31 @@ float eval_rec(conn4_state* board, unsigned int column, int depth) {
     float best = LOSS;  /* The best estimation for opponent's move */
     char disk = CURR_PLAYER(board);
 
+    pv_clear(board);
+
+    /* Aborted search unwinds at once; its result is discarded by caller */
+    if (search_stopped()) {
+        return DRAW;
+    }
+
+    /* Tablebase of small board knows exact value for player to move */
+    switch (tb_probe(board)) {
+        case TB_WIN:
+            return LOSS;
+        case TB_DRAW:
+            return DRAW;
+        case TB_LOSS:
+            return WIN;
+    }
+
+    /* Static threat analysis can prove result and spare the whole subtree */
+    switch (prove_position(board)) {
+        case PROVEN_WIN:
+            return WIN;
+        case PROVEN_DRAW:
+            return DRAW;
+    }
+
     /* Recursion stop condition - maximal depth reached. */
     if (depth <= 0) {
         return eval(board, column);
@@ -310,11 +558,13 @@ float eval_rec(conn4_state* board, unsigned int column, int depth) {
         set_cell(board, move, disk);
         if (check_win(board, move)) {
             best = WIN;
+            pv_clear(board);
         } else {
             /* Can go deeper in the search tree without counting this level   */
             /* because this level had no branching.                           */
             best = eval_rec(board, move, depth);
         }
+        pv_update(board, move);
         unset_cell(board, move);    /* Backtrack, restore board's state */
     } else {
         for (i = 0; i < get_cols(); ++i) {
@@ -324,12 +574,17 @@ float eval_rec(conn4_state* board, unsigned int column, int depth) {
             /* n/2, n/2-1, n/2+1, n/2-2, ..., where n is number of columns.   */
             move = get_cols() / 2 - (i + 1) / 2 * ((i % 2) * 2 - 1);
             /* Try to make move in selected column */
-            if (set_cell(board, move, disk)) {
+            if (is_local(board, move) && set_cell(board, move, disk)) {
                 if (!quick_win(board, move, &est)) {
                     /* Evaluate board from the opponent's point of view */
                     est = eval_rec(board, move, depth - 1);
-                    best = MAX(best, est);
-                }   /* Else estimation is computed automatically */
+                } else {
+                    /* Estimation is computed automatically */
+                    pv_clear(board);
+                }
+                if (est > best) {
+                    pv_update(board, move);
+                }
                 best = MAX(best, est);      /* Keep best score of opponent */
                 unset_cell(board, move);    /* Backtrack */
             }
@@ -351,9 +606,11 @@ float eval_rec(conn4_state* board, unsigned int column, int depth) {
 /*   depth  - maximal depth of search                                         */
 /*   forced - flag to indicate the caller that returned move is necessary and */
 /*            further search is redundant                                     */
+/*   score  - where estimation of found move will be written (unless forced)  */
 /* Returns:                                                                   */
 /*   Index of bets found move.                                                */
-int computer_move_rec(conn4_state* board, unsigned int depth, int* forced) {
+int computer_move_rec(conn4_state* board, unsigned int depth, int* forced,
+        float* score) {
     int i, c;
     float est;
     int column;             /* Best move found so far */
@@ -368,6 +625,8 @@ int computer_move_rec(conn4_state* board, unsigned int depth, int* forced) {
         return column;
     }
 
+    TRACE_BEGIN_ARG("computer_move_rec", "depth", depth);
+
     for (i = 0; i < get_cols(); ++i) {
         /* Select moves in order from central column to corners. Central      */
         /* columns have higher priority as they give more opportunities.      */
@@ -375,7 +634,7 @@ int computer_move_rec(conn4_state* board, unsigned int depth, int* forced) {
         /* n/2, n/2-1, n/2+1, n/2-2, ..., where n is number of columns.       */
         c = get_cols() / 2 - (i + 1) / 2 * ((i % 2) * 2 - 1);
         /* Try putting disk in selected column */
-        if (set_cell(board, c, disk)) {
+        if (is_local(board, c) && set_cell(board, c, disk)) {
             /* Evaluate last move. If it's better than previous - update best */
             est = eval_rec(board, c, depth);
             if (est > best) {
@@ -386,33 +645,183 @@ int computer_move_rec(conn4_state* board, unsigned int depth, int* forced) {
         }
     }
 
+    *score = best;
+    TRACE_END("computer_move_rec");
     return column;
 }
 
 
 
 
-/* Function: computer_move                                                    */
+/* Function: table_move                                                       */
+/*   Chooses perfect move by tablebase of small board: immediate win, or move */
+/*   to position with the worst value for opponent (central columns first).   */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - where chosen move will be written                               */
+/* Returns:                                                                   */
+/*   1 if move is chosen, 0 if tablebase doesn't know position.               */
+static int table_move(conn4_state* board, int* column) {
+    unsigned int i, move;
+    int value, best = TB_WIN + 1;   /* The least value for opponent */
+    char disk = CURR_PLAYER(board);
+
+    if (tb_probe(board) == TB_NONE) {
+        return 0;
+    }
+    for (i = 0; i < get_cols(); ++i) {
+        move = get_cols() / 2 - (i + 1) / 2 * ((i % 2) * 2 - 1);
+        if (!set_cell(board, move, disk)) {
+            continue;
+        }
+        if (check_win(board, move)) {
+            unset_cell(board, move);
+            *column = move;     /* Immediate win */
+            return 1;
+        }
+        value = tb_probe(board);
+        unset_cell(board, move);
+        if (value != TB_NONE && value < best) {
+            best = value;
+            *column = move;
+        }
+    }
+    return (best <= TB_WIN);
+}
+
+
+/* Function: out_of_time                                                      */
+/*   Checks if iterative deepening should stop before the next iteration.     */
+/*   Under deadline of request the next iteration isn't started unless it    */
+/*   fits before the margin of search_stopped(), if it takes as long as the  */
+/*   last one (it takes longer, but search is aborted at the margin anyway).  */
+/*   Without deadline search uses 1 second of computer time.                  */
+/* Parameter(s):                                                              */
+/*   ctl  - limits of request, or NULL if there are none                      */
+/*   t0   - computer time when search started                                 */
+/*   last - duration of the last iteration in seconds (monotonic clock)       */
+/* Returns:                                                                   */
+/*   1 if search should stop, 0 otherwise.                                    */
+static int out_of_time(const move_ctl* ctl, clock_t t0, double last) {
+    if (move_stopped_before(ctl, DEADLINE_MARGIN + search_gap + last)) {
+        return 1;
+    }
+    if (ctl != NULL && ctl->deadline > 0.0) {
+        return 0;
+    }
+    return ((clock() - t0) >= CLOCKS_PER_SEC);
+}
+
+
+/* Function: cached_move                                                      */
+/*   Looks up result of earlier search of position in analysis cache.        */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   key    - key of position (see cache_key())                               */
+/*   cached - where result will be written if found                           */
+/* Returns:                                                                   */
+/*   1 if result with valid move is found, 0 otherwise.                      */
+static int cached_move(conn4_state* board, unsigned long long key,
+        cache_result* cached) {
+    return (cache_probe(key, cached) && cached->move >= 0 &&
+            cached->move < get_cols() &&
+            get_height(board, cached->move) < get_rows());
+}
+
+
+/* Function: computer_move_timed                                              */
 /*   Computer's decision-making function.                                     */
 /*   Currently function is written so that it tries to find obvious move      */
 /*   (which yields immediate win or blocks opponent from winning), and if     */
 /*   there is no obvious move, it selects the best move based on game graph   */
 /*   traversal (depth-first-search) with incrementally increasing maximal     */
-/*   depth of search until function used more than 1 second of computer time. */
+/*   depth of search until the whole game is searched or deadline of request */
+/*   (or 1 second of computer time if there is none) comes. Search stops a    */
+/*   margin before deadline (see search_stopped()), so that move is made in   */
+/*   time, and the next iteration isn't started if the last one wouldn't fit */
+/*   before that.                                                             */
+/*   Iteration interrupted by deadline or cancellation is discarded and move */
+/*   of the last complete iteration is returned. Before deepening, short      */
+/*   proof-number search looks for forced win or loss along forcing lines,   */
+/*   which may be much deeper than depth-limited search reaches; then        */
+/*   winning or the longest resisting move is played at once.                */
+/*   Results of search are shared with other runs through persistent cache:   */
+/*   under deadline iterations not deeper than cached result of position are */
+/*   skipped, so search continues where earlier runs stopped. Cached move is */
+/*   played only if it was searched at least as deep as this run got, and    */
+/*   only deeper results are stored.                                          */
+/*   Position of small board found in tablebase is answered by perfect move  */
+/*   at once.                                                                 */
 /* Parameter(s):                                                              */
 /*   board - board structure                                                  */
+/*   ctl   - limits of request, or NULL if there are none                     */
 /* Returns:                                                                   */
 /*   Index of chosen move.                                                    */
-int computer_move(conn4_state* board) {
+int computer_move_timed(conn4_state* board, const move_ctl* ctl) {
     clock_t t0 = clock();   /* Fix current computer time */
 
     unsigned int depth = 0; /* Set initial maximal depth */
-    int column;
+    int column, c;
     int forced = 0;         /* Flag indicating that found move is necessary */
+    float score, est;       /* Estimation of selected move */
+    cache_result cached;    /* Result of search found in cache */
+    int hit;                /* Flag: result of position is in cache */
+    unsigned long long key = cache_key(board);
+    double start, last = 0.0;   /* Start and duration of iteration */
+
+    if (table_move(board, &column)) {
+        /* Perfect move, nothing to search */
+    } else {
+        hit = cached_move(board, key, &cached);
+        if (hit && ctl != NULL && ctl->deadline > 0.0) {
+            /* Iterations up to depth of cached result are answered by it;   */
+            /* deeper one is interrupted by deadline if it doesn't fit.      */
+            column = cached.move;
+            score = cached.score;
+            depth = cached.depth + 1;
+        } else {
+            /* The first iteration is always complete, so there is a move */
+            column = computer_move_rec(board, depth++, &forced, &score);
+        }
+        /* Short proof-number pre-pass finds forced results deeper than    */
+        /* search: proven win is played, and against proven loss deeper     */
+        /* search can't do better than the longest resisting move.          */
+        TRACE_BEGIN("pns_search");
+        if (!forced && pns_search(board, PNS_NODES, ctl, &c) != PNS_UNKNOWN) {
+            column = c;
+            forced = 1;
+        }
+        TRACE_END("pns_search");
+
+        search_ctl = ctl;
+        search_nodes = 0;
+        search_aborted = 0;
+        search_checked = search_gap = 0.0;
+        /* Search deeper than the end of game gives nothing new */
+        while (!forced && depth <= get_size() - board->moves &&
+                !out_of_time(ctl, t0, last)) {
+            start = monotonic_time();
+            c = computer_move_rec(board, depth, &forced, &est);
+            if (search_aborted) {
+                break;
+            }
+            last = monotonic_time() - start;
+            column = c;
+            score = est;
+            ++depth;
+        }
+        search_ctl = NULL;
 
-    do {
-        column = computer_move_rec(board, depth++, &forced);
-    } while (!forced && (clock() - t0) < CLOCKS_PER_SEC);
+        if (!forced && hit && cached.depth >= depth - 1) {
+            /* Earlier run searched deeper than this one */
+            column = cached.move;
+        } else if (!forced) {
+            cached.depth = depth - 1;
+            cached.score = score;
+            cached.move = column;
+            cache_store(key, &cached);
+        }
+    }
 
     /* Output selected column in one-based indexing */
     printf("Selected column: %d\n", column + 1);
@@ -421,4 +830,402 @@ int computer_move(conn4_state* board) {
 }
 
 
+/* Function: create_search                                                    */
+/*   Starts resumable search of computer's move (see computer_move_timed()).  */
+/*   No positions are searched until search_step() is called.                 */
+/* Parameter(s):                                                              */
+/*   board - board structure (copied)                                         */
+/*   ctl   - limits of request, or NULL if there are none; search without     */
+/*           deadline lasts SEARCH_TIME seconds                               */
+/* Returns:                                                                   */
+/*   New search, or NULL if memory can't be allocated.                        */
+search_task* create_search(conn4_state* board, const move_ctl* ctl) {
+    cache_result cached;    /* Result of search found in cache */
+    search_task* task = malloc(sizeof(*task));
+
+    if (task == NULL) {
+        return NULL;
+    }
+    task->board = create_board();
+    /* Stack holds one frame per move at most */
+    task->stack = malloc((get_size() + 1) * sizeof(*task->stack));
+    if (task->board == NULL || task->stack == NULL) {
+        destruct_board(task->board);
+        free(task->stack);
+        free(task);
+        return NULL;
+    }
+    board_copy(task->board, board);
+    task->ctl = ctl;
+    task->iter_start = monotonic_time();
+    task->deadline = (ctl != NULL && ctl->deadline > 0.0 ? ctl->deadline :
+            task->iter_start + SEARCH_TIME);
+    task->stop = task->deadline - DEADLINE_MARGIN;
+    task->step_time = 0.0;
+    task->step_end = 0.0;
+    task->wait = 0.0;
+    task->iter_time = 0.0;
+    task->sp = 0;
+    task->call = 0;
+    task->ret = 0;
+    task->depth = 0;
+    task->root_i = 0;
+    task->root_column = -1;
+    task->root_best = LOSS - 1;
+    task->column = -1;
+    task->forced = 0;
+    task->done = 0;
+    task->key = cache_key(board);
+
+    if (table_move(board, &task->column)) {
+        task->forced = 1;
+        task->done = 1;
+    } else if (force_move(board, &task->column)) {
+        task->forced = 1;
+        task->done = 1;
+    } else if (cached_move(board, task->key, &cached)) {
+        /* Iterations up to depth of cached result are answered by it */
+        task->column = cached.move;
+        task->score = cached.score;
+        task->depth = cached.depth + 1;
+        task->done = (task->depth > get_size() - board->moves);
+    }
+
+    return task;
+}
+
+
+/* Function: finish_search                                                    */
+/*   Finishes search with move of the last complete iteration and shares     */
+/*   result through persistent cache.                                         */
+/* Parameter(s):                                                              */
+/*   task - search structure                                                  */
+static void finish_search(search_task* task) {
+    cache_result cached;
+
+    /* Unwind interrupted iteration */
+    while (task->sp > 0) {
+        unset_cell(task->board, task->stack[--task->sp].move);
+    }
+    if (task->call || task->ret) {
+        unset_cell(task->board, task->root_move);
+    }
+    task->call = 0;
+    task->ret = 0;
+    task->done = 1;
+
+    cached.depth = task->depth - 1;
+    cached.score = task->score;
+    cached.move = task->column;
+    cache_store(task->key, &cached);
+    return;
+}
+
+
+/* Function: search_expired                                                   */
+/*   Checks if search ran out of time or is cancelled. Search stops           */
+/*   DEADLINE_MARGIN before its deadline, less one more quantum and the       */
+/*   last wait for quantum, because it is finished only in its next quantum.  */
+/*   The wait grows with requests queued ahead per thread and with            */
+/*   preemption of threads oversubscribing processors.                        */
+/* Parameter(s):                                                              */
+/*   task - search structure                                                  */
+/* Returns:                                                                   */
+/*   1 if search should be finished, 0 otherwise.                             */
+static int search_expired(const search_task* task) {
+    return (monotonic_time() + task->step_time + task->wait >= task->stop ||
+            move_cancelled(task->ctl));
+}
+
+
+/* Function: search_step                                                      */
+/*   Resumes search for at most quantum positions and suspends it again.      */
+/*   Search is finished once it runs out of time (see search_expired()), is   */
+/*   cancelled, or searched the whole game. Iteration interrupted by that is  */
+/*   discarded; the first iteration is always complete. New iteration isn't   */
+/*   started if the previous one took longer than time left.                 */
+/* Parameter(s):                                                              */
+/*   task    - search structure                                               */
+/*   quantum - maximal number of positions to search                          */
+/* Returns:                                                                   */
+/*   1 if search is finished, 0 otherwise.                                    */
+int search_step(search_task* task, unsigned int quantum) {
+    conn4_state* board = task->board;
+    search_frame* frame;
+    unsigned int move;
+    int forced_move;
+    float est;
+    double start = monotonic_time(), now;
+
+    if (task->step_end > 0.0) {
+        task->wait = start - task->step_end;
+    }
+    if (!task->done && task->depth > 0 && search_expired(task)) {
+        finish_search(task);
+    }
+
+    while (!task->done) {
+        if (task->call) {
+            /* Enter eval_rec() */
+            if (quantum == 0) {
+                task->step_end = monotonic_time();
+                task->step_time = task->step_end - start;
+                return 0;
+            }
+            --quantum;
+            if (task->depth > 0 && search_expired(task)) {
+                finish_search(task);
+                break;
+            }
+            task->call = 0;
+            task->ret = 1;
+            switch (prove_position(board)) {
+                case PROVEN_WIN:
+                    task->value = WIN;
+                    continue;
+                case PROVEN_DRAW:
+                    task->value = DRAW;
+                    continue;
+            }
+            if (task->call_depth <= 0) {
+                task->value = eval(board, task->call_column);
+                continue;
+            }
+            task->ret = 0;
+            frame = &task->stack[task->sp++];
+            frame->i = 0;
+            frame->depth = task->call_depth;
+            frame->best = LOSS;
+            frame->forced = force_move(board, &forced_move);
+            if (frame->forced) {
+                frame->move = forced_move;
+                set_cell(board, frame->move, CURR_PLAYER(board));
+                if (check_win(board, frame->move)) {
+                    unset_cell(board, frame->move);
+                    --task->sp;
+                    task->ret = 1;
+                    task->value = -WIN;
+                } else {
+                    /* The same depth, as this level has no branching */
+                    task->call = 1;
+                    task->call_column = frame->move;
+                }
+                continue;
+            }
+        }
+
+        if (task->sp == 0) {
+            /* Root of search (see computer_move_rec()) */
+            if (task->ret) {
+                task->ret = 0;
+                if (task->value > task->root_best) {
+                    task->root_best = task->value;
+                    task->root_column = task->root_move;
+                }
+                unset_cell(board, task->root_move);
+                ++task->root_i;
+            }
+            for (; task->root_i < get_cols(); ++task->root_i) {
+                move = get_cols() / 2 - (task->root_i + 1) / 2 *
+                        ((task->root_i % 2) * 2 - 1);
+                if (is_local(board, move) &&
+                        set_cell(board, move, CURR_PLAYER(board))) {
+                    task->root_move = move;
+                    task->call = 1;
+                    task->call_column = move;
+                    task->call_depth = task->depth;
+                    break;
+                }
+            }
+            if (!task->call) {
+                /* Iteration is complete */
+                task->column = task->root_column;
+                task->score = task->root_best;
+                ++task->depth;
+                task->root_i = 0;
+                task->root_best = LOSS - 1;
+                now = monotonic_time();
+                task->iter_time = now - task->iter_start;
+                task->iter_start = now;
+                if (task->depth > get_size() - board->moves ||
+                        now + task->iter_time >= task->stop ||
+                        search_expired(task)) {
+                    finish_search(task);
+                }
+            }
+            continue;
+        }
+
+        /* Continue eval_rec() of the top frame */
+        frame = &task->stack[task->sp - 1];
+        if (task->ret) {
+            task->ret = 0;
+            unset_cell(board, frame->move);
+            if (frame->forced) {
+                --task->sp;
+                task->ret = 1;
+                task->value = -task->value;
+                continue;
+            }
+            frame->best = MAX(frame->best, task->value);
+            ++frame->i;
+        }
+        for (; frame->i < get_cols(); ++frame->i) {
+            move = get_cols() / 2 - (frame->i + 1) / 2 *
+                    ((frame->i % 2) * 2 - 1);
+            if (is_local(board, move) &&
+                    set_cell(board, move, CURR_PLAYER(board))) {
+                if (!quick_win(board, move, &est)) {
+                    frame->move = move;
+                    task->call = 1;
+                    task->call_column = move;
+                    task->call_depth = frame->depth - 1;
+                    break;
+                }
+                frame->best = MAX(frame->best, est);
+                unset_cell(board, move);
+            }
+        }
+        if (!task->call) {
+            --task->sp;
+            task->ret = 1;
+            task->value = -frame->best;
+        }
+    }
+
+    return 1;
+}
+
+
+/* Function: search_move                                                      */
+/* Parameter(s):                                                              */
+/*   task - search structure                                                  */
+/* Returns:                                                                   */
+/*   Move found by search (of the last complete iteration if search isn't     */
+/*   finished yet), or -1 if no iteration is complete yet.                    */
+int search_move(const search_task* task) {
+    return task->column;
+}
+
+
+/* Function: destruct_search                                                  */
+/*   Releases search structure.                                               */
+/* Parameter(s):                                                              */
+/*   task - search structure                                                  */
+void destruct_search(search_task* task) {
+    if (task != NULL) {
+        destruct_board(task->board);
+        free(task->stack);
+        free(task);
+    }
+    return;
+}
+
+
+/* Function: compare_lines                                                    */
+/*   Helper function for qsort() that orders lines by score (the best first); */
+/*   lines of equal score keep order of search (central columns first).       */
+static int compare_lines(const void* a, const void* b) {
+    const analysis_line* x = a;
+    const analysis_line* y = b;
+
+    if (x->score != y->score) {
+        return (x->score < y->score ? 1 : -1);
+    }
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+
+/* Function: computer_analyse                                                 */
+/*   Multi-PV analysis. Search is the same iterative deepening as in          */
+/*   computer_move_timed(), but every root move keeps its own score and      */
+/*   principal variation, so one pass ranks all moves. Deepening stops once   */
+/*   limits of request are exceeded (see out_of_time()) or the whole game is  */
+/*   searched; interrupted iteration is discarded.                            */
+/* Parameter(s):                                                              */
+/*   board - board structure (restored before return)                         */
+/*   count - maximal number of lines                                          */
+/*   ctl   - limits of request, or NULL if there are none                     */
+/*   lines - where at most count lines will be written, the best first        */
+/* Returns:                                                                   */
+/*   Number of written lines (number of legal moves at most).                 */
+unsigned int computer_analyse(conn4_state* board, unsigned int count,
+        const move_ctl* ctl, analysis_line* lines) {
+    clock_t t0 = clock();
+    unsigned int depth, i, n = 0;
+    int c;
+    char disk = CURR_PLAYER(board);
+    analysis_line* all = malloc(get_cols() * sizeof(*all));
+    analysis_line* next = malloc(get_cols() * sizeof(*next));
+    pv_table* table = malloc(sizeof(*table));
+
+    if (all == NULL || next == NULL || table == NULL) {
+        free(all);
+        free(next);
+        free(table);
+        return 0;
+    }
+    table->root = board->moves;
+    search_ctl = NULL;
+    search_nodes = 0;
+    search_aborted = 0;
+    search_checked = search_gap = 0.0;
+    search_pv = table;
+
+    for (depth = 0; depth == 0 || (depth <= get_size() - board->moves &&
+            !out_of_time(ctl, t0, 0.0)); ++depth) {
+        for (i = 0, c = 0; i < get_cols(); ++i) {
+            /* Central columns first (see computer_move_rec()) */
+            next[c].move = get_cols() / 2 - (i + 1) / 2 * ((i % 2) * 2 - 1);
+            if (!is_local(board, next[c].move) ||
+                    !set_cell(board, next[c].move, disk)) {
+                continue;
+            }
+            if (check_win(board, next[c].move)) {
+                next[c].score = WIN;
+                pv_clear(board);
+            } else {
+                next[c].score = eval_rec(board, next[c].move, depth);
+            }
+            pv_update(board, next[c].move);
+            unset_cell(board, next[c].move);
+            next[c].order = i;
+            next[c].length = table->length[0];
+            memcpy(next[c].pv, table->moves[0],
+                    table->length[0] * sizeof(*next[c].pv));
+            ++c;
+        }
+        if (search_aborted) {
+            break;
+        }
+        memcpy(all, next, c * sizeof(*all));
+        n = c;
+        /* The first iteration is always complete, the next ones may not */
+        search_ctl = ctl;
+    }
+    search_ctl = NULL;
+    search_pv = NULL;
+
+    qsort(all, n, sizeof(*all), compare_lines);
+    n = (n < count ? n : count);
+    memcpy(lines, all, n * sizeof(*lines));
+    free(all);
+    free(next);
+    free(table);
+    return n;
+}
+
+
+/* Function: computer_move                                                    */
+/*   Computer's decision-making function without limits of request (see       */
+/*   computer_move_timed()).                                                  */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   Index of chosen move.                                                    */
+int computer_move(conn4_state* board) {
+    return computer_move_timed(board, NULL);
+}
+
+
 #endif /* _COMPUTER_C_ */
@@ -4,9 +4,64 @@
 #include "player.h"
 
 
+/* Time of resumable search without deadline of request in seconds            */
+#define SEARCH_TIME     1.0
+
+/* Maximal length of principal variation of analysis                         */
+#define MAX_PV          32
+
+/* Root move found by analysis with its score and principal variation        */
+typedef struct {
+    int move;               /* Column of move */
+    float score;            /* Estimation for player to move, -1...+1 */
+    unsigned int order;     /* Order of move in search */
+    unsigned int length;    /* Length of principal variation */
+    int pv[MAX_PV];         /* Principal variation, starting with move */
+} analysis_line;
+
+/* Resumable search of computer's move                                        */
+typedef struct search_task_struct search_task;
+
+
+/* Counts moves that yield winning alignment immediately; the last (rightmost)*/
+/* such move is written to move.                                              */
+int count_win_moves(conn4_state* board, char disk, int* move);
+
+/* Evaluates position from point of view of player who made last move.       */
+float eval(conn4_state* board, unsigned int column);
+
+/* Checks if move is searched (on boards wider than MAX_COLUMNS only moves    */
+/* near disks on board are).                                                  */
+int is_local(conn4_state* board, unsigned int column);
+
+/* Searches for the best move till limited depth; forced is set if the move */
+/* is necessary (then score isn't written).                                   */
+int computer_move_rec(conn4_state* board, unsigned int depth, int* forced,
+        float* score);
+
 /* Decision-making function of computer player. Call this function to request */
 /* computer player for its next move.                                         */
 int computer_move(conn4_state* board);
 
+/* The same function that respects limits of move request (see player.h).     */
+int computer_move_timed(conn4_state* board, const move_ctl* ctl);
+
+/* Ranks up to count best moves with scores and principal variations in one  */
+/* search.                                                                    */
+unsigned int computer_analyse(conn4_state* board, unsigned int count,
+        const move_ctl* ctl, analysis_line* lines);
+
+/* Starts resumable search of computer's move with limits of request.         */
+search_task* create_search(conn4_state* board, const move_ctl* ctl);
+
+/* Searches at most quantum positions; returns 1 when search is finished.     */
+int search_step(search_task* task, unsigned int quantum);
+
+/* Move found by search (-1 if there is none yet).                            */
+int search_move(const search_task* task);
+
+/* Releases search.                                                           */
+void destruct_search(search_task* task);
+
 
 #endif /* _COMPUTER_H_ */
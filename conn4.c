@@ -2,9 +2,11 @@
 #define _CONN4_C_
 
 #include "conn4.h"
-#include <stdlib.h>     /* malloc() */
-#include <string.h>     /* memset() */
-#include <stdio.h>      /* printf() */
+#include "engine.h"
+#include "trace.h"
+#include <stdlib.h>     /* malloc(), realloc(), free() */
+#include <string.h>     /* memset(), memcpy() */
+#include <stdio.h>      /* sprintf(), fwrite() */
 
 
 
@@ -13,6 +15,9 @@
 #define CHAR_SIZE       8
 #define CHAR_SIZE_MASK  0x7
 
+/* Maximal number of bits copied at once by packing of boards                 */
+#define PACK_BITS       56
+
 /* Total number of rows/columns stays constant during the game.               */
 /* These variables are accessible only within this source file. From outside  */
 /* one should use get_rows(), get_cols() and set_dimensions() functions.      */
@@ -24,6 +29,25 @@ static unsigned int SIZE = DEFAULT_COLUMNS * DEFAULT_ROWS;
 static unsigned int CHUNKS = (DEFAULT_COLUMNS * DEFAULT_ROWS + CHAR_SIZE - 1) /
                                 CHAR_SIZE;
 
+/* Number of bytes of cell storage of one board (see board_bytes()).          */
+static unsigned int BYTES = (DEFAULT_COLUMNS * DEFAULT_ROWS + CHAR_SIZE - 1) /
+                                CHAR_SIZE + DEFAULT_COLUMNS;
+
+/* Accumulator of features (see set_accumulator()). It is kept in cell        */
+/* storage after heights of columns, aligned to int, and is disabled if its   */
+/* width is 0.                                                                */
+static unsigned int ACC_WIDTH = 0;
+static unsigned int ACC_OFFSET = 0;
+static const int* ACC_BIAS = NULL;
+static const int* ACC_FEATURES = NULL;
+
+/* Engines specialized for popular dimensions (see engine.c) and the one of  */
+/* current dimensions, NULL if generic functions are used.                    */
+static const board_engine* const ENGINES[] = {
+    &engine_7x6, &engine_8x7, &engine_9x7
+};
+static const board_engine* ENGINE = NULL;
+
 /* Macros: CELL_POS                                                           */
 /*   Converts (column,row) pair of indices into single index of cell in       */
 /*   flattened one-dimensional array of cells in column-major order.          */
@@ -39,6 +63,15 @@ static unsigned int CHUNKS = (DEFAULT_COLUMNS * DEFAULT_ROWS + CHAR_SIZE - 1) /
 /*   that represents a cell.                                                  */
 #define CELL_MASK(column,row)   (1 << (CELL_POS(column,row) & CHAR_SIZE_MASK))
 
+/* Macros: ACC_ROW                                                            */
+/*   Obtains weights of feature of disk at cell (see set_accumulator()).     */
+#define ACC_ROW(column,row,disk)    (ACC_FEATURES + (size_t)ACC_WIDTH *  \
+                        (2 * CELL_POS(column,row) + ((disk) == CELL_O)))
+
+/* Macros: ACCUMULATOR                                                        */
+/*   Obtains accumulator of features of board.                                */
+#define ACCUMULATOR(board)      ((int*)((board)->info + ACC_OFFSET))
+
 
 /* Function: set_dimensions                                                   */
 /*   Defines dimensions of game board.                                        */
@@ -48,10 +81,106 @@ static unsigned int CHUNKS = (DEFAULT_COLUMNS * DEFAULT_ROWS + CHAR_SIZE - 1) /
 /*   columns - horizontal dimension (number of columns) of game board         */
 /*   rows    - vertical dimension (number of rows) of game board              */
 void set_dimensions(unsigned int columns, unsigned int rows) {
+    unsigned int i;
+
     ROWS = rows;
     COLS = columns;
     SIZE = ROWS * COLS;
     CHUNKS = (SIZE + CHAR_SIZE - 1) / CHAR_SIZE;
+    /* Select engine specialized for these dimensions, if there is one */
+    ENGINE = NULL;
+    for (i = 0; i < sizeof(ENGINES) / sizeof(ENGINES[0]); ++i) {
+        if (ENGINES[i]->columns == COLS && ENGINES[i]->rows == ROWS) {
+            ENGINE = ENGINES[i];
+        }
+    }
+    /* Features of accumulator are bound to dimensions */
+    set_accumulator(0, NULL, NULL);
+    return;
+}
+
+
+/* Function: set_accumulator                                                  */
+/*   Enables accumulator of features that is updated by set_cell() and       */
+/*   unset_cell(): each disk adds weights of its feature to accumulator, so  */
+/*   accumulator is always the sum of bias and weights of all disks on board. */
+/*   Feature of disk at cell (column, row) has index 2 * (column * rows +     */
+/*   row) for 'X' disk and the next one for 'O' disk. Like changing of       */
+/*   dimensions, this invalidates all previously instantiated boards.         */
+/* Parameter(s):                                                              */
+/*   width    - number of values of accumulator, 0 disables accumulator       */
+/*   bias     - initial values of accumulator (width values)                  */
+/*   features - weights of features, width values per feature (2 * size      */
+/*              features); both arrays must live while accumulator is enabled */
+void set_accumulator(unsigned int width, const int* bias, const int* features) {
+    ACC_WIDTH = width;
+    ACC_BIAS = bias;
+    ACC_FEATURES = features;
+    ACC_OFFSET = (CHUNKS + COLS + sizeof(int) - 1) / sizeof(int) * sizeof(int);
+    BYTES = (width > 0 ? ACC_OFFSET + width * sizeof(int) : CHUNKS + COLS);
+    return;
+}
+
+
+/* Function: accumulator_width                                                */
+/* Returns:                                                                   */
+/*   Number of values of accumulator of features, 0 if it is disabled (see   */
+/*   set_accumulator()).                                                      */
+unsigned int accumulator_width(void) {
+    return ACC_WIDTH;
+}
+
+
+/* Function: get_accumulator                                                  */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   Accumulator of features of position on board (see set_accumulator()),   */
+/*   or NULL if accumulator is disabled.                                      */
+const int* get_accumulator(const conn4_state* board) {
+    return (ACC_WIDTH > 0 ? ACCUMULATOR(board) : NULL);
+}
+
+
+/* Function: update_accumulator                                               */
+/*   Adds weights of feature to accumulator of board or subtracts them.       */
+/* Parameter(s):                                                              */
+/*   board   - board structure                                                */
+/*   weights - weights of feature                                             */
+/*   sign    - +1 to add feature, -1 to remove it                             */
+static void update_accumulator(conn4_state* board, const int* weights,
+        int sign) {
+    unsigned int i;
+    int* acc = ACCUMULATOR(board);
+
+    if (sign > 0) {
+        for (i = 0; i < ACC_WIDTH; ++i) {
+            acc[i] += weights[i];
+        }
+    } else {
+        for (i = 0; i < ACC_WIDTH; ++i) {
+            acc[i] -= weights[i];
+        }
+    }
+    return;
+}
+
+
+/* Function: refresh_accumulator                                              */
+/*   Computes accumulator of features of board from scratch.                  */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+static void refresh_accumulator(conn4_state* board) {
+    unsigned int column, row;
+
+    memcpy(ACCUMULATOR(board), ACC_BIAS, ACC_WIDTH * sizeof(int));
+    for (column = 0; column < COLS; ++column) {
+        for (row = 0; row < board->info[CHUNKS + column]; ++row) {
+            update_accumulator(board, ACC_ROW(column, row,
+                    (board->info[CELL_IND(column, row)] &
+                    CELL_MASK(column, row)) ? CELL_X : CELL_O), 1);
+        }
+    }
     return;
 }
 
@@ -80,22 +209,64 @@ unsigned int get_size(void) {
 }
 
 
+/* Function: get_engine                                                       */
+/* Returns:                                                                   */
+/*   Engine specialized for current dimensions (selected by                   */
+/*   set_dimensions()), or NULL if generic functions are used.                */
+const board_engine* get_engine(void) {
+    return ENGINE;
+}
+
+
+/* Pool of boards. All boards and their cell storage are allocated as one    */
+/* slab; free boards are kept in a stack of pointers.                         */
+struct conn4_pool_struct {
+    unsigned int count;     /* Total number of boards in pool */
+    unsigned int free;      /* Number of boards available for acquiring */
+    conn4_state* boards;    /* All boards of the pool */
+    unsigned char* storage; /* Cell storage of all boards */
+    conn4_state** stack;    /* Stack of free boards */
+};
+
+
+/* Function: board_bytes                                                      */
+/*   Number of bytes of cell storage (cells and heights of columns) needed    */
+/*   by one board of current dimensions.                                      */
+/* Returns:                                                                   */
+/*   Size of cell storage in bytes.                                           */
+unsigned int board_bytes(void) {
+    return BYTES;
+}
+
+
+/* Function: init_board                                                       */
+/*   Initializes an empty board on top of storage provided by caller. This    */
+/*   lets board be embedded by value or carved from arena. Such board must    */
+/*   not be passed to destruct_board().                                       */
+/* Parameter(s):                                                              */
+/*   board   - board structure                                                */
+/*   storage - at least board_bytes() bytes of memory owned by caller         */
+void init_board(conn4_state* board, unsigned char* storage) {
+    board->moves = 0;
+    board->info = storage;
+    memset(board->info, 0, CHUNKS + COLS);
+    if (ACC_WIDTH > 0) {
+        memcpy(ACCUMULATOR(board), ACC_BIAS, ACC_WIDTH * sizeof(int));
+    }
+    return;
+}
+
+
 /* Function: create_board                                                     */
-/*   Creates an empty board.                                                  */
+/*   Creates an empty board. Structure and its cell storage are allocated     */
+/*   by a single call to malloc().                                            */
 /* Returns:                                                                   */
 /*   Empty board, or NULL if memory allocation failed.                        */
 conn4_state* create_board(void) {
     conn4_state* board;
-    board = malloc(sizeof(board));
+    board = malloc(sizeof(*board) + BYTES);
     if (board != NULL) {
-        board->info = malloc(CHUNKS + COLS);
-        if (board->info != NULL) {
-            board->moves = 0;
-            memset(board->info, 0, CHUNKS + COLS);
-        } else {
-            free(board);
-            board = NULL;
-        }
+        init_board(board, (unsigned char*)(board + 1));
     }
     return board;
 }
@@ -106,49 +277,362 @@ conn4_state* create_board(void) {
 /* Parameter(s):                                                              */
 /*   board - board structure                                                  */
 void destruct_board(conn4_state* board) {
-    if (board != NULL) {
-        free(board->info);
-        free(board);
+    free(board);
+    return;
+}
+
+
+/* Function: board_copy                                                       */
+/*   Copies position of one board to another one. Storage of destination     */
+/*   board is reused, so no memory is allocated.                              */
+/* Parameter(s):                                                              */
+/*   dst - destination board                                                  */
+/*   src - source board                                                       */
+void board_copy(conn4_state* dst, const conn4_state* src) {
+    dst->moves = src->moves;
+    memcpy(dst->info, src->info, BYTES);
+    return;
+}
+
+
+/* Function: board_hash                                                       */
+/*   Computes 64-bit FNV-1a hash of position on board. Cell storage fully     */
+/*   determines position, so equal positions always have equal hashes.       */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   Hash of position.                                                        */
+unsigned long long board_hash(const conn4_state* board) {
+    unsigned int i;
+    unsigned long long hash = 14695981039346656037ULL;
+
+    for (i = 0; i < CHUNKS + COLS; ++i) {
+        hash = (hash ^ board->info[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+/* Function: read_bits                                                        */
+/*   Reads up to 56 consecutive bits of bit stream (least significant bit of  */
+/*   byte first).                                                             */
+/* Parameter(s):                                                              */
+/*   src - bit stream                                                         */
+/*   pos - position of the first bit                                          */
+/*   n   - number of bits (at most PACK_BITS)                                 */
+/* Returns:                                                                   */
+/*   Bits in the lowest bits of word.                                         */
+static unsigned long long read_bits(const unsigned char* src, unsigned int pos,
+        unsigned int n) {
+    unsigned long long word = 0;
+    unsigned int i, first = pos / CHAR_SIZE;
+
+    for (i = first; i < (pos + n + CHAR_SIZE - 1) / CHAR_SIZE; ++i) {
+        word |= (unsigned long long)src[i] << (CHAR_SIZE * (i - first));
+    }
+    return (word >> (pos & CHAR_SIZE_MASK)) & ((1ULL << n) - 1);
+}
+
+
+/* Function: write_bits                                                       */
+/*   Writes up to 56 consecutive bits to zeroed part of bit stream.           */
+/* Parameter(s):                                                              */
+/*   dst  - bit stream                                                        */
+/*   pos  - position of the first bit                                         */
+/*   bits - bits in the lowest bits of word (at most PACK_BITS of them)       */
+static void write_bits(unsigned char* dst, unsigned int pos,
+        unsigned long long bits) {
+    unsigned int i;
+
+    bits <<= (pos & CHAR_SIZE_MASK);
+    for (i = pos / CHAR_SIZE; bits != 0; ++i, bits >>= CHAR_SIZE) {
+        dst[i] |= (unsigned char)bits;
     }
     return;
 }
 
 
-/* Function: print_horizontal_line                                            */
-/*   Helper function that prints a horizontal separator between rows of board.*/
-/*   Used in print_board() function.                                          */
-void print_horizontal_line(void) {
-    int col;
-    for (col = 0; col < COLS; ++col) {
-        printf("+---");
+/* Function: packed_bytes                                                     */
+/*   Packed encoding stores every column in (rows + 1) bits, bottom cell     */
+/*   first: 1 for 'X' and 0 for 'O' disks, then marker bit 1 on top of the   */
+/*   column and zeros above it. It has no pointers, so it can be kept in any */
+/*   slab or file and copied by value.                                        */
+/* Returns:                                                                   */
+/*   Size of packed encoding of board of current dimensions in bytes.        */
+unsigned int packed_bytes(void) {
+    return (COLS * (ROWS + 1) + CHAR_SIZE - 1) / CHAR_SIZE;
+}
+
+
+/* Function: board_pack                                                       */
+/*   Encodes position of board (see packed_bytes()). Cells of column are     */
+/*   stored in the same order as in board, so they are copied by words.     */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   packed - where packed_bytes() bytes of encoding will be written          */
+void board_pack(const conn4_state* board, unsigned char* packed) {
+    unsigned int column, height, done, n, pos;
+    unsigned long long cells = 0, word = 0;
+
+    if (COLS * (ROWS + 1) <= 64) {
+        /* Small board: the whole board is packed within one word */
+        for (n = 0; n < CHUNKS; ++n) {
+            cells |= (unsigned long long)board->info[n] << (CHAR_SIZE * n);
+        }
+        for (column = 0; column < COLS; ++column) {
+            height = board->info[CHUNKS + column];
+            word |= (((cells >> CELL_POS(column, 0)) & ((1ULL << height) - 1))
+                    | (1ULL << height)) << (column * (ROWS + 1));
+        }
+        for (n = 0; n < packed_bytes(); ++n, word >>= CHAR_SIZE) {
+            packed[n] = (unsigned char)word;
+        }
+        return;
+    }
+    memset(packed, 0, packed_bytes());
+    for (column = 0; column < COLS; ++column) {
+        height = board->info[CHUNKS + column];
+        pos = column * (ROWS + 1);
+        for (done = 0; done < height; done += n) {
+            n = (height - done < PACK_BITS ? height - done : PACK_BITS);
+            write_bits(packed, pos + done,
+                    read_bits(board->info, CELL_POS(column, done), n));
+        }
+        /* Marker on top of column */
+        write_bits(packed, pos + height, 1);
     }
-    printf("+\n");
     return;
 }
 
 
-/* Function: print_board                                                      */
-/*   Prints board in readable ASCII format.                                   */
+/* Function: board_unpack                                                     */
+/*   Decodes position of board (see packed_bytes()). Number of moves is sum  */
+/*   of heights of columns.                                                   */
+/* Parameter(s):                                                              */
+/*   board  - board structure (of current dimensions)                         */
+/*   packed - packed encoding                                                 */
+void board_unpack(conn4_state* board, const unsigned char* packed) {
+    unsigned int column, height, done, n, pos;
+    unsigned long long bits, cells = 0, word = 0;
+
+    board->moves = 0;
+    if (COLS * (ROWS + 1) <= 64) {
+        /* Small board: the whole board is unpacked within one word */
+        for (n = 0; n < packed_bytes(); ++n) {
+            word |= (unsigned long long)packed[n] << (CHAR_SIZE * n);
+        }
+        for (column = 0; column < COLS; ++column) {
+            bits = (word >> (column * (ROWS + 1))) & ((2ULL << ROWS) - 1);
+            height = 63 - __builtin_clzll(bits);
+            cells |= (bits ^ (1ULL << height)) << CELL_POS(column, 0);
+            board->info[CHUNKS + column] = height;
+            board->moves += height;
+        }
+        for (n = 0; n < CHUNKS; ++n, cells >>= CHAR_SIZE) {
+            board->info[n] = (unsigned char)cells;
+        }
+        if (ACC_WIDTH > 0) {
+            refresh_accumulator(board);
+        }
+        return;
+    }
+    memset(board->info, 0, CHUNKS + COLS);
+    for (column = 0; column < COLS; ++column) {
+        pos = column * (ROWS + 1);
+        /* Height is position of the highest bit (marker) of column */
+        height = 0;
+        for (done = 0; done < ROWS + 1; done += n) {
+            n = (ROWS + 1 - done < PACK_BITS ? ROWS + 1 - done : PACK_BITS);
+            if ((bits = read_bits(packed, pos + done, n)) != 0) {
+                height = done + 63 - __builtin_clzll(bits);
+            }
+        }
+        for (done = 0; done < height; done += n) {
+            n = (height - done < PACK_BITS ? height - done : PACK_BITS);
+            write_bits(board->info, CELL_POS(column, done),
+                    read_bits(packed, pos + done, n));
+        }
+        board->info[CHUNKS + column] = height;
+        board->moves += height;
+    }
+    if (ACC_WIDTH > 0) {
+        refresh_accumulator(board);
+    }
+    return;
+}
+
+
+/* Function: create_pool                                                      */
+/*   Creates a pool of boards of current dimensions. Pool isn't synchronized, */
+/*   so every thread should use a pool of its own.                            */
+/* Parameter(s):                                                              */
+/*   count - number of boards in pool                                         */
+/* Returns:                                                                   */
+/*   New pool, or NULL if memory allocation failed.                           */
+conn4_pool* create_pool(unsigned int count) {
+    unsigned int i;
+    conn4_pool* pool = malloc(sizeof(*pool));
+
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->count = pool->free = count;
+    pool->boards = malloc(count * sizeof(*pool->boards));
+    pool->storage = malloc(count * BYTES);
+    pool->stack = malloc(count * sizeof(*pool->stack));
+    if (pool->boards == NULL || pool->storage == NULL || pool->stack == NULL) {
+        destruct_pool(pool);
+        return NULL;
+    }
+    for (i = 0; i < count; ++i) {
+        pool->boards[i].moves = 0;
+        pool->boards[i].info = pool->storage + i * BYTES;
+        pool->stack[i] = &pool->boards[i];
+    }
+    return pool;
+}
+
+
+/* Function: destruct_pool                                                    */
+/*   Destructs a pool and all its boards (release memory).                    */
+/* Parameter(s):                                                              */
+/*   pool - pool of boards                                                    */
+void destruct_pool(conn4_pool* pool) {
+    if (pool != NULL) {
+        free(pool->boards);
+        free(pool->storage);
+        free(pool->stack);
+        free(pool);
+    }
+    return;
+}
+
+
+/* Function: pool_acquire                                                     */
+/*   Takes an empty board from pool.                                          */
+/* Parameter(s):                                                              */
+/*   pool - pool of boards                                                    */
+/* Returns:                                                                   */
+/*   Empty board, or NULL if all boards of pool are in use.                   */
+conn4_state* pool_acquire(conn4_pool* pool) {
+    conn4_state* board;
+
+    if (pool->free == 0) {
+        return NULL;
+    }
+    board = pool->stack[--(pool->free)];
+    init_board(board, board->info);
+    return board;
+}
+
+
+/* Function: pool_release                                                     */
+/*   Returns a board back to pool it was acquired from.                       */
+/* Parameter(s):                                                              */
+/*   pool  - pool of boards                                                   */
+/*   board - board acquired from this pool                                    */
+void pool_release(conn4_pool* pool, conn4_state* board) {
+    pool->stack[(pool->free)++] = board;
+    return;
+}
+
+
+/* Buffer where frames of print_board() are built. It grows with dimensions */
+/* of board and is reused between calls.                                      */
+static char* frame = NULL;
+static unsigned int frame_size = 0;
+
+
+/* Function: format_horizontal_line                                           */
+/*   Helper function that writes a horizontal separator between rows of board */
+/*   to a buffer. Used in format_board() function.                            */
+/* Parameter(s):                                                              */
+/*   buf - where separator will be written                                    */
+/* Returns:                                                                   */
+/*   Number of written characters.                                            */
+static unsigned int format_horizontal_line(char* buf) {
+    unsigned int col, len = 0;
+    for (col = 0; col < COLS; ++col) {
+        memcpy(buf + len, "+---", 4);
+        len += 4;
+    }
+    memcpy(buf + len, "+\n", 2);
+    return len + 2;
+}
+
+
+/* Function: frame_bytes                                                      */
+/* Returns:                                                                   */
+/*   Maximal size of text of board in readable ASCII format (including       */
+/*   terminating null character).                                             */
+unsigned int frame_bytes(void) {
+    /* Header is at most 11 characters per column (10 digits and space), all  */
+    /* other lines are 4 characters per column plus border and line feed.     */
+    return 2 + 11 * COLS + 1 + (2 * ROWS + 1) * (4 * COLS + 2) + 1;
+}
+
+
+/* Function: format_board                                                     */
+/*   Writes board in readable ASCII format to a buffer. Frame starts with an */
+/*   empty line and a header of column numbers, then every row of the board  */
+/*   (top row first) is followed by a horizontal separator. Cell of row i    */
+/*   (counted from top starting with 0) and column c occupies line 4+2*i and */
+/*   position 4*c+3 of the frame (both counted from 1).                       */
 /* Parameter(s):                                                              */
 /*   board - board structure                                                  */
-void print_board(conn4_state* board) {
+/*   buf   - where text will be written, at least frame_bytes() characters    */
+/* Returns:                                                                   */
+/*   Number of written characters (without terminating null character).      */
+unsigned int format_board(conn4_state* board, char* buf) {
     int row, col;
+    unsigned int len = 0;
 
     /* Print header (column numbers) */
-    printf("\n");
-    for (int col = 0; col < get_cols(); ++col) {
-    	printf("%3d ", col + 1);
+    buf[len++] = '\n';
+    for (col = 0; col < COLS; ++col) {
+        len += sprintf(buf + len, "%3d ", col + 1);
     }
-    printf("\n");
+    buf[len++] = '\n';
 
-    print_horizontal_line();
+    len += format_horizontal_line(buf + len);
     for (row = ROWS - 1; row >= 0; --row) {
         for (col = 0; col < COLS; ++col) {
-            printf("| %c ", get_cell(board, col, row));
+            buf[len++] = '|';
+            buf[len++] = ' ';
+            buf[len++] = get_cell(board, col, row);
+            buf[len++] = ' ';
+        }
+        buf[len++] = '|';
+        buf[len++] = '\n';
+        len += format_horizontal_line(buf + len);
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+
+/* Function: print_board                                                      */
+/*   Prints board in readable ASCII format. Whole frame is built in a buffer */
+/*   and written to standard output at once.                                  */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+void print_board(conn4_state* board) {
+    char* buf;
+    unsigned int len;
+
+    TRACE_BEGIN("print_board");
+    if (frame_size < frame_bytes()) {
+        buf = realloc(frame, frame_bytes());
+        if (buf == NULL) {
+            TRACE_END("print_board");
+            return;
         }
-        printf("|\n");
-        print_horizontal_line();
+        frame = buf;
+        frame_size = frame_bytes();
     }
+    len = format_board(board, frame);
+    fwrite(frame, 1, len, stdout);
+    TRACE_END("print_board");
     return;
 }
 
@@ -191,6 +675,10 @@ int set_cell(conn4_state* board, unsigned int column, char disk) {
         board->info[CELL_IND(column, height)] |= CELL_MASK(column, height);
     }
     /* If disk is 'O', set 0 bit; but bit is already 0, so do nothing. */
+    /* Add feature of new disk to accumulator */
+    if (ACC_WIDTH > 0) {
+        update_accumulator(board, ACC_ROW(column, height, disk), 1);
+    }
     /* Increase height of selected column and return success code */
     ++(board->info[CHUNKS+column]);
     ++(board->moves);
@@ -211,6 +699,12 @@ void unset_cell(conn4_state* board, unsigned int column) {
     if (height > 0) {
         --(board->moves);
         board->info[CHUNKS+column] = (0xff & --height);
+        /* Remove feature of disk from accumulator */
+        if (ACC_WIDTH > 0) {
+            update_accumulator(board, ACC_ROW(column, height,
+                    (board->info[CELL_IND(column, height)] &
+                    CELL_MASK(column, height)) ? CELL_X : CELL_O), -1);
+        }
         /* Clear coresponding bit */
         board->info[CELL_IND(column, height)] &= ~CELL_MASK(column, height);
     }
@@ -372,6 +866,10 @@ int check_win(conn4_state* board, unsigned int column) {
     /* Determine row coordinate of the last move */
     unsigned int row = get_height(board, column) - 1;
 
+    /* Engine specialized for these dimensions answers at once */
+    if (ENGINE != NULL) {
+        return ENGINE->check_win(board, column);
+    }
     /* Check four directions: vertical, horizontal and two diagonals */
     if (check_win_vert(board, column, row)) {
         return 1;   /* WIN!!! */
@@ -390,4 +888,153 @@ int check_win(conn4_state* board, unsigned int column) {
 }
 
 
+/* Function: threat_bits                                                      */
+/*   Finds cells that complete alignment of four disks of one player on      */
+/*   bitboard (column c takes bits c*height ... c*height+height-2, the top   */
+/*   bit of every column is spare, so that shifts never wrap to neighboring  */
+/*   column).                                                                 */
+/* Parameter(s):                                                              */
+/*   bits   - disks of player                                                 */
+/*   height - number of bits per column (rows + 1)                            */
+/* Returns:                                                                   */
+/*   Cells (empty or not, on board or not) completing alignment.              */
+static unsigned long long threat_bits(unsigned long long bits,
+        unsigned int height) {
+    /* Vertical: three disks right below */
+    unsigned long long r = (bits << 1) & (bits << 2) & (bits << 3);
+    unsigned long long t;
+    unsigned int d, i;
+    /* Horizontal, rising and falling diagonal */
+    const unsigned int dirs[3] = {height, height + 1, height - 1};
+
+    for (i = 0; i < 3; ++i) {
+        d = dirs[i];
+        /* Two disks to the left: cell is third or fourth in a row */
+        t = (bits << d) & (bits << 2 * d);
+        r |= t & (bits << 3 * d);
+        r |= t & (bits >> d);
+        /* Two disks to the right: cell is first or second in a row */
+        t = (bits >> d) & (bits >> 2 * d);
+        r |= t & (bits << d);
+        r |= t & (bits >> 3 * d);
+    }
+    return r;
+}
+
+
+/* Function: count_run                                                        */
+/*   Counts disks of player next to cell in one direction.                    */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of cell                                                  */
+/*   row    - row of cell                                                     */
+/*   dc     - step of column (-1, 0, +1)                                      */
+/*   dr     - step of row (-1, 0, +1)                                         */
+/*   disk   - disk of player                                                  */
+/* Returns:                                                                   */
+/*   Number of disks of player in a row starting from neighbor of cell.      */
+static int count_run(const conn4_state* board, int column, int row, int dc,
+        int dr, char disk) {
+    int count = 0;
+
+    for (column += dc, row += dr; column >= 0 && column < (int)COLS &&
+            row >= 0 && row < (int)ROWS; column += dc, row += dr) {
+        if (get_cell((conn4_state*)board, column, row) != disk) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+
+/* Function: completes                                                        */
+/*   Checks if disk put at empty cell would complete alignment of four.       */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of cell                                                  */
+/*   row    - row of cell                                                     */
+/*   disk   - disk of player                                                  */
+/* Returns:                                                                   */
+/*   1 if alignment is completed, 0 otherwise.                                */
+static int completes(const conn4_state* board, int column, int row,
+        char disk) {
+    return (count_run(board, column, row, 0, -1, disk) >= COUNT_TO_WIN - 1 ||
+            count_run(board, column, row, -1, 0, disk) +
+            count_run(board, column, row, +1, 0, disk) >= COUNT_TO_WIN - 1 ||
+            count_run(board, column, row, -1, -1, disk) +
+            count_run(board, column, row, +1, +1, disk) >= COUNT_TO_WIN - 1 ||
+            count_run(board, column, row, -1, +1, disk) +
+            count_run(board, column, row, +1, -1, disk) >= COUNT_TO_WIN - 1);
+}
+
+
+/* Function: get_win_masks                                                    */
+/*   Finds columns where either player wins by the next disk and empty cells  */
+/*   where either player would complete alignment, without changing board.   */
+/*   Boards that fit in 64-bit bitboard are answered by a few shifts of       */
+/*   bitboards of both players; on larger boards playable cells are checked  */
+/*   one by one and threats aren't found. Winning moves are found on boards  */
+/*   of at most WIN_MASK_COLUMNS columns.                                     */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   masks - where winning moves and threats will be written                  */
+/* Returns:                                                                   */
+/*   1 if threats are found, 0 otherwise (threats are 0).                     */
+int get_win_masks(const conn4_state* board, win_masks* masks) {
+    const unsigned int h = ROWS + 1;
+    const unsigned long long column_bits = (1ULL << ROWS) - 1;
+    unsigned long long cells = 0, x = 0, all = 0, on_board = 0, top = 0;
+    unsigned long long free_cells, w;
+    unsigned int column, height, n;
+
+    if (ENGINE != NULL) {
+        return ENGINE->get_win_masks(board, masks);
+    }
+    masks->wins[0] = masks->wins[1] = 0;
+    masks->threats[0] = masks->threats[1] = 0;
+
+    if (COLS * h > 64) {
+        for (column = 0; column < COLS && column < WIN_MASK_COLUMNS;
+                ++column) {
+            height = board->info[CHUNKS + column];
+            if (height < ROWS) {
+                masks->wins[0] |= (unsigned long long)completes(board,
+                        column, height, CELL_X) << column;
+                masks->wins[1] |= (unsigned long long)completes(board,
+                        column, height, CELL_O) << column;
+            }
+        }
+        return 0;
+    }
+
+    /* Bitboards of 'X' disks, of all disks and of the lowest empty cells */
+    for (n = 0; n < CHUNKS; ++n) {
+        cells |= (unsigned long long)board->info[n] << (CHAR_SIZE * n);
+    }
+    for (column = 0; column < COLS; ++column) {
+        height = board->info[CHUNKS + column];
+        x |= ((cells >> CELL_POS(column, 0)) & ((1ULL << height) - 1))
+                << (column * h);
+        all |= ((1ULL << height) - 1) << (column * h);
+        top |= (1ULL << height) << (column * h);
+        on_board |= column_bits << (column * h);
+    }
+    free_cells = on_board & ~all;
+    masks->threats[0] = threat_bits(x, h) & free_cells;
+    masks->threats[1] = threat_bits(all ^ x, h) & free_cells;
+
+    /* Winning moves are threats on the lowest empty cells */
+    top &= on_board;
+    for (n = 0; n < 2; ++n) {
+        w = masks->threats[n] & top;
+        for (column = 0; w != 0; ++column, w >>= h) {
+            masks->wins[n] |= (unsigned long long)((w & column_bits) != 0)
+                    << column;
+        }
+    }
+    return 1;
+}
+
+
 #endif /* _CONN4_C_ */
@@ -20,6 +20,16 @@
 #define CELL_X      'X'
 #define CELL_O      'O'
 
+/* Storage class of per-thread variables. C99 has no thread-local storage,   */
+/* so extension of GCC and Clang (__thread) is used, or keyword of C11.      */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL    _Thread_local
+#elif defined(__GNUC__)
+#define THREAD_LOCAL    __thread
+#else
+#error "Compiler with thread-local storage (C11, GCC or Clang) is required"
+#endif
+
 
 typedef struct conn4_struct {
     unsigned int moves; /* Moves made on this board */
@@ -33,11 +43,23 @@ typedef struct conn4_struct {
                         /* Cells are stored in one-dimensional array 8 cells  */
                         /* per chunk of array, and heights of columns are     */
                         /* stored in same array after all cells.              */
+                        /* Storage is owned either by the board itself        */
+                        /* (create_board()), by a pool or by the caller       */
+                        /* (init_board()).                                    */
 } conn4_state;
 
 /* Set rows/columns dimensions of game board.                                 */
 void set_dimensions(unsigned int columns, unsigned int rows);
 
+/* Enables accumulator of features updated by set_cell()/unset_cell().       */
+void set_accumulator(unsigned int width, const int* bias, const int* features);
+
+/* Get width of accumulator of features (0 if accumulator is disabled).      */
+unsigned int accumulator_width(void);
+
+/* Get accumulator of features of board (NULL if accumulator is disabled).   */
+const int* get_accumulator(const conn4_state* board);
+
 /* Get vertical dimension (number of rows) of game board.                     */
 unsigned int get_rows(void);
 
@@ -47,15 +69,57 @@ unsigned int get_cols(void);
 /* Get full size of game board (number of cells).                             */
 unsigned int get_size(void);
 
+/* Get number of bytes of cell storage needed by one board.                   */
+unsigned int board_bytes(void);
+
 /* Create an empty board.                                                     */
 conn4_state* create_board(void);
 
 /* Destruct a board (release memory).                                         */
 void destruct_board(conn4_state* board);
 
+/* Initialize an empty board on top of storage provided by caller.            */
+void init_board(conn4_state* board, unsigned char* storage);
+
+/* Copy position of one board to another one without memory allocation.       */
+void board_copy(conn4_state* dst, const conn4_state* src);
+
+/* Computes hash of position on board.                                        */
+unsigned long long board_hash(const conn4_state* board);
+
+/* Get number of bytes of packed (pointer-free) encoding of board.            */
+unsigned int packed_bytes(void);
+
+/* Encode position of board into packed_bytes() bytes.                        */
+void board_pack(const conn4_state* board, unsigned char* packed);
+
+/* Decode position of board from packed encoding.                             */
+void board_unpack(conn4_state* board, const unsigned char* packed);
+
+/* Pool of preallocated boards that can be acquired and released quickly.     */
+typedef struct conn4_pool_struct conn4_pool;
+
+/* Create a pool of selected number of boards.                                */
+conn4_pool* create_pool(unsigned int count);
+
+/* Destruct a pool and all its boards (release memory).                       */
+void destruct_pool(conn4_pool* pool);
+
+/* Take an empty board from pool.                                             */
+conn4_state* pool_acquire(conn4_pool* pool);
+
+/* Return a board back to pool.                                               */
+void pool_release(conn4_pool* pool, conn4_state* board);
+
 /* Prints board in readable ASCII format.                                     */
 void print_board(conn4_state* board);
 
+/* Gets maximal size of text of board in readable ASCII format.               */
+unsigned int frame_bytes(void);
+
+/* Writes board in readable ASCII format to a buffer.                         */
+unsigned int format_board(conn4_state* board, char* buf);
+
 /* Gets type of disk at selected cell.                                        */
 char get_cell(conn4_state* board, unsigned int column, unsigned int row);
 
@@ -71,5 +135,21 @@ int get_height(conn4_state* board, unsigned int column);
 /* Checks if the last move brings a victory.                                  */
 int check_win(conn4_state* board, unsigned int column);
 
+/* Maximal number of columns of board for which winning moves are given by   */
+/* get_win_masks()                                                            */
+#define WIN_MASK_COLUMNS    64
+
+/* Immediate wins and threats of both players (index 0 is 'X', 1 is 'O').    */
+typedef struct {
+    unsigned long long wins[2];     /* Columns where next disk of player wins */
+                                    /* (bit c for column c) */
+    unsigned long long threats[2];  /* Empty cells that complete alignment of */
+                                    /* player (bit column*(rows+1)+row) */
+} win_masks;
+
+/* Finds winning moves and threats of both players without changing board;   */
+/* returns 1 if threats are found too (board fits in 64-bit bitboard).       */
+int get_win_masks(const conn4_state* board, win_masks* masks);
+
 
 #endif /* _CONN4_H_ */
@@ -0,0 +1,87 @@
+#ifndef _DATASET_C_
+#define _DATASET_C_
+
+#include "dataset.h"
+#include <stddef.h>     /* offsetof() */
+#include <string.h>     /* memcpy(), memcmp(), memset() */
+
+
+/* Function: record_bytes                                                     */
+/* Returns:                                                                   */
+/*   Size of record (packed board and label) of current dimensions.          */
+unsigned int record_bytes(void) {
+    return packed_bytes() + sizeof(dataset_label);
+}
+
+
+/* Function: dataset_create                                                   */
+/*   Creates dataset file for board of current dimensions. Header is written */
+/*   with zero count, which is corrected by dataset_finish().                 */
+/* Parameter(s):                                                              */
+/*   filename - name of file                                                  */
+/* Returns:                                                                   */
+/*   File ready for writing of records, or NULL if it can't be created.      */
+FILE* dataset_create(const char* filename) {
+    dataset_header header;
+    FILE* file = fopen(filename, "wb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DATASET_MAGIC, sizeof(header.magic));
+    header.columns = get_cols();
+    header.rows = get_rows();
+    header.record_bytes = record_bytes();
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+
+/* Function: dataset_finish                                                   */
+/*   Writes final number of records to header and closes dataset file.        */
+/* Parameter(s):                                                              */
+/*   file  - file created by dataset_create()                                 */
+/*   count - number of records written                                        */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise.                                            */
+int dataset_finish(FILE* file, unsigned long long count) {
+    int ok = (fseek(file, offsetof(dataset_header, count), SEEK_SET) == 0 &&
+            fwrite(&count, sizeof(count), 1, file) == 1);
+    return (fclose(file) == 0 && ok);
+}
+
+
+/* Function: dataset_open                                                     */
+/*   Opens dataset file and sets dimensions of board to dimensions of its    */
+/*   positions.                                                               */
+/* Parameter(s):                                                              */
+/*   filename - name of file                                                  */
+/*   header   - where header of file will be written                          */
+/* Returns:                                                                   */
+/*   File positioned at the first record, or NULL if it isn't valid dataset. */
+FILE* dataset_open(const char* filename, dataset_header* header) {
+    FILE* file = fopen(filename, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fread(header, sizeof(*header), 1, file) != 1 ||
+            memcmp(header->magic, DATASET_MAGIC, sizeof(header->magic)) != 0 ||
+            header->columns < MIN_COLUMNS || header->rows < MIN_ROWS) {
+        fclose(file);
+        return NULL;
+    }
+    set_dimensions(header->columns, header->rows);
+    if (header->record_bytes != record_bytes()) {
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+
+#endif /* _DATASET_C_ */
@@ -0,0 +1,47 @@
+#ifndef _DATASET_H_
+#define _DATASET_H_
+
+#include "conn4.h"
+#include <stdio.h>
+
+
+/* Signature of dataset file                                                  */
+#define DATASET_MAGIC   "CONN4DS1"
+/* Score of search in label is multiplied by this factor (score is -1...+1)   */
+#define DATASET_SCALE   10000
+
+
+/* Header of dataset file. Records of labeled positions follow header: each  */
+/* record is packed board (packed_bytes() bytes, see board_pack()) followed  */
+/* by label.                                                                  */
+typedef struct {
+    char magic[8];              /* DATASET_MAGIC */
+    unsigned int columns;       /* Dimensions of board */
+    unsigned int rows;
+    unsigned int record_bytes;  /* Size of record */
+    unsigned int reserved;
+    unsigned long long count;   /* Number of records */
+} dataset_header;
+
+/* Label of position, both values for player to move                         */
+typedef struct {
+    signed char result;         /* Result of game: +1 win, 0 draw, -1 loss */
+    unsigned char depth;        /* Depth of search that gave score */
+    short score;                /* Score of search times DATASET_SCALE */
+} dataset_label;
+
+
+/* Size of record of board of current dimensions.                             */
+unsigned int record_bytes(void);
+
+/* Creates dataset file for board of current dimensions (count is unknown).  */
+FILE* dataset_create(const char* filename);
+
+/* Writes final number of records to header and closes dataset file.          */
+int dataset_finish(FILE* file, unsigned long long count);
+
+/* Opens dataset file for reading records and sets dimensions of board.      */
+FILE* dataset_open(const char* filename, dataset_header* header);
+
+
+#endif /* _DATASET_H_ */
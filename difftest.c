@@ -0,0 +1,255 @@
+#ifndef _DIFFTEST_C_
+#define _DIFFTEST_C_
+
+#include "conn4.h"
+#include "computer.h"
+#include "kernels.h"
+#include "reference.h"
+#include <stdio.h>      /* printf(), fprintf() */
+#include <stdlib.h>     /* strtoul(), strtoull(), EXIT_* */
+#include <string.h>     /* memcmp() */
+
+
+/* Default number of random games (fast enough to run on every build)         */
+#define DEFAULT_GAMES   2000
+/* Default seed of the first game                                             */
+#define DEFAULT_SEED    1
+/* Largest dimensions of random boards                                        */
+#define TEST_COLUMNS    20
+#define TEST_ROWS       16
+/* Probability (1/N) that the last move is taken back instead of a new move   */
+#define TAKEBACK        8
+/* Probability (1/N) that board has dimensions of specialized engine         */
+#define SPECIALIZED     4
+/* Probability (1/N) that board is wider than MAX_COLUMNS and than          */
+/* WIN_MASK_COLUMNS, where engine takes its paths for wide boards            */
+#define WIDE            32
+/* Dimensions of wide boards (columns are added to WIN_MASK_COLUMNS)        */
+#define WIDE_COLUMNS    8
+#define WIDE_ROWS       8
+
+
+/* Names of kernel variants checked against reference                         */
+static const char* variants[] = {"scalar", "sse42", "avx2", "avx512"};
+#define VARIANTS    (sizeof(variants) / sizeof(variants[0]))
+
+/* Dimensions of specialized engines (see engine.h)                           */
+static const unsigned int engines[][2] = {{7, 6}, {8, 7}, {9, 7}};
+#define ENGINES     (sizeof(engines) / sizeof(engines[0]))
+
+
+/* State of random game being checked                                         */
+typedef struct {
+    unsigned long long seed;    /* Seed of game */
+    unsigned long long rng;     /* State of random number generator */
+    conn4_state* board;         /* Board under test */
+    ref_board* ref;             /* Reference board */
+    unsigned int* moves;        /* Moves made so far */
+    unsigned int count;         /* Number of moves made so far */
+} diff_game;
+
+
+/* Function: next_random                                                      */
+/*   Generates next pseudorandom number (splitmix64).                         */
+/* Parameter(s):                                                              */
+/*   rng - state of generator                                                 */
+/* Returns:                                                                   */
+/*   Pseudorandom 64-bit number.                                              */
+static unsigned long long next_random(unsigned long long* rng) {
+    unsigned long long z = (*rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+/* Function: report                                                           */
+/*   Prints first divergence of optimized engine from reference with the      */
+/*   sequence of moves that leads to it and the command that reproduces it.   */
+/* Parameter(s):                                                              */
+/*   game - game being checked                                                */
+/*   what - description of divergent result                                   */
+static void report(const diff_game* game, const char* what) {
+    unsigned int i;
+
+    printf("Divergence on %ux%u board after %u moves: %s\n",
+            get_cols(), get_rows(), game->count, what);
+    printf("Moves:");
+    for (i = 0; i < game->count; ++i) {
+        printf(" %u", game->moves[i] + 1);
+    }
+    printf("\nReproduce with: difftest 1 %llu\n", game->seed);
+}
+
+
+/* Function: compare                                                          */
+/*   Compares every result of optimized engine with reference after the last */
+/*   move.                                                                    */
+/* Parameter(s):                                                              */
+/*   game   - game being checked                                              */
+/*   column - column of the last move                                         */
+/* Returns:                                                                   */
+/*   1 if results are identical, 0 otherwise (divergence is reported).       */
+static int compare(diff_game* game, unsigned int column) {
+    static const char disks[2] = {CELL_X, CELL_O};
+    char what[128];
+    unsigned int c, r, i;
+    int count, ref_count, move = -1, ref_move = -1;
+    float est, ref_est;
+    board_kernels saved = kernels;
+    const board_kernels* variant;
+
+    for (c = 0; c < get_cols(); ++c) {
+        for (r = 0; r < get_rows(); ++r) {
+            if (get_cell(game->board, c, r) != ref_get_cell(game->ref, c, r)) {
+                sprintf(what, "get_cell(%u, %u) is '%c', expected '%c'",
+                        c, r, get_cell(game->board, c, r),
+                        ref_get_cell(game->ref, c, r));
+                report(game, what);
+                return 0;
+            }
+        }
+    }
+    for (c = 0; c < get_cols(); ++c) {
+        if (is_local(game->board, c) != ref_is_local(game->ref, c)) {
+            sprintf(what, "is_local(%u) is %d, expected %d", c,
+                    is_local(game->board, c), ref_is_local(game->ref, c));
+            report(game, what);
+            return 0;
+        }
+    }
+    if (check_win(game->board, column) != ref_check_win(game->ref, column)) {
+        sprintf(what, "check_win(%u) is %d, expected %d", column,
+                check_win(game->board, column),
+                ref_check_win(game->ref, column));
+        report(game, what);
+        return 0;
+    }
+    for (i = 0; i < 2; ++i) {
+        count = count_win_moves(game->board, disks[i], &move);
+        ref_count = ref_count_win_moves(game->ref, disks[i], &ref_move);
+        if (count != ref_count || (count > 0 && move != ref_move)) {
+            sprintf(what, "count_win_moves('%c') is %d (move %d), "
+                    "expected %d (move %d)", disks[i], count, move,
+                    ref_count, ref_move);
+            report(game, what);
+            return 0;
+        }
+    }
+    ref_est = ref_eval(game->ref, column);
+    for (i = 0; i < VARIANTS; ++i) {
+        if ((variant = get_kernels(variants[i])) == NULL) {
+            continue;   /* Not supported by this processor */
+        }
+        kernels = *variant;
+        est = eval(game->board, column);
+        kernels = saved;
+        if (memcmp(&est, &ref_est, sizeof(float)) != 0) {
+            sprintf(what, "eval(%u) with %s kernels is %.9g, expected %.9g",
+                    column, variants[i], est, ref_est);
+            report(game, what);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/* Function: play                                                             */
+/*   Plays random game on random board (with occasional takebacks) and       */
+/*   compares optimized engine with reference after every move. Some boards  */
+/*   are wide (see WIDE), so that paths of engine for them are compared too. */
+/* Parameter(s):                                                              */
+/*   seed - seed of game                                                      */
+/* Returns:                                                                   */
+/*   Number of checked positions, or 0 if divergence is found.                */
+static unsigned long play(unsigned long long seed) {
+    diff_game game;
+    unsigned long checked = 0;
+    unsigned int column, engine;
+    char disk;
+    int over = 0;
+
+    game.seed = game.rng = seed;
+    if (next_random(&game.rng) % WIDE == 0) {
+        set_dimensions(WIN_MASK_COLUMNS + 1 + next_random(&game.rng)
+                    % WIDE_COLUMNS,
+                MIN_ROWS + next_random(&game.rng) % (WIDE_ROWS - MIN_ROWS + 1));
+    } else if (next_random(&game.rng) % SPECIALIZED == 0) {
+        engine = next_random(&game.rng) % ENGINES;
+        set_dimensions(engines[engine][0], engines[engine][1]);
+    } else {
+        set_dimensions(MIN_COLUMNS + next_random(&game.rng)
+                    % (TEST_COLUMNS - MIN_COLUMNS + 1),
+                MIN_ROWS + next_random(&game.rng) % (TEST_ROWS - MIN_ROWS + 1));
+    }
+    game.board = create_board();
+    game.ref = ref_create(get_cols(), get_rows());
+    game.moves = malloc(get_size() * sizeof(unsigned int));
+    game.count = 0;
+
+    while (!over && game.count < get_size()) {
+        if (game.count > 0 && next_random(&game.rng) % TAKEBACK == 0) {
+            column = game.moves[--game.count];
+            unset_cell(game.board, column);
+            ref_unset_cell(game.ref, column);
+            if (game.count == 0) {
+                continue;   /* Nothing to compare on empty board */
+            }
+            column = game.moves[game.count - 1];
+        } else {
+            do {
+                column = next_random(&game.rng) % get_cols();
+            } while (get_height(game.board, column) == get_rows());
+            disk = (game.count % 2 == 0 ? CELL_X : CELL_O);
+            set_cell(game.board, column, disk);
+            ref_set_cell(game.ref, column, disk);
+            game.moves[game.count++] = column;
+            over = ref_check_win(game.ref, column);
+        }
+        if (!compare(&game, column)) {
+            checked = 0;
+            break;
+        }
+        ++checked;
+    }
+
+    free(game.moves);
+    ref_destruct(game.ref);
+    destruct_board(game.board);
+    return checked;
+}
+
+
+/* Function: main                                                             */
+/*   Compares optimized engine with reference implementation on random games. */
+/*   Game i is played with seed (seed + i), so any divergence is reproduced   */
+/*   by single game with reported seed.                                       */
+/*   Usage: difftest [games] [seed]                                           */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    unsigned long games = DEFAULT_GAMES, game, checked, total = 0;
+    unsigned long long seed = DEFAULT_SEED;
+
+    if (argc > 1) {
+        games = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        seed = strtoull(argv[2], NULL, 10);
+    }
+
+    for (game = 0; game < games; ++game) {
+        if ((checked = play(seed + game)) == 0) {
+            return EXIT_FAILURE;
+        }
+        total += checked;
+    }
+
+    printf("%lu games, %lu positions: no divergence\n", games, total);
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _DIFFTEST_C_ */
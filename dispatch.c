@@ -0,0 +1,138 @@
+#ifndef _DISPATCH_C_
+#define _DISPATCH_C_
+
+#include "kernels.h"
+#include <string.h>     /* memset(), strcmp() */
+
+
+/* Macros: Initializer of table of kernels of selected variant               */
+#define KERNEL_TABLE(variant) \
+    { #variant, count_open_##variant, count_threats_##variant, \
+      has_win_##variant, dot_clipped_##variant }
+
+/* All variants of kernels, from the fastest to the most portable one        */
+static const board_kernels variants[] = {
+    KERNEL_TABLE(avx512),
+    KERNEL_TABLE(avx2),
+    KERNEL_TABLE(sse42),
+    KERNEL_TABLE(scalar)
+};
+
+/* Number of variants of kernels                                              */
+#define VARIANTS    (sizeof(variants) / sizeof(variants[0]))
+
+board_kernels kernels = KERNEL_TABLE(scalar);
+
+
+/* Function: supported                                                        */
+/*   Checks if processor supports instruction set of selected variant.        */
+/* Parameter(s):                                                              */
+/*   name - name of variant                                                   */
+/* Returns:                                                                   */
+/*   1 if supported, 0 otherwise.                                             */
+static int supported(const char* name) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (strcmp(name, "avx512") == 0) {
+        return __builtin_cpu_supports("avx512f") &&
+                __builtin_cpu_supports("avx512bw");
+    }
+    if (strcmp(name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (strcmp(name, "sse42") == 0) {
+        return __builtin_cpu_supports("sse4.2");
+    }
+#endif
+    return (strcmp(name, "scalar") == 0);
+}
+
+
+/* Function: get_kernels                                                      */
+/*   Gets kernels of selected instruction set.                                */
+/* Parameter(s):                                                              */
+/*   name - name of instruction set (avx512, avx2, sse42 or scalar)           */
+/* Returns:                                                                   */
+/*   Table of kernels, or NULL if processor doesn't support instruction set.  */
+const board_kernels* get_kernels(const char* name) {
+    unsigned int i;
+
+    for (i = 0; i < VARIANTS; ++i) {
+        if (strcmp(variants[i].name, name) == 0) {
+            return (supported(name) ? &variants[i] : NULL);
+        }
+    }
+    return NULL;
+}
+
+
+/* Function: init_kernels                                                     */
+/*   Detects instruction sets supported by processor and selects the fastest  */
+/*   variant of kernels.                                                      */
+/* Returns:                                                                   */
+/*   Name of selected variant.                                                */
+const char* init_kernels(void) {
+    unsigned int i;
+
+    for (i = 0; i < VARIANTS; ++i) {
+        if (supported(variants[i].name)) {
+            kernels = variants[i];
+            break;
+        }
+    }
+    return kernels.name;
+}
+
+
+/* Function: board_to_grid                                                    */
+/*   Fills padded grid of disks of selected player and heights of columns.    */
+/* Parameter(s):                                                              */
+/*   board   - board structure                                                */
+/*   disk    - player's disk type                                             */
+/*   grid    - at least GRID_BYTES(get_cols(),get_rows()) bytes               */
+/*   heights - at least get_cols() bytes                                      */
+void board_to_grid(conn4_state* board, char disk, unsigned char* grid,
+        unsigned char* heights) {
+    unsigned int column, row;
+
+    memset(grid, 0, GRID_BYTES(get_cols(), get_rows()));
+    for (column = 0; column < get_cols(); ++column) {
+        heights[column] = get_height(board, column);
+        for (row = 0; row < heights[column]; ++row) {
+            grid[GRID_POS(get_cols(), column, row)] =
+                    (get_cell(board, column, row) == disk);
+        }
+    }
+    return;
+}
+
+
+/* Function: board_to_grids                                                   */
+/*   Fills padded grids of disks of both players and heights of columns by   */
+/*   one pass over board.                                                     */
+/* Parameter(s):                                                              */
+/*   board   - board structure                                                */
+/*   grid_x  - at least GRID_BYTES(get_cols(),get_rows()) bytes for 'X'       */
+/*   grid_o  - the same for 'O'                                               */
+/*   heights - at least get_cols() bytes                                      */
+void board_to_grids(conn4_state* board, unsigned char* grid_x,
+        unsigned char* grid_o, unsigned char* heights) {
+    unsigned int column, row, pos;
+    unsigned char x;
+
+    memset(grid_x, 0, GRID_BYTES(get_cols(), get_rows()));
+    memset(grid_o, 0, GRID_BYTES(get_cols(), get_rows()));
+    for (column = 0; column < get_cols(); ++column) {
+        heights[column] = get_height(board, column);
+        for (row = 0; row < heights[column]; ++row) {
+            pos = GRID_POS(get_cols(), column, row);
+            x = (get_cell(board, column, row) == CELL_X);
+            grid_x[pos] = x;
+            grid_o[pos] = !x;
+        }
+    }
+    return;
+}
+
+
+#endif /* _DISPATCH_C_ */
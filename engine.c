@@ -0,0 +1,358 @@
+#ifndef _ENGINE_C_
+#define _ENGINE_C_
+
+/* This file is compiled once per specialized size of board with             */
+/* ENGINE_COLUMNS and ENGINE_ROWS set to its dimensions, so that every loop  */
+/* below has constant bounds and compiler unrolls it and folds arithmetic   */
+/* of cell positions. Boards whose bitboard with a spare bit on top of every */
+/* column fits in 64 bits are answered by shifts of bitboards; larger ones   */
+/* by loops over cells and padded grid (see kernels.h).                       */
+
+#include "engine.h"
+#include "kernels.h"
+#include <string.h>     /* memset() */
+
+
+/* Macros: Appends dimensions to name of function                             */
+#define ENGINE_PASTE(name,columns,rows) name##_##columns##x##rows
+#define ENGINE_EXPAND(name,columns,rows)    ENGINE_PASTE(name,columns,rows)
+#define ENGINE(name)    ENGINE_EXPAND(name,ENGINE_COLUMNS,ENGINE_ROWS)
+
+/* Dimensions of board                                                        */
+#define COLS            ENGINE_COLUMNS
+#define ROWS            ENGINE_ROWS
+
+/* Layout of cell storage, the same as in conn4.c: cells in column-major     */
+/* order 8 per chunk, followed by heights of columns                          */
+#define CHUNKS          ((COLS * ROWS + 7) / 8)
+#define CELL_POS(column,row)    ((column) * ROWS + (row))
+#define HEIGHT(board,column)    ((board)->info[CHUNKS + (column)])
+
+/* Bits per column of bitboard (the top one is spare) and cells of column    */
+#define BITS            (ROWS + 1)
+#define COLUMN_BITS     ((1ULL << ROWS) - 1)
+
+/* Macros: Checks if board fits in bitboard                                   */
+#define BITBOARD        (COLS * BITS <= 64)
+
+#if COLS * ROWS > 64
+#error "Cells of specialized board must fit in 64 bits"
+#endif
+
+
+/* Function: load_disks                                                       */
+/*   Collects disks of board in storage order (bit CELL_POS(column,row)).    */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   x     - where disks of 'X' will be written                               */
+/*   all   - where all disks will be written                                  */
+static void load_disks(const conn4_state* board, unsigned long long* x,
+        unsigned long long* all) {
+    unsigned long long cells = 0;
+    unsigned int n, column;
+
+    for (n = 0; n < CHUNKS; ++n) {
+        cells |= (unsigned long long)board->info[n] << (8 * n);
+    }
+    *all = 0;
+    for (column = 0; column < COLS; ++column) {
+        *all |= ((1ULL << HEIGHT(board, column)) - 1) << CELL_POS(column, 0);
+    }
+    *x = cells & *all;
+    return;
+}
+
+
+#if BITBOARD
+
+/* Function: to_bitboard                                                      */
+/*   Inserts spare bit on top of every column of disks in storage order.     */
+/* Parameter(s):                                                              */
+/*   disks - disks in storage order                                           */
+/* Returns:                                                                   */
+/*   Bitboard (bit column*BITS+row).                                          */
+static unsigned long long to_bitboard(unsigned long long disks) {
+    unsigned long long bits = 0;
+    unsigned int column;
+
+    for (column = 0; column < COLS; ++column) {
+        bits |= ((disks >> CELL_POS(column, 0)) & COLUMN_BITS)
+                << (column * BITS);
+    }
+    return bits;
+}
+
+
+/* Function: check_win                                                        */
+/*   Checks if disk on top of column is in a row of four disks of its player. */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of the last move                                         */
+/* Returns:                                                                   */
+/*   1 if win, 0 otherwise.                                                   */
+static int ENGINE(check_win)(conn4_state* board, unsigned int column) {
+    static const unsigned int dirs[4] = {1, BITS, BITS + 1, BITS - 1};
+    unsigned long long x, all, bits, cell, m;
+    unsigned int d, i;
+
+    if (HEIGHT(board, column) == 0) {
+        return 0;
+    }
+    load_disks(board, &x, &all);
+    cell = 1ULL << (column * BITS + HEIGHT(board, column) - 1);
+    x = to_bitboard(x);
+    bits = ((x & cell) ? x : to_bitboard(all) ^ x);
+    for (i = 0; i < 4; ++i) {
+        d = dirs[i];
+        /* Lowest cells of rows of four, one of which must be the last disk */
+        m = bits & (bits >> d);
+        m &= m >> (2 * d);
+        if (m & (cell | cell >> d | cell >> (2 * d) | cell >> (3 * d))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/* Function: threat_bits                                                      */
+/*   Finds cells that complete alignment of four disks of one player (see   */
+/*   threat_bits() in conn4.c).                                               */
+/* Parameter(s):                                                              */
+/*   bits - bitboard of disks of player                                       */
+/* Returns:                                                                   */
+/*   Cells (empty or not, on board or not) completing alignment.              */
+static unsigned long long threat_bits(unsigned long long bits) {
+    static const unsigned int dirs[3] = {BITS, BITS + 1, BITS - 1};
+    unsigned long long r = (bits << 1) & (bits << 2) & (bits << 3);
+    unsigned long long t;
+    unsigned int d, i;
+
+    for (i = 0; i < 3; ++i) {
+        d = dirs[i];
+        t = (bits << d) & (bits << 2 * d);
+        r |= t & (bits << 3 * d);
+        r |= t & (bits >> d);
+        t = (bits >> d) & (bits >> 2 * d);
+        r |= t & (bits << d);
+        r |= t & (bits >> 3 * d);
+    }
+    return r;
+}
+
+
+/* Function: get_win_masks                                                    */
+/*   Finds columns where either player wins by the next disk and empty cells  */
+/*   where either player would complete alignment.                            */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   masks - where winning moves and threats will be written                  */
+/* Returns:                                                                   */
+/*   1 (threats are always found).                                            */
+static int ENGINE(get_win_masks)(const conn4_state* board, win_masks* masks) {
+    unsigned long long x, all, on_board = 0, top = 0, free_cells, w;
+    unsigned int column, n;
+
+    load_disks(board, &x, &all);
+    for (column = 0; column < COLS; ++column) {
+        top |= (1ULL << HEIGHT(board, column)) << (column * BITS);
+        on_board |= COLUMN_BITS << (column * BITS);
+    }
+    x = to_bitboard(x);
+    all = to_bitboard(all);
+    free_cells = on_board & ~all;
+    masks->threats[0] = threat_bits(x) & free_cells;
+    masks->threats[1] = threat_bits(all ^ x) & free_cells;
+
+    top &= on_board;
+    for (n = 0; n < 2; ++n) {
+        w = masks->threats[n] & top;
+        masks->wins[n] = 0;
+        for (column = 0; column < COLS; ++column) {
+            masks->wins[n] |= (unsigned long long)
+                    (((w >> (column * BITS)) & COLUMN_BITS) != 0) << column;
+        }
+    }
+    return 1;
+}
+
+
+/* Function: count_open                                                       */
+/*   Counts cells above the lowest empty cell of every column which complete  */
+/*   winning alignment to the right or to the left (horizontally or           */
+/*   diagonally) if player's disk is put at them (see count_open() in         */
+/*   kernels.c).                                                              */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   disk  - player's disk type                                               */
+/* Returns:                                                                   */
+/*   Number of open cells.                                                    */
+static unsigned int ENGINE(count_open)(const conn4_state* board, char disk) {
+    static const unsigned int dirs[3] = {BITS, BITS + 1, BITS - 1};
+    unsigned long long x, all, bits, above = 0, open = 0;
+    unsigned int column, d, i;
+
+    load_disks(board, &x, &all);
+    bits = to_bitboard(disk == CELL_X ? x : all ^ x);
+    for (column = 0; column < COLS; ++column) {
+        above |= (COLUMN_BITS & ~((2ULL << HEIGHT(board, column)) - 1))
+                << (column * BITS);
+    }
+    for (i = 0; i < 3; ++i) {
+        d = dirs[i];
+        open |= (bits >> d) & (bits >> 2 * d) & (bits >> 3 * d);
+        open |= (bits << d) & (bits << 2 * d) & (bits << 3 * d);
+    }
+    return __builtin_popcountll(open & above);
+}
+
+#else /* !BITBOARD */
+
+/* Function: count_run                                                        */
+/*   Counts disks of player next to cell in one direction.                    */
+/* Parameter(s):                                                              */
+/*   disks  - disks of player in storage order                                */
+/*   column - column of cell                                                  */
+/*   row    - row of cell                                                     */
+/*   dc     - step of column (-1, 0, +1)                                      */
+/*   dr     - step of row (-1, 0, +1)                                         */
+/* Returns:                                                                   */
+/*   Number of disks of player in a row starting from neighbor of cell.      */
+static int count_run(unsigned long long disks, int column, int row, int dc,
+        int dr) {
+    int count = 0;
+
+    for (column += dc, row += dr; column >= 0 && column < COLS &&
+            row >= 0 && row < ROWS; column += dc, row += dr) {
+        if (((disks >> CELL_POS(column, row)) & 1) == 0) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+
+/* Function: completes                                                        */
+/*   Checks if cell is in a row of four disks of player, not counting cell    */
+/*   itself.                                                                  */
+/* Parameter(s):                                                              */
+/*   disks  - disks of player in storage order                                */
+/*   column - column of cell                                                  */
+/*   row    - row of cell                                                     */
+/* Returns:                                                                   */
+/*   1 if alignment is completed, 0 otherwise.                                */
+static int completes(unsigned long long disks, int column, int row) {
+    return (count_run(disks, column, row, 0, -1) >= COUNT_TO_WIN - 1 ||
+            count_run(disks, column, row, -1, 0) +
+            count_run(disks, column, row, +1, 0) >= COUNT_TO_WIN - 1 ||
+            count_run(disks, column, row, -1, -1) +
+            count_run(disks, column, row, +1, +1) >= COUNT_TO_WIN - 1 ||
+            count_run(disks, column, row, -1, +1) +
+            count_run(disks, column, row, +1, -1) >= COUNT_TO_WIN - 1);
+}
+
+
+/* Function: check_win                                                        */
+/*   Checks if disk on top of column is in a row of four disks of its player. */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of the last move                                         */
+/* Returns:                                                                   */
+/*   1 if win, 0 otherwise.                                                   */
+static int ENGINE(check_win)(conn4_state* board, unsigned int column) {
+    unsigned long long x, all;
+    int row = HEIGHT(board, column) - 1;
+
+    if (row < 0) {
+        return 0;
+    }
+    load_disks(board, &x, &all);
+    if (((x >> CELL_POS(column, row)) & 1) == 0) {
+        x ^= all;
+    }
+    return completes(x, column, row);
+}
+
+
+/* Function: get_win_masks                                                    */
+/*   Finds columns where either player wins by the next disk. Like generic   */
+/*   function on boards that don't fit in bitboard, threats aren't found.    */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   masks - where winning moves and threats will be written                  */
+/* Returns:                                                                   */
+/*   0 (threats are 0).                                                       */
+static int ENGINE(get_win_masks)(const conn4_state* board, win_masks* masks) {
+    unsigned long long x, all;
+    unsigned int column, height;
+
+    masks->wins[0] = masks->wins[1] = 0;
+    masks->threats[0] = masks->threats[1] = 0;
+    load_disks(board, &x, &all);
+    for (column = 0; column < COLS; ++column) {
+        height = HEIGHT(board, column);
+        if (height < ROWS) {
+            masks->wins[0] |= (unsigned long long)completes(x, column,
+                    height) << column;
+            masks->wins[1] |= (unsigned long long)completes(all ^ x, column,
+                    height) << column;
+        }
+    }
+    return 0;
+}
+
+
+/* Function: count_open                                                       */
+/*   Counts cells above the lowest empty cell of every column which complete  */
+/*   winning alignment to the right or to the left (horizontally or           */
+/*   diagonally) if player's disk is put at them, by loops of count_open()   */
+/*   in kernels.c over grid of constant size.                                 */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   disk  - player's disk type                                               */
+/* Returns:                                                                   */
+/*   Number of open cells.                                                    */
+static unsigned int ENGINE(count_open)(const conn4_state* board, char disk) {
+    unsigned char grid[GRID_BYTES(COLS, ROWS)];
+    unsigned long long x, all, disks;
+    unsigned int count = 0;
+    int column, row;
+    const int s = GRID_STRIDE(COLS);
+    const unsigned char* g;
+
+    load_disks(board, &x, &all);
+    disks = (disk == CELL_X ? x : all ^ x);
+    memset(grid, 0, sizeof(grid));
+    for (column = 0; column < COLS; ++column) {
+        for (row = 0; row < ROWS; ++row) {
+            grid[GRID_POS(COLS, column, row)] =
+                    (disks >> CELL_POS(column, row)) & 1;
+        }
+    }
+    for (row = 0; row < ROWS; ++row) {
+        g = grid + GRID_POS(COLS, 0, row);
+        for (column = 0; column < COLS; ++column) {
+            unsigned char f =
+                (g[column+1] & g[column+2] & g[column+3]) |
+                (g[column+1+s] & g[column+2+2*s] & g[column+3+3*s]) |
+                (g[column+1-s] & g[column+2-2*s] & g[column+3-3*s]) |
+                (g[column-1] & g[column-2] & g[column-3]) |
+                (g[column-1+s] & g[column-2+2*s] & g[column-3+3*s]) |
+                (g[column-1-s] & g[column-2-2*s] & g[column-3-3*s]);
+            count += f & (row > HEIGHT(board, column));
+        }
+    }
+    return count;
+}
+
+#endif /* BITBOARD */
+
+
+/* Engine of this size                                                        */
+const board_engine ENGINE(engine) = {
+    COLS, ROWS, ENGINE(check_win), ENGINE(get_win_masks), ENGINE(count_open)
+};
+
+
+#endif /* _ENGINE_C_ */
@@ -0,0 +1,38 @@
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+
+#include "conn4.h"
+
+
+/* Table of hot board functions compiled for fixed dimensions of board (see  */
+/* engine.c). Functions give the same results as generic ones, which are     */
+/* used for all other dimensions.                                             */
+typedef struct {
+    unsigned int columns;   /* Dimensions of board */
+    unsigned int rows;
+
+    /* Checks if the last move brings a victory (see check_win()).            */
+    int (*check_win)(conn4_state* board, unsigned int column);
+
+    /* Finds winning moves and threats of both players (see get_win_masks()). */
+    int (*get_win_masks)(const conn4_state* board, win_masks* masks);
+
+    /* Counts open cells of player (see count_open_pos() in computer.c).     */
+    unsigned int (*count_open)(const conn4_state* board, char disk);
+} board_engine;
+
+
+/* Gets engine specialized for current dimensions, or NULL if there is none. */
+const board_engine* get_engine(void);
+
+
+/* Engines of popular dimensions (defined in engine.c, built once per size)  */
+#define DECLARE_ENGINE(columns,rows)                                          \
+    extern const board_engine engine_##columns##x##rows;
+
+DECLARE_ENGINE(7,6)
+DECLARE_ENGINE(8,7)
+DECLARE_ENGINE(9,7)
+
+
+#endif /* _ENGINE_H_ */
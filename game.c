@@ -5,9 +5,17 @@
 #include "player.h"
 #include "human.h"
 #include "computer.h"
+#include "mcts.h"
 #include "rating.h"
-#include <stdlib.h>     /* malloc() */
-#include <stdio.h>      /* printf() */
+#include "render.h"
+#include "kernels.h"
+#include "cache.h"
+#include "tablebase.h"
+#include "nnue.h"
+#include "async.h"
+#include "trace.h"
+#include <stdlib.h>     /* malloc(), atof() */
+#include <stdio.h>      /* printf(), sprintf(), setvbuf() */
 #include <string.h>     /* strcmp() */
 #include <unistd.h>     /* sleep()  */
 
@@ -15,12 +23,15 @@
 #define HUMAN_VS_HUMAN      1
 #define HUMAN_VS_COMPUTER   2
 #define COMPUTER_VS_HUMAN   3
+#define HUMAN_VS_MCTS       4
+#define MCTS_VS_HUMAN       5
 
 
 /* Function: init                                                             */
 /*   Initializes parameters of board and loads ratings.                       */
 void init(void) {
     int rows = 0, columns =0;
+    char filename[64];
 
     printf("Choose dimensions of the game.\n");
     printf("Warning: dimensions higher than %dx%d will have unweildy screen "
@@ -44,6 +55,18 @@ void init(void) {
 
     set_dimensions(columns, rows);
     load_ratings();
+    /* Analysis cache is optional, the game goes on without it */
+    cache_open(CACHE_FILENAME, CACHE_ENTRIES);
+    /* So is tablebase, which exists only for small boards (see tbgen) */
+    sprintf(filename, TB_FILENAME, get_cols(), get_rows());
+    if (tb_open(filename)) {
+        printf("Using tablebase %s: computer plays perfectly.\n", filename);
+    }
+    /* And so are trained weights of evaluation (see tuner) */
+    sprintf(filename, NNUE_FILENAME, get_cols(), get_rows());
+    if (nnue_open(filename)) {
+        printf("Using evaluation weights %s.\n", filename);
+    }
 
     return;
 }
@@ -70,20 +93,25 @@ void menu(player_t* players) {
     printf("1. Human (X) vs Human (O)\n");
     printf("2. Human (X) vs Computer (O)\n");
     printf("3. Human (O) vs Computer (X)\n");
+    printf("4. Human (X) vs Monte Carlo Computer (O)\n");
+    printf("5. Human (O) vs Monte Carlo Computer (X)\n");
     do {
         printf("    Your choice: ");
         scanf("%d", &mode);
     } while (mode != HUMAN_VS_HUMAN && mode != HUMAN_VS_COMPUTER &&
-            mode != COMPUTER_VS_HUMAN);
+            mode != COMPUTER_VS_HUMAN && mode != HUMAN_VS_MCTS &&
+            mode != MCTS_VS_HUMAN);
 
     /* Initialize players according to selected mode */
     switch (mode) {
         case HUMAN_VS_HUMAN:
             printf("Player X (1st move) set-up.\n");
             players[0].get_move = human_move;
+            players[0].get_move_timed = human_move_timed;
             players[0].name = choose_name();
             printf("Player O (2nd move) set-up.\n");
             players[1].get_move = human_move;
+            players[1].get_move_timed = human_move_timed;
             do {
                 players[1].name = choose_name();
             } while (strcmp(players[1].name, players[0].name) == 0);
@@ -91,15 +119,37 @@ void menu(player_t* players) {
         case HUMAN_VS_COMPUTER:
             printf("Player X (1st move) set-up.\n");
             players[0].get_move = human_move;
+            players[0].get_move_timed = human_move_timed;
             players[0].name = choose_name();
             players[1].get_move = computer_move;
+            players[1].get_move_timed = computer_move_timed;
             players[1].name = COMPUTER_NAME;
             break;
         case COMPUTER_VS_HUMAN:
             players[0].get_move = computer_move;
+            players[0].get_move_timed = computer_move_timed;
             players[0].name = COMPUTER_NAME;
             printf("Player O (2nd move) set-up.\n");
             players[1].get_move = human_move;
+            players[1].get_move_timed = human_move_timed;
+            players[1].name = choose_name();
+            break;
+        case HUMAN_VS_MCTS:
+            printf("Player X (1st move) set-up.\n");
+            players[0].get_move = human_move;
+            players[0].get_move_timed = human_move_timed;
+            players[0].name = choose_name();
+            players[1].get_move = mcts_move;
+            players[1].get_move_timed = mcts_move_timed;
+            players[1].name = MCTS_NAME;
+            break;
+        case MCTS_VS_HUMAN:
+            players[0].get_move = mcts_move;
+            players[0].get_move_timed = mcts_move_timed;
+            players[0].name = MCTS_NAME;
+            printf("Player O (2nd move) set-up.\n");
+            players[1].get_move = human_move;
+            players[1].get_move_timed = human_move_timed;
             players[1].name = choose_name();
     }
 
@@ -116,37 +166,90 @@ void menu(player_t* players) {
 /*   Starts the program. Initializes parameters, loads ratings from external  */
 /*   file, creates empty board and lets human play agains other human or      */
 /*   computer. Result is saved back to external file.                         */
-/* Parameter(s): ignored                                                      */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments; "--ansi" lets board be redrawn in place, */
+/*          "--clock N" gives players N seconds per move                      */
 int main(int argc, char* argv[]) {
+    int i;
     int column;                 /* Column selected by player */
+    double move_time = 0.0;     /* Time per move in seconds, 0 if unlimited */
+    move_request* request;      /* Pending request of player's move */
     conn4_state* board = NULL;  /* Game board */
     int turn = 0;               /* Parity of current turn number */
     int victory = 0;            /* Flag indicating win condition */
 
     player_t players[2];
 
+    /* Select board kernels for this processor */
+    init_kernels();
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--ansi") == 0) {
+            set_render_mode(RENDER_ANSI);
+        } else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            move_time = atof(argv[++i]);
+        }
+    }
+
+    /* Human player waits for input with deadline, which can't see input     */
+    /* read ahead into stdio buffer                                           */
+    setvbuf(stdin, NULL, _IONBF, 0);
+
     /* Set-up. Choose dimensions, mode and user name(s). */
     menu(players);
 
     /* Initialize game board */
     board = create_board();
     printf("\nGame starts now...\n\n");
-    print_board(board);
+    render_board(board);
 
+    TRACE_BEGIN("game");
     while (board->moves < get_size()) {
+        TRACE_BEGIN_ARG("turn", "move", board->moves);
         printf("\n\nTurn of player %s (%c).\n\n",
             players[turn].name, players[turn].disk);
 
-        column = players[turn].get_move(board);
-        if (!set_cell(board, column, players[turn].disk)) {
+        /* Player thinks in thread of its own and gives up at deadline */
+        TRACE_BEGIN("await_move");
+        request = request_move(&players[turn], board, move_time);
+        column = (request != NULL ? await_move(request) : MOVE_FAILED);
+        release_move(request);
+        TRACE_END("await_move");
+        if (column == MOVE_TIMEOUT) {
+            /* Player failed to move in time and loses the game */
+            victory = 1;
+            turn = 1 - turn;
+            printf("\n\nPlayer %s (%c) wins on time!\n\n\nwritten by: "
+                "Andrekious Evans\n\n", players[turn].name,
+                players[turn].disk);
+            save_result(players[0].name, players[1].name, players[turn].disk);
+            TRACE_END("turn");
+            break;
+        }
+        if (column == MOVE_FAILED) {
+            /* Input ended or failed: game can't go on, nobody wins */
+            printf("\n\nPlayer %s (%c) can't move (end of input or input "
+                "error). Game is abandoned.\n", players[turn].name,
+                players[turn].disk);
+            destruct_board(board);
+            render_finish();
+            TRACE_END("turn");
+            TRACE_END("game");
+            TRACE_SAVE();
+            return EXIT_FAILURE;
+        }
+        if (column < 0 || !set_cell(board, column, players[turn].disk)) {
             printf("Unexpected error! Need to review set_cell() and/or "
                 "human_move() and/or computer_move() functions.\n");
             destruct_board(board);
+            render_finish();
+            TRACE_SAVE();
             return EXIT_FAILURE;
         }
         /* Print updated board after player's move */
         printf("\n\n");
-        print_board(board);
+        render_board(board);
         /* Check for win condition */
         if (check_win(board, column)) {
             victory = 1;
@@ -154,11 +257,14 @@ int main(int argc, char* argv[]) {
                 players[turn].name, players[turn].disk);
             /* Update ratings */
             save_result(players[0].name, players[1].name, players[turn].disk);
+            TRACE_END("turn");
             break;
         }
         /* Advance to next move and another player */
         turn = (board->moves % 2);
+        TRACE_END("turn");
     }
+    TRACE_END("game");
 
     /* Check if game is a tie */
     if (!victory) {
@@ -168,8 +274,13 @@ int main(int argc, char* argv[]) {
     }
 
     /* Finalize */
+    render_finish();
+    cache_close();
+    tb_close();
     destruct_board(board);
+    nnue_close();
     save_ratings();
+    TRACE_SAVE();
 
     return EXIT_SUCCESS;
 }
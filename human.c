@@ -2,32 +2,123 @@
 #define _HUMAN_C_
 
 #include "human.h"
-#include <stdio.h>  /* printf(), scanf(), getchar() */
+#include "async.h"
+#include "computer.h"
+#include "trace.h"
+#include <stdio.h>  /* printf(), scanf(), getchar(), ungetc(), fflush(), fileno() */
+#include <ctype.h>  /* isspace() */
+#include <errno.h>  /* errno */
+#include <poll.h>   /* poll() */
 
 
-/* Function: human_move                                                       */
-/*   Asks user for a column to put dist into.                                 */
-/*   Function will repeat requests untill user types valid choice or standard */
-/*   input encounters a failure.                                              */
+/* Interval of checking limits of request while waiting for input (ms)       */
+#define POLL_INTERVAL   100
+/* Number of moves suggested by hint                                          */
+#define HINT_MOVES      3
+
+
+/* Function: wait_input                                                       */
+/*   Waits until standard input has something besides white space to read,   */
+/*   or limits of request are exceeded. White space is skipped (scanf() would */
+/*   skip it anyway, but it would block). Standard input has to be           */
+/*   unbuffered (see main()), otherwise data read ahead by stdio would be    */
+/*   missed.                                                                  */
+/* Parameter(s):                                                              */
+/*   ctl - limits of request, or NULL if there are none                       */
+/* Returns:                                                                   */
+/*   1 if input is ready (or end of input is reached), 0 if request is        */
+/*   cancelled or its deadline has passed.                                    */
+static int wait_input(const move_ctl* ctl) {
+    struct pollfd fd;
+    int ret, ch;
+
+    if (ctl == NULL) {
+        return 1;
+    }
+    fd.fd = fileno(stdin);
+    fd.events = POLLIN;
+    while (!move_stopped(ctl)) {
+        ret = poll(&fd, 1, POLL_INTERVAL);
+        if (ret < 0 && errno != EINTR) {
+            return 1;
+        } else if (ret > 0) {
+            ch = getchar();
+            if (ch == EOF || !isspace(ch)) {
+                ungetc(ch, stdin);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+
+/* Function: print_hint                                                       */
+/*   Prints the best moves for player to move with their scores and expected  */
+/*   continuations (see computer_analyse()).                                  */
 /* Parameter(s):                                                              */
 /*   board - board structure                                                  */
+/*   ctl   - limits of request, or NULL if there are none                     */
+static void print_hint(conn4_state* board, const move_ctl* ctl) {
+    analysis_line lines[HINT_MOVES];
+    unsigned int i, j, n = computer_analyse(board, HINT_MOVES, ctl, lines);
+
+    for (i = 0; i < n; ++i) {
+        /* Score is shown on scale -100...+100 */
+        printf("Hint %u: column %d (%+d):", i + 1, lines[i].move + 1,
+                (int)(lines[i].score * 100));
+        for (j = 0; j < lines[i].length; ++j) {
+            printf(" %d", lines[i].pv[j] + 1);
+        }
+        printf("\n");
+    }
+    return;
+}
+
+
+/* Function: human_move_timed                                                 */
+/*   Asks user for a column to put dist into. User may type h (or ?) to get   */
+/*   hint of the best moves.                                                  */
+/*   Function will repeat requests untill user types valid choice, standard   */
+/*   input encounters a failure, or limits of request are exceeded.          */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   ctl   - limits of request, or NULL if there are none                     */
 /* Returns:                                                                   */
 /*   valid column index (zero-based) if successful, -1 if input encountered a */
-/*   failure.                                                                 */
-int human_move(conn4_state* board) {
+/*   failure or user didn't choose in time.                                   */
+int human_move_timed(conn4_state* board, const move_ctl* ctl) {
     int ret;        /* Status of scanf() function call */
     int ch;
     int column = 0; /* Column chosen by user */
 
     do {
         printf("Choose column (1-%d): ", get_cols());
+        fflush(stdout);
+        TRACE_BEGIN("wait_input");
+        if (!wait_input(ctl)) {
+            TRACE_END("wait_input");
+            if (!move_cancelled(ctl)) {
+                printf("\nTime is up.\n");
+            }
+            return -1;
+        }
+        TRACE_END("wait_input");
         ret = scanf("%d", &column);
-        if (ret == 0) { /* User's input couldn't be converted to integer */
-            printf("That is bad input. Please, enter an integer.\n");
+        if (ret == 0 && ((ch = getchar()) == 'h' || ch == '?')) {
+            print_hint(board, ctl);
+            column = 0;
             /* Clear last input line */
-            do {
+            while (ch != EOF && ch != '\n') {
                 ch = getchar();
-            } while (ch != EOF && ch != '\n');
+            }
+        } else if (ret == 0) { /* User's input couldn't be converted */
+            printf("That is bad input. Please, enter an integer "
+                    "(or h for hint).\n");
+            /* Clear last input line */
+            while (ch != EOF && ch != '\n') {
+                ch = getchar();
+            }
         } else if (ret == 1) {  /* User's input is successfully converted */
             if (column <= 0 || column > get_cols()) {
                 printf("That is bad input. Please, enter an integer in "
@@ -48,4 +139,17 @@ int human_move(conn4_state* board) {
 }
 
 
+/* Function: human_move                                                       */
+/*   Asks user for a column to put dist into without limits of request (see  */
+/*   human_move_timed()).                                                     */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   valid column index (zero-based) if successful, -1 if input encountered a */
+/*   failure.                                                                 */
+int human_move(conn4_state* board) {
+    return human_move_timed(board, NULL);
+}
+
+
 #endif /* _HUMAN_C_ */
@@ -8,5 +8,8 @@
 /* human player for his/her next move.                                        */
 int human_move(conn4_state* board);
 
+/* The same function that respects limits of move request (see player.h).     */
+int human_move_timed(conn4_state* board, const move_ctl* ctl);
+
 
 #endif /* _HUMAN_H_ */
@@ -0,0 +1,174 @@
+#ifndef _KERNELS_C_
+#define _KERNELS_C_
+
+/* This file is compiled once per instruction set with KERNEL_VARIANT set to */
+/* name of variant (scalar, sse42, avx2, avx512) and corresponding target    */
+/* options, so that compiler vectorizes loops below for that target. Loops   */
+/* run over cells of one row, read neighbors through fixed offsets within    */
+/* padded grid and have no branches, which keeps them vectorizable.          */
+
+#include "kernels.h"
+
+
+/* Macros: Appends name of variant to name of kernel                          */
+#define KERNEL_PASTE(name,variant)  name##_##variant
+#define KERNEL_EXPAND(name,variant) KERNEL_PASTE(name,variant)
+#define KERNEL(name)                KERNEL_EXPAND(name,KERNEL_VARIANT)
+
+
+/* Function: count_open                                                       */
+/*   Counts cells above the lowest empty cell of every column which complete  */
+/*   winning alignment to the right or to the left (horizontally or           */
+/*   diagonally) if player's disk is put at them. Gives the same result as    */
+/*   count_open_pos() in computer.c.                                          */
+/* Parameter(s):                                                              */
+/*   grid    - padded grid of player's disks                                  */
+/*   heights - heights of columns                                             */
+/*   cols    - number of columns                                              */
+/*   rows    - number of rows                                                 */
+/* Returns:                                                                   */
+/*   Number of open cells.                                                    */
+unsigned int KERNEL(count_open)(const unsigned char* grid,
+        const unsigned char* heights, unsigned int cols, unsigned int rows) {
+    unsigned int count = 0;
+    unsigned int row;
+    int c;
+    const int n = cols;
+    const int s = GRID_STRIDE(cols);
+    const unsigned char* g;
+
+    for (row = 0; row < rows; ++row) {
+        g = grid + GRID_POS(cols, 0, row);
+        for (c = 0; c < n; ++c) {
+            unsigned char f =
+                /* Alignments to the right: horizontal, rising, falling */
+                (g[c+1] & g[c+2] & g[c+3]) |
+                (g[c+1+s] & g[c+2+2*s] & g[c+3+3*s]) |
+                (g[c+1-s] & g[c+2-2*s] & g[c+3-3*s]) |
+                /* Alignments to the left: horizontal, rising, falling */
+                (g[c-1] & g[c-2] & g[c-3]) |
+                (g[c-1+s] & g[c-2+2*s] & g[c-3+3*s]) |
+                (g[c-1-s] & g[c-2-2*s] & g[c-3-3*s]);
+            count += f & (row > heights[c]);
+        }
+    }
+
+    return count;
+}
+
+
+/* Function: count_threats                                                    */
+/*   Counts empty cells which complete winning alignment in any direction if  */
+/*   player's disk is put at them. Rows are counted from bottom starting      */
+/*   with 1 to determine parity.                                              */
+/* Parameter(s):                                                              */
+/*   grid    - padded grid of player's disks                                  */
+/*   heights - heights of columns                                             */
+/*   cols    - number of columns                                              */
+/*   rows    - number of rows                                                 */
+/*   counts  - where numbers of threats will be written: on odd rows, on even */
+/*             rows, and immediately playable ones                            */
+void KERNEL(count_threats)(const unsigned char* grid,
+        const unsigned char* heights, unsigned int cols, unsigned int rows,
+        unsigned int* counts) {
+    unsigned int total, playable;
+    unsigned int row;
+    int c;
+    const int n = cols;
+    const int s = GRID_STRIDE(cols);
+    const unsigned char* g;
+
+    counts[0] = counts[1] = counts[2] = 0;
+    for (row = 0; row < rows; ++row) {
+        g = grid + GRID_POS(cols, 0, row);
+        total = playable = 0;
+        for (c = 0; c < n; ++c) {
+            unsigned char f =
+                /* Vertical: three disks below */
+                (g[c-s] & g[c-2*s] & g[c-3*s]) |
+                /* Horizontal: cell at each of four places of alignment */
+                (g[c+1] & g[c+2] & g[c+3]) |
+                (g[c-1] & g[c+1] & g[c+2]) |
+                (g[c-2] & g[c-1] & g[c+1]) |
+                (g[c-3] & g[c-2] & g[c-1]) |
+                /* Rising diagonal */
+                (g[c+1+s] & g[c+2+2*s] & g[c+3+3*s]) |
+                (g[c-1-s] & g[c+1+s] & g[c+2+2*s]) |
+                (g[c-2-2*s] & g[c-1-s] & g[c+1+s]) |
+                (g[c-3-3*s] & g[c-2-2*s] & g[c-1-s]) |
+                /* Falling diagonal */
+                (g[c+1-s] & g[c+2-2*s] & g[c+3-3*s]) |
+                (g[c-1+s] & g[c+1-s] & g[c+2-2*s]) |
+                (g[c-2+2*s] & g[c-1+s] & g[c+1-s]) |
+                (g[c-3+3*s] & g[c-2+2*s] & g[c-1+s]);
+            f &= (row >= heights[c]);
+            total += f;
+            playable += f & (row == heights[c]);
+        }
+        counts[row % 2] += total;
+        counts[2] += playable;
+    }
+
+    return;
+}
+
+
+/* Function: has_win                                                          */
+/*   Checks if there is a winning alignment of player's disks anywhere on     */
+/*   the grid.                                                                */
+/* Parameter(s):                                                              */
+/*   grid - padded grid of player's disks                                     */
+/*   cols - number of columns                                                 */
+/*   rows - number of rows                                                    */
+/* Returns:                                                                   */
+/*   1 if there is a winning alignment, 0 otherwise.                          */
+int KERNEL(has_win)(const unsigned char* grid, unsigned int cols,
+        unsigned int rows) {
+    unsigned char win = 0;
+    unsigned int row;
+    int c;
+    const int n = cols;
+    const int s = GRID_STRIDE(cols);
+    const unsigned char* g;
+
+    for (row = 0; row < rows; ++row) {
+        g = grid + GRID_POS(cols, 0, row);
+        for (c = 0; c < n; ++c) {
+            win |= g[c] & (
+                (g[c+1] & g[c+2] & g[c+3]) |
+                (g[c+s] & g[c+2*s] & g[c+3*s]) |
+                (g[c+1+s] & g[c+2+2*s] & g[c+3+3*s]) |
+                (g[c+1-s] & g[c+2-2*s] & g[c+3-3*s]));
+        }
+    }
+
+    return win;
+}
+
+
+/* Function: dot_clipped                                                      */
+/*   Computes dot product of values clipped to range 0...clip with weights.  */
+/* Parameter(s):                                                              */
+/*   values  - values (accumulator of features)                               */
+/*   weights - weights                                                        */
+/*   n       - number of values                                               */
+/*   clip    - upper bound of values                                          */
+/* Returns:                                                                   */
+/*   Dot product.                                                             */
+int KERNEL(dot_clipped)(const int* values, const int* weights, unsigned int n,
+        int clip) {
+    int sum = 0;
+    unsigned int i;
+
+    for (i = 0; i < n; ++i) {
+        int v = values[i];
+        v = (v < 0 ? 0 : v);
+        v = (v > clip ? clip : v);
+        sum += v * weights[i];
+    }
+
+    return sum;
+}
+
+
+#endif /* _KERNELS_C_ */
@@ -0,0 +1,94 @@
+#ifndef _KERNELS_H_
+#define _KERNELS_H_
+
+#include "conn4.h"
+
+
+/* Kernels work on a grid of cells of one player: one byte per cell, 1 for   */
+/* player's disk and 0 otherwise. Grid is stored row by row (bottom row      */
+/* first) and is surrounded by GRID_PAD empty cells on every side, so        */
+/* kernels never check bounds of the board.                                   */
+#define GRID_PAD            (COUNT_TO_WIN - 1)
+
+/* Macros: Number of cells in one row of grid (with padding)                 */
+#define GRID_STRIDE(cols)   ((cols) + 2 * GRID_PAD)
+
+/* Macros: Total number of cells of grid (with padding)                      */
+#define GRID_BYTES(cols,rows)   (GRID_STRIDE(cols) * ((rows) + 2 * GRID_PAD))
+
+/* Macros: Index of cell (column,row) within grid                            */
+#define GRID_POS(cols,column,row)   \
+    (((row) + GRID_PAD) * GRID_STRIDE(cols) + (column) + GRID_PAD)
+
+/* Largest grid kept on stack. Grids of boards larger than MAX_COLUMNS x    */
+/* MAX_ROWS are allocated on heap.                                            */
+#define GRID_MAX_BYTES      GRID_BYTES(MAX_COLUMNS, MAX_ROWS)
+
+/* Macros: Checks if grid of board of current dimensions fits on stack       */
+#define GRID_FITS()     (get_cols() <= MAX_COLUMNS && get_rows() <= MAX_ROWS)
+
+
+/* Table of board kernels built for certain instruction set.                 */
+typedef struct {
+    const char* name;   /* Name of instruction set */
+
+    /* Counts cells above the lowest empty cell of every column that are     */
+    /* ends of possible winning alignments (see count_open_pos()).            */
+    unsigned int (*count_open)(const unsigned char* grid,
+            const unsigned char* heights, unsigned int cols, unsigned int rows);
+
+    /* Counts empty cells that complete winning alignment; counts[0] gets     */
+    /* threats on odd rows, counts[1] on even rows, counts[2] playable ones.  */
+    void (*count_threats)(const unsigned char* grid,
+            const unsigned char* heights, unsigned int cols, unsigned int rows,
+            unsigned int* counts);
+
+    /* Checks if there is a winning alignment anywhere on the grid.           */
+    int (*has_win)(const unsigned char* grid, unsigned int cols,
+            unsigned int rows);
+
+    /* Dot product of values clipped to range 0...clip with weights (output  */
+    /* layer of evaluation network, see nnue.c).                              */
+    int (*dot_clipped)(const int* values, const int* weights, unsigned int n,
+            int clip);
+} board_kernels;
+
+
+/* Kernels selected for this machine. Portable kernels are used until        */
+/* init_kernels() is called.                                                  */
+extern board_kernels kernels;
+
+/* Selects the fastest kernels supported by processor. Call once at start up. */
+const char* init_kernels(void);
+
+/* Gets kernels of selected instruction set or NULL if unsupported.          */
+const board_kernels* get_kernels(const char* name);
+
+/* Fills grid of selected player and heights of columns from board.          */
+void board_to_grid(conn4_state* board, char disk, unsigned char* grid,
+        unsigned char* heights);
+
+/* Fills grids of both players ('X' first) and heights of columns at once.   */
+void board_to_grids(conn4_state* board, unsigned char* grid_x,
+        unsigned char* grid_o, unsigned char* heights);
+
+
+/* Variants of kernels (defined in kernels.c, built once per instruction set) */
+#define DECLARE_KERNELS(variant)                                              \
+    unsigned int count_open_##variant(const unsigned char* grid,             \
+            const unsigned char* heights, unsigned int cols, unsigned int rows);\
+    void count_threats_##variant(const unsigned char* grid,                   \
+            const unsigned char* heights, unsigned int cols, unsigned int rows,\
+            unsigned int* counts);                                            \
+    int has_win_##variant(const unsigned char* grid, unsigned int cols,       \
+            unsigned int rows);                                               \
+    int dot_clipped_##variant(const int* values, const int* weights,          \
+            unsigned int n, int clip);
+
+DECLARE_KERNELS(scalar)
+DECLARE_KERNELS(sse42)
+DECLARE_KERNELS(avx2)
+DECLARE_KERNELS(avx512)
+
+
+#endif /* _KERNELS_H_ */
@@ -0,0 +1,509 @@
+#ifndef _MCTS_C_
+#define _MCTS_C_
+
+#include "mcts.h"
+#include "playout.h"
+#include "async.h"
+#include "trace.h"
+#include <stdio.h>      /* printf() */
+#include <stdlib.h>     /* malloc(), free() */
+#include <string.h>     /* memcmp() */
+#include <math.h>       /* sqrt(), log() */
+#include <time.h>       /* time() */
+#include <unistd.h>     /* sysconf() */
+#include <pthread.h>    /* pthread_create(), pthread_join(), pthread_mutex_*() */
+
+
+/* Time for one move in seconds                                               */
+#define MCTS_TIME       1.0
+/* Number of nodes in pool (tree is reset when it gets 3/4 full)              */
+#define POOL_NODES      (1U << 21)
+/* Maximal number of search threads                                           */
+#define MAX_THREADS     64
+/* Exploration constant of UCT formula                                        */
+#define EXPLORATION     1.4
+/* Number of random games played from leaf by one iteration                  */
+#define MCTS_LANES      8
+/* Results of iteration in half-points of all its games                      */
+#define SCORE_WIN       (2 * MCTS_LANES)
+#define SCORE_DRAW      MCTS_LANES
+
+/* States of expansion of node                                                */
+#define NODE_LEAF       0   /* Children aren't created yet */
+#define NODE_EXPANDING  1   /* Some thread is creating children */
+#define NODE_EXPANDED   2   /* Children are ready */
+
+/* Marks of nodes where game is over                                          */
+#define GAME_ON         0
+#define GAME_WON        1   /* Move into node won the game */
+#define GAME_DRAWN      2   /* Move into node filled the board */
+
+
+/* Node of search tree. Statistics are updated by atomic operations, so     */
+/* threads grow the tree without locks. Score is counted in half-points of   */
+/* MCTS_LANES games per visit from point of view of player who made move     */
+/* into node.                                                                 */
+typedef struct {
+    unsigned int child;     /* Index of the first child in pool */
+    unsigned int children;  /* Number of children */
+    int move;               /* Column of move into node */
+    int state;              /* NODE_LEAF, NODE_EXPANDING or NODE_EXPANDED */
+    int over;               /* GAME_ON, GAME_WON or GAME_DRAWN */
+    int visits;             /* Visits, including virtual losses in progress */
+    int score;              /* Sum of results of playouts in half-points */
+} mcts_node;
+
+/* State of search thread                                                     */
+typedef struct {
+    pthread_t thread;
+    unsigned long long seed;    /* State of random number generator */
+    unsigned long long playouts;/* Number of finished playouts */
+} mcts_worker;
+
+
+/* Pool of nodes; nodes are taken by atomic increment of index of the first  */
+/* free node and are released all at once when tree is reset.               */
+static mcts_node* pool = NULL;
+static unsigned int pool_used = 0;
+
+/* Root of tree and its position, kept between moves for reuse of tree       */
+static unsigned int root = 0;
+static conn4_state* root_board = NULL;
+static unsigned int root_cols = 0;
+static unsigned int root_rows = 0;
+
+/* Deadline of current search (monotonic clock, seconds)                      */
+static double deadline = 0.0;
+/* Limits of current move request, NULL if there are none                     */
+static const move_ctl* search_ctl = NULL;
+/* Tree is shared, so concurrent requests are served one by one               */
+static pthread_mutex_t mcts_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* Function: next_random                                                      */
+/*   Generates pseudo-random number (xorshift64*).                            */
+/* Parameter(s):                                                              */
+/*   seed - state of generator                                                */
+/* Returns:                                                                   */
+/*   Pseudo-random 32-bit number.                                             */
+static unsigned int next_random(unsigned long long* seed) {
+    *seed ^= *seed >> 12;
+    *seed ^= *seed << 25;
+    *seed ^= *seed >> 27;
+    return (unsigned int)((*seed * 2685821657736338717ULL) >> 32);
+}
+
+
+/* Function: new_nodes                                                        */
+/*   Takes consecutive nodes from pool.                                       */
+/* Parameter(s):                                                              */
+/*   count - number of nodes                                                  */
+/* Returns:                                                                   */
+/*   Index of the first node, or 0 if pool is exhausted.                      */
+static unsigned int new_nodes(unsigned int count) {
+    unsigned int first = __atomic_fetch_add(&pool_used, count,
+            __ATOMIC_RELAXED);
+    if (first + count > POOL_NODES) {
+        return 0;
+    }
+    return first;
+}
+
+
+/* Function: init_node                                                        */
+/*   Initializes node for selected move.                                      */
+/* Parameter(s):                                                              */
+/*   node - node of tree                                                      */
+/*   move - column of move into node                                          */
+static void init_node(mcts_node* node, int move) {
+    node->child = 0;
+    node->children = 0;
+    node->move = move;
+    node->state = NODE_LEAF;
+    node->over = GAME_ON;
+    node->visits = 0;
+    node->score = 0;
+    return;
+}
+
+
+/* Function: expand                                                           */
+/*   Creates children of node for every move available on board. Only one    */
+/*   thread expands node; others treat it as a leaf meanwhile.                */
+/* Parameter(s):                                                              */
+/*   node  - node of tree                                                     */
+/*   board - position of node                                                 */
+static void expand(mcts_node* node, conn4_state* board) {
+    int expected = NODE_LEAF;
+    unsigned int column, count = 0, first;
+
+    if (!__atomic_compare_exchange_n(&node->state, &expected, NODE_EXPANDING,
+            0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    for (column = 0; column < get_cols(); ++column) {
+        count += (get_height(board, column) < get_rows());
+    }
+    if (count == 0 || (first = new_nodes(count)) == 0) {
+        /* Pool is exhausted; node stays a leaf */
+        __atomic_store_n(&node->state, NODE_LEAF, __ATOMIC_RELEASE);
+        return;
+    }
+    for (column = 0, count = 0; column < get_cols(); ++column) {
+        if (get_height(board, column) < get_rows()) {
+            init_node(&pool[first + count++], column);
+        }
+    }
+    node->child = first;
+    node->children = count;
+    __atomic_store_n(&node->state, NODE_EXPANDED, __ATOMIC_RELEASE);
+    return;
+}
+
+
+/* Function: select_child                                                     */
+/*   Selects child of node with the highest upper confidence bound (UCT).     */
+/*   Unvisited children are selected first.                                   */
+/* Parameter(s):                                                              */
+/*   node - expanded node of tree                                             */
+/* Returns:                                                                   */
+/*   Selected child.                                                          */
+static mcts_node* select_child(mcts_node* node) {
+    unsigned int i;
+    int visits, score;
+    double value, best = -1.0;
+    double log_total = log((double)node->visits + 1.0);
+    mcts_node* child;
+    mcts_node* selected = &pool[node->child];
+
+    for (i = 0; i < node->children; ++i) {
+        child = &pool[node->child + i];
+        visits = __atomic_load_n(&child->visits, __ATOMIC_RELAXED);
+        score = __atomic_load_n(&child->score, __ATOMIC_RELAXED);
+        if (visits == 0) {
+            return child;
+        }
+        value = score / ((double)SCORE_WIN * visits) +
+                EXPLORATION * sqrt(log_total / visits);
+        if (value > best) {
+            best = value;
+            selected = child;
+        }
+    }
+    return selected;
+}
+
+
+/* Function: playout                                                          */
+/*   Plays random moves until the game is over.                               */
+/* Parameter(s):                                                              */
+/*   board - position to play from (modified)                                 */
+/*   seed  - state of random number generator                                 */
+/* Returns:                                                                   */
+/*   Disk type of winner, or CELL_EMPTY if draw.                              */
+static char playout(conn4_state* board, unsigned long long* seed) {
+    unsigned int column;
+    char disk;
+
+    while (board->moves < get_size()) {
+        disk = (board->moves % 2 == 0 ? CELL_X : CELL_O);
+        column = next_random(seed) % get_cols();
+        while (!set_cell(board, column, disk)) {
+            column = (column + 1) % get_cols();
+        }
+        if (check_win(board, column)) {
+            return disk;
+        }
+    }
+    return CELL_EMPTY;
+}
+
+
+/* Function: simulate                                                         */
+/*   Plays MCTS_LANES random games from position on board. Boards that fit in */
+/*   64 bits are played by batched bitboard kernel, others by one game with  */
+/*   weight of MCTS_LANES games.                                              */
+/* Parameter(s):                                                              */
+/*   board - position to play from (modified)                                 */
+/*   seed  - state of random number generator                                 */
+/* Returns:                                                                   */
+/*   Score of player X in half-points (0...SCORE_WIN).                        */
+static int simulate(conn4_state* board, unsigned long long* seed) {
+    unsigned int i;
+    int score = 0;
+    char winner;
+    playout_batch batch;
+
+    if (!playout_supported()) {
+        winner = playout(board, seed);
+        return (winner == CELL_EMPTY ? SCORE_DRAW
+                : (winner == CELL_X ? SCORE_WIN : 0));
+    }
+    board_to_bits(board, &batch.own[0], &batch.all[0]);
+    for (i = 0; i < MCTS_LANES; ++i) {
+        batch.own[i] = batch.own[0];
+        batch.all[i] = batch.all[0];
+        batch.moves[i] = board->moves;
+        batch.seed[i] = (((unsigned long long)next_random(seed)) << 32) |
+                next_random(seed) | 1;
+    }
+    playout_run(&batch, MCTS_LANES);
+    /* Results are from point of view of player to move */
+    for (i = 0; i < MCTS_LANES; ++i) {
+        score += batch.result[i] + 1;
+    }
+    return (board->moves % 2 == 0 ? score : SCORE_WIN - score);
+}
+
+
+/* Function: search                                                           */
+/*   Thread function that grows tree until deadline. Every iteration selects  */
+/*   path by UCT adding virtual loss (a visit without score) to every node on */
+/*   the way, so concurrent threads spread over different paths, expands leaf */
+/*   node, finishes the game by random playouts and adds result to nodes of   */
+/*   path.                                                                    */
+/* Parameter(s):                                                              */
+/*   arg - worker structure                                                   */
+static void* search(void* arg) {
+    mcts_worker* self = arg;
+    unsigned int depth, i;
+    mcts_node* node;
+    int score;      /* Score of player X in half-points */
+    char disk;
+    /* Nodes on path from root (one per move at most, plus root) */
+    mcts_node** path = malloc((get_size() + 1) * sizeof(*path));
+    conn4_state* board = create_board();
+
+    while (monotonic_time() < deadline && !move_cancelled(search_ctl)) {
+        board_copy(board, root_board);
+        node = &pool[root];
+        __atomic_add_fetch(&node->visits, 1, __ATOMIC_RELAXED);
+        path[0] = node;
+        depth = 1;
+
+        /* Selection */
+        while (node->over == GAME_ON) {
+            if (__atomic_load_n(&node->state, __ATOMIC_ACQUIRE) !=
+                    NODE_EXPANDED) {
+                if (node->visits < 2) {
+                    break;  /* Leaf is expanded on its second visit */
+                }
+                expand(node, board);
+                if (__atomic_load_n(&node->state, __ATOMIC_ACQUIRE) !=
+                        NODE_EXPANDED) {
+                    break;
+                }
+            }
+            node = select_child(node);
+            __atomic_add_fetch(&node->visits, 1, __ATOMIC_RELAXED);
+            path[depth++] = node;
+            disk = (board->moves % 2 == 0 ? CELL_X : CELL_O);
+            set_cell(board, node->move, disk);
+            if (check_win(board, node->move)) {
+                node->over = GAME_WON;
+            } else if (board->moves == get_size()) {
+                node->over = GAME_DRAWN;
+            }
+        }
+        if (node->over == GAME_WON) {
+            /* Winner is the player who made move into node */
+            score = (board->moves % 2 != 0 ? SCORE_WIN : 0);
+        } else if (node->over == GAME_DRAWN) {
+            score = SCORE_DRAW;
+        } else {
+            score = simulate(board, &self->seed);
+        }
+
+        /* Backpropagation: virtual loss becomes a real visit with score */
+        board_copy(board, root_board);
+        for (i = 1; i < depth; ++i) {
+            disk = ((board->moves + i) % 2 != 0 ? CELL_X : CELL_O);
+            __atomic_add_fetch(&path[i]->score, (disk == CELL_X ? score
+                    : SCORE_WIN - score), __ATOMIC_RELAXED);
+        }
+        self->playouts += (playout_supported() ? MCTS_LANES : 1);
+    }
+
+    free(path);
+    destruct_board(board);
+    return NULL;
+}
+
+
+/* Function: reuse_tree                                                       */
+/*   Finds node of current position among children and grandchildren of old  */
+/*   root, so that statistics collected during previous moves are kept.       */
+/*   Otherwise tree is reset.                                                 */
+/* Parameter(s):                                                              */
+/*   board - current position                                                 */
+/* Returns:                                                                   */
+/*   1 if tree is ready, 0 if memory allocation failed.                       */
+static int reuse_tree(conn4_state* board) {
+    unsigned int i, j;
+    mcts_node *child, *grandchild;
+    int found = 0;
+
+    if (pool != NULL && root_cols == get_cols() && root_rows == get_rows() &&
+            pool_used < POOL_NODES / 4 * 3 && pool[root].child != 0) {
+        for (i = 0; i < pool[root].children && !found; ++i) {
+            child = &pool[pool[root].child + i];
+            set_cell(root_board, child->move,
+                    root_board->moves % 2 == 0 ? CELL_X : CELL_O);
+            if (board->moves == root_board->moves &&
+                    memcmp(board->info, root_board->info, board_bytes()) == 0) {
+                root = pool[root].child + i;
+                found = 1;
+            }
+            for (j = 0; child->child != 0 && j < child->children && !found;
+                    ++j) {
+                grandchild = &pool[child->child + j];
+                set_cell(root_board, grandchild->move,
+                        root_board->moves % 2 == 0 ? CELL_X : CELL_O);
+                if (board->moves == root_board->moves && memcmp(board->info,
+                        root_board->info, board_bytes()) == 0) {
+                    root = child->child + j;
+                    found = 1;
+                }
+                unset_cell(root_board, grandchild->move);
+            }
+            unset_cell(root_board, child->move);
+        }
+    }
+
+    if (!found) {
+        if (pool == NULL) {
+            pool = malloc(POOL_NODES * sizeof(*pool));
+        }
+        if (root_board == NULL || root_cols != get_cols() ||
+                root_rows != get_rows()) {
+            destruct_board(root_board);
+            root_board = create_board();
+            root_cols = get_cols();
+            root_rows = get_rows();
+        }
+        if (pool == NULL || root_board == NULL) {
+            return 0;
+        }
+        pool_used = 1;  /* Node 0 is never used, index 0 means "no node" */
+        root = new_nodes(1);
+        init_node(&pool[root], -1);
+    }
+    board_copy(root_board, board);
+    return 1;
+}
+
+
+/* Function: immediate_move                                                   */
+/*   Finds move that wins at once or blocks opponent's immediate win.         */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   Column of such move, or -1 if there is none.                             */
+static int immediate_move(conn4_state* board) {
+    unsigned int column, k;
+    int win;
+    char disk;
+
+    for (k = 0; k < 2; ++k) {
+        disk = ((board->moves + k) % 2 == 0 ? CELL_X : CELL_O);
+        for (column = 0; column < get_cols(); ++column) {
+            if (set_cell(board, column, disk)) {
+                win = check_win(board, column);
+                unset_cell(board, column);
+                if (win) {
+                    return column;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+
+/* Function: mcts_move_timed                                                  */
+/*   Decision-making function of Monte Carlo Tree Search player. Tree is      */
+/*   grown by all processor cores until DEADLINE_MARGIN before deadline of    */
+/*   request (MCTS_TIME seconds if there is none) or its cancellation, and    */
+/*   the most visited move is selected. Tree is kept for the next move. If    */
+/*   tree can't be allocated, any legal move is taken.                        */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   ctl   - limits of request, or NULL if there are none                     */
+/* Returns:                                                                   */
+/*   Index of chosen move.                                                    */
+int mcts_move_timed(conn4_state* board, const move_ctl* ctl) {
+    unsigned int i, threads;
+    int column, best = -1;
+    unsigned long long playouts = 0;
+    mcts_worker workers[MAX_THREADS];
+    mcts_node* child;
+
+    column = immediate_move(board);
+    if (column < 0) {
+        pthread_mutex_lock(&mcts_lock);
+        if (!reuse_tree(board)) {
+            pthread_mutex_unlock(&mcts_lock);
+            /* Take any legal move */
+            for (column = 0; get_height(board, column) == get_rows();
+                    ++column) {
+            }
+            printf("Selected column: %d\n", column + 1);
+            return column;
+        }
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (threads < 1 ? 1 : (threads > MAX_THREADS ? MAX_THREADS
+                : threads));
+        search_ctl = ctl;
+        /* Workers stop early enough to be joined and move to be selected */
+        deadline = (ctl != NULL && ctl->deadline > 0.0 ?
+                ctl->deadline - DEADLINE_MARGIN : monotonic_time() + MCTS_TIME);
+        for (i = 0; i < threads; ++i) {
+            workers[i].seed = (unsigned long long)time(NULL) * 2654435761ULL
+                    + i * 0x9E3779B97F4A7C15ULL + 1;
+            workers[i].playouts = 0;
+            pthread_create(&workers[i].thread, NULL, search, &workers[i]);
+        }
+        for (i = 0; i < threads; ++i) {
+            pthread_join(workers[i].thread, NULL);
+            playouts += workers[i].playouts;
+        }
+        /* Select the most visited move */
+        TRACE_BEGIN_ARG("mcts_select", "playouts", (long)playouts);
+        for (i = 0; i < pool[root].children; ++i) {
+            child = &pool[pool[root].child + i];
+            if (child->visits > best) {
+                best = child->visits;
+                column = child->move;
+            }
+        }
+        if (column < 0) {
+            /* Tree couldn't grow, take any legal move */
+            for (column = 0; get_height(board, column) == get_rows();
+                    ++column) {
+            }
+        }
+        TRACE_END("mcts_select");
+        search_ctl = NULL;
+        pthread_mutex_unlock(&mcts_lock);
+    }
+
+    /* Output selected column in one-based indexing */
+    printf("Selected column: %d\n", column + 1);
+
+    return column;
+}
+
+
+/* Function: mcts_move                                                        */
+/*   Decision-making function of Monte Carlo Tree Search player without       */
+/*   limits of request (see mcts_move_timed()).                               */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   Index of chosen move.                                                    */
+int mcts_move(conn4_state* board) {
+    return mcts_move_timed(board, NULL);
+}
+
+
+#endif /* _MCTS_C_ */
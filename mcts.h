@@ -0,0 +1,15 @@
+#ifndef _MCTS_H_
+#define _MCTS_H_
+
+#include "player.h"
+
+
+/* Decision-making function of Monte Carlo Tree Search player. Call this      */
+/* function to request MCTS player for its next move.                         */
+int mcts_move(conn4_state* board);
+
+/* The same function that respects limits of move request (see player.h).     */
+int mcts_move_timed(conn4_state* board, const move_ctl* ctl);
+
+
+#endif /* _MCTS_H_ */
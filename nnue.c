@@ -0,0 +1,235 @@
+#ifndef _NNUE_C_
+#define _NNUE_C_
+
+#include "nnue.h"
+#include "kernels.h"
+#include <stdio.h>      /* FILE, fopen(), fread(), fwrite(), fclose() */
+#include <stdlib.h>     /* malloc(), calloc(), free() */
+#include <string.h>     /* memcpy(), memcmp(), memset() */
+
+
+/* Signature of weights file                                                  */
+#define NNUE_MAGIC      "CONN4NN1"
+/* Limit of quantized weights, keeps sums far from overflow                   */
+#define QUANT_LIMIT     32767
+
+
+/* Header of weights file. Floats of nnue_params follow header: bias,         */
+/* weights of features, output weights and output bias.                       */
+typedef struct {
+    char magic[8];          /* NNUE_MAGIC */
+    unsigned int columns;   /* Dimensions of board */
+    unsigned int rows;
+    unsigned int hidden;    /* NNUE_HIDDEN */
+    unsigned int reserved;
+} nnue_header;
+
+
+/* Quantized network, or NULL arrays if network isn't loaded. Weights of     */
+/* hidden layer are used by accumulator of boards (see set_accumulator()).   */
+static int* bias = NULL;
+static int* features = NULL;
+static int output[2][NNUE_HIDDEN];
+static int out_bias[2];
+
+
+/* Function: feature_count                                                    */
+/* Returns:                                                                   */
+/*   Number of weights of features of board of current dimensions.           */
+static size_t feature_count(void) {
+    return (size_t)2 * get_size() * NNUE_HIDDEN;
+}
+
+
+/* Function: quantize                                                         */
+/* Parameter(s):                                                              */
+/*   value - weight                                                           */
+/*   scale - fixed-point scale                                                */
+/* Returns:                                                                   */
+/*   Weight rounded to fixed point and limited by QUANT_LIMIT.               */
+static int quantize(float value, float scale) {
+    float q = value * scale;
+    if (q > QUANT_LIMIT) {
+        return QUANT_LIMIT;
+    }
+    if (q < -QUANT_LIMIT) {
+        return -QUANT_LIMIT;
+    }
+    return (int)(q < 0 ? q - 0.5f : q + 0.5f);
+}
+
+
+/* Function: nnue_alloc                                                       */
+/*   Allocates weights of network for board of current dimensions; all       */
+/*   weights are zero.                                                        */
+/* Parameter(s):                                                              */
+/*   params - weights                                                         */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory allocation failed.                          */
+int nnue_alloc(nnue_params* params) {
+    memset(params, 0, sizeof(*params));
+    params->features = calloc(feature_count(), sizeof(float));
+    return (params->features != NULL);
+}
+
+
+/* Function: nnue_free                                                        */
+/*   Releases weights allocated by nnue_alloc() or nnue_read().               */
+/* Parameter(s):                                                              */
+/*   params - weights                                                         */
+void nnue_free(nnue_params* params) {
+    free(params->features);
+    params->features = NULL;
+    return;
+}
+
+
+/* Function: nnue_read                                                        */
+/*   Reads weights from file. Weights must be trained for board of current    */
+/*   dimensions.                                                              */
+/* Parameter(s):                                                              */
+/*   filename - name of file                                                  */
+/*   params   - where weights will be written (allocated by this function)   */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise.                                            */
+int nnue_read(const char* filename, nnue_params* params) {
+    nnue_header head;
+    FILE* file = fopen(filename, "rb");
+    int ok;
+
+    if (file == NULL) {
+        return 0;
+    }
+    ok = (fread(&head, sizeof(head), 1, file) == 1 &&
+            memcmp(head.magic, NNUE_MAGIC, sizeof(head.magic)) == 0 &&
+            head.columns == get_cols() && head.rows == get_rows() &&
+            head.hidden == NNUE_HIDDEN && nnue_alloc(params));
+    if (ok) {
+        ok = (fread(params->bias, sizeof(params->bias), 1, file) == 1 &&
+                fread(params->features, sizeof(float), feature_count(),
+                        file) == feature_count() &&
+                fread(params->output, sizeof(params->output), 1, file) == 1 &&
+                fread(params->out_bias, sizeof(params->out_bias), 1,
+                        file) == 1);
+        if (!ok) {
+            nnue_free(params);
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+
+/* Function: nnue_write                                                       */
+/*   Writes weights to file.                                                  */
+/* Parameter(s):                                                              */
+/*   filename - name of file                                                  */
+/*   params   - weights of board of current dimensions                        */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise.                                            */
+int nnue_write(const char* filename, const nnue_params* params) {
+    nnue_header head;
+    FILE* file = fopen(filename, "wb");
+    int ok;
+
+    if (file == NULL) {
+        return 0;
+    }
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, NNUE_MAGIC, sizeof(head.magic));
+    head.columns = get_cols();
+    head.rows = get_rows();
+    head.hidden = NNUE_HIDDEN;
+    ok = (fwrite(&head, sizeof(head), 1, file) == 1 &&
+            fwrite(params->bias, sizeof(params->bias), 1, file) == 1 &&
+            fwrite(params->features, sizeof(float), feature_count(),
+                    file) == feature_count() &&
+            fwrite(params->output, sizeof(params->output), 1, file) == 1 &&
+            fwrite(params->out_bias, sizeof(params->out_bias), 1, file) == 1);
+    return (fclose(file) == 0 && ok);
+}
+
+
+/* Function: nnue_open                                                        */
+/*   Loads weights file, quantizes weights and enables accumulator of boards, */
+/*   so that hidden layer is updated by every move instead of being computed  */
+/*   at every leaf. Since then eval() uses network.                           */
+/* Parameter(s):                                                              */
+/*   filename - name of file                                                  */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise (eval() stays as it was).                   */
+int nnue_open(const char* filename) {
+    nnue_params params;
+    size_t i;
+    unsigned int p;
+
+    nnue_close();
+    if (!nnue_read(filename, &params)) {
+        return 0;
+    }
+    bias = malloc(NNUE_HIDDEN * sizeof(*bias));
+    features = malloc(feature_count() * sizeof(*features));
+    if (bias == NULL || features == NULL) {
+        nnue_free(&params);
+        nnue_close();
+        return 0;
+    }
+    for (i = 0; i < NNUE_HIDDEN; ++i) {
+        bias[i] = quantize(params.bias[i], NNUE_QA);
+    }
+    for (i = 0; i < feature_count(); ++i) {
+        features[i] = quantize(params.features[i], NNUE_QA);
+    }
+    for (p = 0; p < 2; ++p) {
+        for (i = 0; i < NNUE_HIDDEN; ++i) {
+            output[p][i] = quantize(params.output[p][i], NNUE_QB);
+        }
+        /* Output bias is added to sum of scale NNUE_QA * NNUE_QB */
+        out_bias[p] = (int)(params.out_bias[p] * NNUE_QA * NNUE_QB);
+    }
+    nnue_free(&params);
+
+    set_accumulator(NNUE_HIDDEN, bias, features);
+    return 1;
+}
+
+
+/* Function: nnue_close                                                       */
+/*   Disables accumulator of boards and releases network.                     */
+void nnue_close(void) {
+    if (bias != NULL || features != NULL) {
+        set_accumulator(0, NULL, NULL);
+    }
+    free(bias);
+    free(features);
+    bias = NULL;
+    features = NULL;
+    return;
+}
+
+
+/* Function: nnue_active                                                      */
+/* Returns:                                                                   */
+/*   1 if network is loaded and boards have accumulator (changing of          */
+/*   dimensions disables it), 0 otherwise.                                    */
+int nnue_active(void) {
+    return (features != NULL && accumulator_width() == NNUE_HIDDEN);
+}
+
+
+/* Function: nnue_eval                                                        */
+/*   Evaluates position by output layer applied to accumulator of board.      */
+/* Parameter(s):                                                              */
+/*   board - board structure (created after nnue_open())                      */
+/* Returns:                                                                   */
+/*   Estimation for player to move, strictly between -1 and +1.               */
+float nnue_eval(const conn4_state* board) {
+    unsigned int p = board->moves % 2;
+    float v = (kernels.dot_clipped(get_accumulator(board), output[p],
+            NNUE_HIDDEN, NNUE_QA) + out_bias[p]) /
+            ((float)NNUE_QA * NNUE_QB);
+    return NNUE_SQUASH(v);
+}
+
+
+#endif /* _NNUE_C_ */
@@ -0,0 +1,59 @@
+#ifndef _NNUE_H_
+#define _NNUE_H_
+
+#include "conn4.h"
+
+
+/* Name of weights file of board of selected dimensions (columns, rows)      */
+#define NNUE_FILENAME   "eval%ux%u.bin"
+/* Number of neurons of hidden layer                                          */
+#define NNUE_HIDDEN     32
+/* Fixed-point scales of hidden layer (1.0 is clip of activation) and of     */
+/* weights of output layer                                                    */
+#define NNUE_QA         256
+#define NNUE_QB         256
+
+/* Macros: Maps output of network to estimation on the scale -1...+1        */
+#define NNUE_SQUASH(v)  ((v) / (1.0f + ((v) < 0 ? -(v) : (v))))
+
+
+/* Weights of evaluation network. Every disk is a feature: disk at cell      */
+/* (column, row) has index 2 * (column * rows + row) for 'X' and the next    */
+/* one for 'O' (see set_accumulator()). Hidden layer is sum of bias and      */
+/* weights of features, clipped to 0...1; output layer has separate weights */
+/* for each player to move and gives value for that player.                   */
+typedef struct {
+    float bias[NNUE_HIDDEN];        /* Bias of hidden layer */
+    float* features;                /* NNUE_HIDDEN weights of every feature */
+    float output[2][NNUE_HIDDEN];   /* Output weights if 'X'/'O' is to move */
+    float out_bias[2];              /* Output bias if 'X'/'O' is to move */
+} nnue_params;
+
+
+/* Allocates zero weights for board of current dimensions.                    */
+int nnue_alloc(nnue_params* params);
+
+/* Releases weights.                                                          */
+void nnue_free(nnue_params* params);
+
+/* Reads weights of board of current dimensions from file.                    */
+int nnue_read(const char* filename, nnue_params* params);
+
+/* Writes weights of board of current dimensions to file.                     */
+int nnue_write(const char* filename, const nnue_params* params);
+
+/* Loads weights file and switches eval() to network. Call before boards are */
+/* created, because it enables accumulator of boards.                         */
+int nnue_open(const char* filename);
+
+/* Switches eval() back to counting of open positions.                        */
+void nnue_close(void);
+
+/* Checks if network is loaded (and dimensions haven't changed since).       */
+int nnue_active(void);
+
+/* Evaluates position for player to move on the scale -1...+1.              */
+float nnue_eval(const conn4_state* board);
+
+
+#endif /* _NNUE_H_ */
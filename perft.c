@@ -0,0 +1,256 @@
+#ifndef _PERFT_C_
+#define _PERFT_C_
+
+#include "conn4.h"
+#include <stdio.h>      /* printf(), fprintf() */
+#include <stdlib.h>     /* malloc(), calloc(), free(), atoi(), EXIT_* */
+#include <string.h>     /* memcmp(), memcpy(), strcmp() */
+#include <time.h>       /* clock_gettime() */
+#include <pthread.h>    /* pthread_create(), pthread_join() */
+
+
+/* Maximal number of worker threads                                           */
+#define MAX_THREADS     64
+
+
+/* Counts of positions at certain ply                                         */
+typedef struct {
+    unsigned long long open;    /* Positions where game goes on */
+    unsigned long long over;    /* Positions where game is over */
+} perft_count;
+
+/* Table of already counted subtrees. Each entry keeps exact copy of cell    */
+/* storage of position, so results are never mixed up by hash collisions.    */
+typedef struct {
+    unsigned int size;          /* Number of entries (power of two) */
+    unsigned char* keys;        /* Cell storage of positions */
+    unsigned int* depths;       /* Remaining depth, 0 marks free entry */
+    perft_count* counts;        /* Counted positions */
+} perft_table;
+
+/* State of worker thread                                                     */
+typedef struct {
+    pthread_t thread;
+    unsigned int depth;         /* Depth of search from root */
+    perft_table table;          /* Private table (if hashing is enabled) */
+    perft_count count;          /* Result */
+} perft_worker;
+
+
+/* Work is split into pairs of the first two moves which are distributed     */
+/* between workers dynamically.                                               */
+static unsigned int next_unit = 0;
+/* Number of entries of hash table of every worker (0 disables hashing)      */
+static unsigned int table_size = 0;
+
+
+/* Function: table_init                                                       */
+/*   Allocates an empty table of counted subtrees.                            */
+/* Parameter(s):                                                              */
+/*   table - table structure                                                  */
+/*   size  - number of entries (power of two), 0 disables table               */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory allocation failed.                          */
+static int table_init(perft_table* table, unsigned int size) {
+    table->size = size;
+    if (size == 0) {
+        table->keys = NULL;
+        table->depths = NULL;
+        table->counts = NULL;
+        return 1;
+    }
+    table->keys = malloc((size_t)size * board_bytes());
+    table->depths = calloc(size, sizeof(*table->depths));
+    table->counts = malloc(size * sizeof(*table->counts));
+    return (table->keys != NULL && table->depths != NULL &&
+            table->counts != NULL);
+}
+
+
+/* Function: table_free                                                       */
+/*   Releases memory of table of counted subtrees.                            */
+/* Parameter(s):                                                              */
+/*   table - table structure                                                  */
+static void table_free(perft_table* table) {
+    free(table->keys);
+    free(table->depths);
+    free(table->counts);
+    return;
+}
+
+
+/* Function: perft                                                            */
+/*   Counts positions at selected depth below position on board. Position    */
+/*   where last move made winning alignment or filled the board is over and  */
+/*   isn't expanded any further.                                              */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   depth - remaining depth, at least 1                                      */
+/*   table - table of counted subtrees                                        */
+/*   count - where counts will be added                                       */
+static void perft(conn4_state* board, unsigned int depth, perft_table* table,
+        perft_count* count) {
+    unsigned int column, slot = 0;
+    perft_count sub = { 0, 0 };
+    char disk = (board->moves % 2 == 0 ? CELL_X : CELL_O);
+
+    if (table->size > 0 && depth > 1) {
+        slot = board_hash(board) & (table->size - 1);
+        if (table->depths[slot] == depth && memcmp(table->keys +
+                (size_t)slot * board_bytes(), board->info, board_bytes()) == 0) {
+            count->open += table->counts[slot].open;
+            count->over += table->counts[slot].over;
+            return;
+        }
+    }
+
+    for (column = 0; column < get_cols(); ++column) {
+        if (set_cell(board, column, disk)) {
+            if (check_win(board, column) || board->moves == get_size()) {
+                sub.over += (depth == 1);
+            } else if (depth == 1) {
+                ++sub.open;
+            } else {
+                perft(board, depth - 1, table, &sub);
+            }
+            unset_cell(board, column);
+        }
+    }
+
+    if (table->size > 0 && depth > 1) {
+        memcpy(table->keys + (size_t)slot * board_bytes(), board->info,
+                board_bytes());
+        table->depths[slot] = depth;
+        table->counts[slot] = sub;
+    }
+    count->open += sub.open;
+    count->over += sub.over;
+    return;
+}
+
+
+/* Function: worker                                                           */
+/*   Thread function that takes pairs of the first two moves one by one and   */
+/*   counts positions below them.                                             */
+/* Parameter(s):                                                              */
+/*   arg - worker structure                                                   */
+static void* worker(void* arg) {
+    perft_worker* self = arg;
+    conn4_state* board = create_board();
+    unsigned int unit, first, second;
+
+    while ((unit = __sync_fetch_and_add(&next_unit, 1)) <
+            get_cols() * get_cols()) {
+        first = unit / get_cols();
+        second = unit % get_cols();
+        init_board(board, board->info);
+        set_cell(board, first, CELL_X);
+        if (second == 0 && (check_win(board, first) ||
+                board->moves == get_size())) {
+            self->count.over += (self->depth == 1);
+            continue;   /* First move ends the game (counted once) */
+        }
+        if (second == 0 && self->depth == 1) {
+            ++self->count.open;
+        }
+        if (self->depth == 1 || check_win(board, first) ||
+                board->moves == get_size() ||
+                !set_cell(board, second, CELL_O)) {
+            continue;
+        }
+        if (check_win(board, second) || board->moves == get_size()) {
+            self->count.over += (self->depth == 2);
+        } else if (self->depth == 2) {
+            ++self->count.open;
+        } else {
+            perft(board, self->depth - 2, &self->table, &self->count);
+        }
+    }
+
+    destruct_board(board);
+    return NULL;
+}
+
+
+/* Function: seconds                                                          */
+/* Returns:                                                                   */
+/*   Current value of monotonic clock in seconds.                             */
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* Function: main                                                             */
+/*   Counts positions reachable at every ply up to selected depth. Used as    */
+/*   correctness oracle for board implementations and as benchmark of move   */
+/*   generation and undo.                                                     */
+/*   Usage: perft columns rows depth [threads] [hash-bits]                    */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    unsigned int columns, rows, depth, threads = 1, bits = 0;
+    unsigned int d, i;
+    unsigned long long nodes = 0;
+    perft_worker workers[MAX_THREADS];
+    perft_count total;
+    double t0, t;
+
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s columns rows depth [threads] "
+                "[hash-bits]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    columns = atoi(argv[1]);
+    rows = atoi(argv[2]);
+    depth = atoi(argv[3]);
+    if (argc > 4) {
+        threads = atoi(argv[4]);
+    }
+    if (argc > 5) {
+        bits = atoi(argv[5]);
+    }
+    if (columns < MIN_COLUMNS || rows < MIN_ROWS || rows > 255 ||
+            threads < 1 || threads > MAX_THREADS || bits > 30) {
+        fprintf(stderr, "Error: invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+    set_dimensions(columns, rows);
+    table_size = (bits > 0 ? 1U << bits : 0);
+
+    printf("%5s %20s %20s %10s\n", "ply", "open", "over", "seconds");
+    for (d = 1; d <= depth; ++d) {
+        t0 = seconds();
+        next_unit = 0;
+        total.open = total.over = 0;
+        for (i = 0; i < threads; ++i) {
+            workers[i].depth = d;
+            workers[i].count.open = workers[i].count.over = 0;
+            if (!table_init(&workers[i].table, table_size)) {
+                fprintf(stderr, "Error: cannot allocate hash table.\n");
+                return EXIT_FAILURE;
+            }
+            pthread_create(&workers[i].thread, NULL, worker, &workers[i]);
+        }
+        for (i = 0; i < threads; ++i) {
+            pthread_join(workers[i].thread, NULL);
+            total.open += workers[i].count.open;
+            total.over += workers[i].count.over;
+            table_free(&workers[i].table);
+        }
+        t = seconds() - t0;
+        nodes += total.open + total.over;
+        printf("%5u %20llu %20llu %10.3f\n", d, total.open, total.over, t);
+        if (total.open == 0) {
+            break;  /* Every game is over */
+        }
+    }
+    printf("Positions counted: %llu\n", nodes);
+
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _PERFT_C_ */
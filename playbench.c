@@ -0,0 +1,126 @@
+#ifndef _PLAYBENCH_C_
+#define _PLAYBENCH_C_
+
+#include "conn4.h"
+#include "playout.h"
+#include <stdio.h>      /* printf(), fprintf() */
+#include <stdlib.h>     /* atoi(), atof(), EXIT_* */
+#include <time.h>       /* clock_gettime() */
+#include <pthread.h>    /* pthread_create(), pthread_join() */
+
+
+/* Maximal number of threads                                                  */
+#define MAX_THREADS     64
+
+
+/* State of benchmark thread                                                  */
+typedef struct {
+    pthread_t thread;
+    unsigned long long seed;        /* Seed of random numbers */
+    unsigned long long playouts;    /* Finished playouts */
+    long long score[3];             /* Losses, draws and wins of X */
+} bench_worker;
+
+
+/* Duration of benchmark in seconds                                           */
+static double duration = 1.0;
+
+
+/* Function: seconds                                                          */
+/* Returns:                                                                   */
+/*   Current value of monotonic clock in seconds.                             */
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* Function: bench                                                            */
+/*   Thread function that plays batches of random games from empty board     */
+/*   until time is over.                                                      */
+/* Parameter(s):                                                              */
+/*   arg - worker structure                                                   */
+static void* bench(void* arg) {
+    bench_worker* self = arg;
+    playout_batch batch;
+    unsigned int i;
+    double stop = seconds() + duration;
+
+    for (i = 0; i < PLAYOUT_LANES; ++i) {
+        batch.seed[i] = self->seed + 0x9E3779B97F4A7C15ULL * (i + 1);
+    }
+    while (seconds() < stop) {
+        for (i = 0; i < PLAYOUT_LANES; ++i) {
+            batch.own[i] = batch.all[i] = 0;
+            batch.moves[i] = 0;
+        }
+        playout_run(&batch, PLAYOUT_LANES);
+        for (i = 0; i < PLAYOUT_LANES; ++i) {
+            ++(self->score[batch.result[i] + 1]);
+        }
+        self->playouts += PLAYOUT_LANES;
+    }
+    return NULL;
+}
+
+
+/* Function: main                                                             */
+/*   Measures speed of batched random playouts.                               */
+/*   Usage: playbench columns rows [seconds] [threads]                        */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    unsigned int i, threads = 1;
+    unsigned long long playouts = 0;
+    long long score[3] = {0, 0, 0};
+    bench_worker workers[MAX_THREADS];
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s columns rows [seconds] [threads]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    set_dimensions(atoi(argv[1]), atoi(argv[2]));
+    if (argc > 3) {
+        duration = atof(argv[3]);
+    }
+    if (argc > 4) {
+        threads = atoi(argv[4]);
+    }
+    if (!playout_supported()) {
+        fprintf(stderr, "Error: board must fit in 64 bits "
+                "(columns * (rows + 1) <= 64).\n");
+        return EXIT_FAILURE;
+    }
+    if (threads < 1 || threads > MAX_THREADS) {
+        fprintf(stderr, "Error: invalid number of threads (1-%d).\n",
+                MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < threads; ++i) {
+        workers[i].seed = 12345 + i;
+        workers[i].playouts = 0;
+        workers[i].score[0] = workers[i].score[1] = workers[i].score[2] = 0;
+        pthread_create(&workers[i].thread, NULL, bench, &workers[i]);
+    }
+    for (i = 0; i < threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+        playouts += workers[i].playouts;
+        score[0] += workers[i].score[0];
+        score[1] += workers[i].score[1];
+        score[2] += workers[i].score[2];
+    }
+
+    printf("Playouts: %llu (X wins %.1f%%, draws %.1f%%, O wins %.1f%%)\n",
+            playouts, 100.0 * score[2] / playouts, 100.0 * score[1] / playouts,
+            100.0 * score[0] / playouts);
+    printf("Playouts per second per core: %.0f\n",
+            playouts / duration / threads);
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _PLAYBENCH_C_ */
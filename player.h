@@ -11,11 +11,25 @@
 /* Below is the definition for a type of functions that behave as player.     */
 typedef int (*get_move_func)(conn4_state*);
 
+/* Limits of a move request. Player should give up and return -1 (or the best */
+/* move found so far) once deadline passes or request is cancelled. Flag of   */
+/* cancellation is set by other thread, so it is accessed only atomically     */
+/* (see move_cancelled() and cancel_move() in async.h).                       */
+typedef struct {
+	double			deadline;	/* Monotonic time in seconds, 0 if none */
+	int				cancelled;	/* Nonzero if request is cancelled */
+} move_ctl;
+
+/* Decision-making function that respects limits of request (NULL means no   */
+/* limits).                                                                   */
+typedef int (*get_move_timed_func)(conn4_state*, const move_ctl*);
+
 /* Player type besides of decision-making function has name and playing disk. */
 typedef struct {
-	get_move_func	get_move;	/* Function that makes moves */
-	char 			disk;		/* Disk type of player, either 'X' or 'O' */
-	char* 			name;		/* Name of player */
+	get_move_func		get_move;		/* Function that makes moves */
+	get_move_timed_func	get_move_timed;	/* The same function with limits */
+	char 				disk;			/* Disk type of player, 'X' or 'O' */
+	char* 				name;			/* Name of player */
 } player_t;
 
 
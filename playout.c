@@ -0,0 +1,160 @@
+#ifndef _PLAYOUT_C_
+#define _PLAYOUT_C_
+
+#include "playout.h"
+
+
+/* Function: playout_supported                                                */
+/* Returns:                                                                   */
+/*   1 if board of current dimensions (with spare bit on top of every column) */
+/*   fits in 64 bits, 0 otherwise.                                            */
+int playout_supported(void) {
+    return (get_cols() * (get_rows() + 1) <= 64);
+}
+
+
+/* Function: board_to_bits                                                    */
+/*   Converts board to bitboards.                                             */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   own   - where bitboard of disks of player to move will be written        */
+/*   all   - where bitboard of all disks will be written                      */
+void board_to_bits(conn4_state* board, unsigned long long* own,
+        unsigned long long* all) {
+    unsigned int column, row;
+    unsigned long long bit;
+    char disk = (board->moves % 2 == 0 ? CELL_X : CELL_O);
+
+    *own = *all = 0;
+    for (column = 0; column < get_cols(); ++column) {
+        for (row = 0; row < get_height(board, column); ++row) {
+            bit = 1ULL << (column * (get_rows() + 1) + row);
+            *all |= bit;
+            if (get_cell(board, column, row) == disk) {
+                *own |= bit;
+            }
+        }
+    }
+    return;
+}
+
+
+/* Function: aligned                                                          */
+/*   Checks if bitboard has four disks in a row in any direction.             */
+/* Parameter(s):                                                              */
+/*   bits   - bitboard                                                        */
+/*   height - number of bits per column (rows + 1)                            */
+/* Returns:                                                                   */
+/*   Nonzero if there is a winning alignment, 0 otherwise.                    */
+static inline unsigned long long aligned(unsigned long long bits,
+        unsigned int height) {
+    unsigned long long m, win;
+
+    m = bits & (bits >> 1);                     /* Vertical */
+    win = m & (m >> 2);
+    m = bits & (bits >> height);                /* Horizontal */
+    win |= m & (m >> 2 * height);
+    m = bits & (bits >> (height - 1));          /* Falling diagonal */
+    win |= m & (m >> 2 * (height - 1));
+    m = bits & (bits >> (height + 1));          /* Rising diagonal */
+    win |= m & (m >> 2 * (height + 1));
+    return win;
+}
+
+
+/* Function: bits_won                                                         */
+/*   Checks if bitboard of current dimensions has four disks in a row.        */
+/* Parameter(s):                                                              */
+/*   bits - bitboard                                                          */
+/* Returns:                                                                   */
+/*   1 if there is a winning alignment, 0 otherwise.                          */
+int bits_won(unsigned long long bits) {
+    return (aligned(bits, get_rows() + 1) != 0);
+}
+
+
+/* Function: playout_run                                                      */
+/*   Plays every game of batch to the end with uniformly random moves. All   */
+/*   games advance by one move per step: first every lane picks a random      */
+/*   playable cell, then moves and win checks are applied to all lanes.      */
+/*   Picking branches per lane: finished lanes are skipped and k-th playable */
+/*   cell is found by clearing k lowest playable bits. Moves and win checks  */
+/*   are branch-free, so compiler vectorizes them where SIMD has 64-bit      */
+/*   shifts (e.g. -mavx2); default target runs them as scalar code. Finished */
+/*   lanes just stop changing.                                                */
+/* Parameter(s):                                                              */
+/*   batch - games to play (own, all, moves and seed must be set)             */
+/*   lanes - number of games in batch (at most PLAYOUT_LANES)                 */
+void playout_run(playout_batch* batch, unsigned int lanes) {
+    unsigned int i, k, left, height = get_rows() + 1;
+    unsigned int size = get_size();
+    unsigned long long bottom = 0, board = 0, legal, s;
+    unsigned long long cell[PLAYOUT_LANES];     /* Chosen cell of move */
+    unsigned long long active[PLAYOUT_LANES];   /* All ones if game goes on */
+    unsigned long long mover[PLAYOUT_LANES];    /* Disks of mover after move */
+    unsigned long long won[PLAYOUT_LANES];      /* Nonzero if mover won */
+    unsigned int start[PLAYOUT_LANES];          /* Moves made before start */
+    unsigned int column;
+
+    /* Masks of bottom cells and of all cells of board (no spare bits) */
+    for (column = 0; column < get_cols(); ++column) {
+        bottom |= 1ULL << (column * height);
+        board |= ((1ULL << get_rows()) - 1) << (column * height);
+    }
+    left = 0;
+    for (i = 0; i < lanes; ++i) {
+        batch->result[i] = 0;
+        start[i] = batch->moves[i];
+        active[i] = (batch->moves[i] < size ? ~0ULL : 0);
+        left += (active[i] != 0);
+    }
+
+    while (left > 0) {
+        /* Pick random playable cell in every lane that goes on */
+        for (i = 0; i < lanes; ++i) {
+            legal = (batch->all[i] + bottom) & board & active[i];
+            cell[i] = 0;
+            if (legal != 0) {
+                s = batch->seed[i];
+                s ^= s >> 12;
+                s ^= s << 25;
+                s ^= s >> 27;
+                batch->seed[i] = s;
+                k = (unsigned int)(((s * 2685821657736338717ULL) >> 32) %
+                        __builtin_popcountll(legal));
+                while (k-- > 0) {
+                    legal &= legal - 1;
+                }
+                cell[i] = legal & (~legal + 1);
+            }
+        }
+        /* Apply moves and check for wins in all lanes */
+        for (i = 0; i < lanes; ++i) {
+            mover[i] = batch->own[i] | cell[i];
+            batch->all[i] |= cell[i];
+            batch->own[i] = (batch->own[i] & ~active[i]) |
+                    ((batch->all[i] ^ mover[i]) & active[i]);
+            batch->moves[i] += (cell[i] != 0);
+            won[i] = aligned(mover[i], height) & active[i];
+        }
+        /* Retire finished games */
+        for (i = 0; i < lanes; ++i) {
+            if (active[i] == 0) {
+                continue;
+            }
+            if (won[i] != 0) {
+                /* Player to move at start makes moves start, start+2, ... */
+                batch->result[i] =
+                        ((batch->moves[i] - 1 - start[i]) % 2 == 0 ? 1 : -1);
+            } else if (batch->moves[i] < size) {
+                continue;
+            }
+            active[i] = 0;
+            --left;
+        }
+    }
+    return;
+}
+
+
+#endif /* _PLAYOUT_C_ */
@@ -0,0 +1,38 @@
+#ifndef _PLAYOUT_H_
+#define _PLAYOUT_H_
+
+#include "conn4.h"
+
+
+/* Number of games advanced together by one batch                            */
+#define PLAYOUT_LANES   64
+
+
+/* Batch of independent random games on bitboards. Column c of board takes   */
+/* bits c*(rows+1) ... c*(rows+1)+rows-1 of 64-bit word (bottom cell first); */
+/* one spare bit on top of every column keeps alignments from wrapping.       */
+typedef struct {
+    unsigned long long own[PLAYOUT_LANES];  /* Disks of player to move */
+    unsigned long long all[PLAYOUT_LANES];  /* Disks of both players */
+    unsigned long long seed[PLAYOUT_LANES]; /* Random number generators */
+    unsigned int moves[PLAYOUT_LANES];      /* Moves made in every game */
+    int result[PLAYOUT_LANES];  /* Result for player to move at start: */
+                                /* +1 win, 0 draw, -1 loss */
+} playout_batch;
+
+
+/* Checks if board of current dimensions fits in 64-bit bitboard.             */
+int playout_supported(void);
+
+/* Converts board to bitboards of player to move and of all disks.            */
+void board_to_bits(conn4_state* board, unsigned long long* own,
+        unsigned long long* all);
+
+/* Checks if bitboard has a winning alignment of disks.                      */
+int bits_won(unsigned long long bits);
+
+/* Plays every game of batch to the end with random moves.                    */
+void playout_run(playout_batch* batch, unsigned int lanes);
+
+
+#endif /* _PLAYOUT_H_ */
@@ -0,0 +1,332 @@
+#ifndef _PNS_C_
+#define _PNS_C_
+
+#include "pns.h"
+#include "computer.h"
+#include "async.h"
+#include <stdlib.h>     /* malloc(), free() */
+
+
+/* Proof or disproof number of node that can't be proven (or disproven)      */
+#define PNS_INF         0x3fffffffU
+/* Number of iterations between checks of limits of request                 */
+#define PNS_CHECK       256
+
+/* Macros: Determines player whose turn is now                                */
+#define CURR_PLAYER(board)  ((board)->moves % 2 == 0 ? CELL_X : CELL_O)
+
+/* Macros: Determines player who made last move                              */
+#define PREV_PLAYER(board)  ((board)->moves % 2 != 0 ? CELL_X : CELL_O)
+
+
+/* Node of proof-number search tree. Proof number is the least number of     */
+/* leaves that must be proven to prove that attacker wins; disproof number   */
+/* is the same for disproof (draw counts as disproof). Children of node are  */
+/* stored one after another.                                                  */
+typedef struct {
+    unsigned int proof;     /* Proof number */
+    unsigned int disproof;  /* Disproof number */
+    int parent;             /* Index of parent node, -1 for root */
+    int child;              /* Index of the first child, -1 for leaf */
+    unsigned int children;  /* Number of children */
+    unsigned int move;      /* Column of move into node */
+} pns_node;
+
+/* Proof-number search of one player's win                                    */
+typedef struct {
+    pns_node* nodes;        /* Nodes of tree */
+    unsigned int used;      /* Number of used nodes */
+    unsigned int capacity;  /* Number of allocated nodes */
+    conn4_state* board;     /* Board at position of node being visited */
+    char attacker;          /* Disk of player whose win is searched */
+} pns_tree;
+
+
+/* Function: add                                                              */
+/*   Adds proof numbers saturating at PNS_INF.                                */
+static unsigned int add(unsigned int a, unsigned int b) {
+    return (a + b >= PNS_INF ? PNS_INF : a + b);
+}
+
+
+/* Function: init_leaf                                                        */
+/*   Sets proof numbers of new node after move into it is made on board.      */
+/*   Node is solved at once if mover wins, board is full, player to move     */
+/*   wins immediately or mover has two immediate wins. Otherwise numbers are */
+/*   initialized by number of moves that need to be searched: player to move */
+/*   that faces immediate win of opponent has single (blocking) move.         */
+/* Parameter(s):                                                              */
+/*   tree   - search tree                                                     */
+/*   node   - new node                                                        */
+/*   column - column of move into node                                        */
+static void init_leaf(pns_tree* tree, pns_node* node, unsigned int column) {
+    conn4_state* board = tree->board;
+    char mover = PREV_PLAYER(board), winner = CELL_EMPTY;
+    unsigned int c, moves = 0;
+    int threats, move;
+
+    node->child = -1;
+    node->children = 0;
+    node->move = column;
+    if (check_win(board, column)) {
+        winner = mover;
+    } else if (board->moves == get_size()) {
+        winner = CELL_EMPTY;    /* Draw */
+    } else if (count_win_moves(board, CURR_PLAYER(board), &move) > 0) {
+        winner = CURR_PLAYER(board);
+    } else if ((threats = count_win_moves(board, mover, &move)) > 1) {
+        winner = mover;         /* Both threats can't be blocked */
+    } else {
+        for (c = 0; c < get_cols(); ++c) {
+            moves += (get_height(board, c) < get_rows());
+        }
+        if (threats == 1) {
+            moves = 1;
+        }
+        if (CURR_PLAYER(board) == tree->attacker) {
+            node->proof = 1;
+            node->disproof = moves;
+        } else {
+            node->proof = moves;
+            node->disproof = 1;
+        }
+        return;
+    }
+    node->proof = (winner == tree->attacker ? 0 : PNS_INF);
+    node->disproof = (winner == tree->attacker ? PNS_INF : 0);
+    return;
+}
+
+
+/* Function: expand                                                           */
+/*   Creates children of leaf at position on board. If opponent of player to  */
+/*   move threatens to win immediately (and player can't win at once), only   */
+/*   blocking move is created.                                                */
+/* Parameter(s):                                                              */
+/*   tree  - search tree                                                      */
+/*   index - index of leaf                                                    */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if there are no free nodes.                           */
+static int expand(pns_tree* tree, int index) {
+    conn4_state* board = tree->board;
+    pns_node* node = &tree->nodes[index];
+    unsigned int i, column;
+    int block = -1;
+    char disk = CURR_PLAYER(board);
+
+    if (tree->used + get_cols() > tree->capacity) {
+        return 0;
+    }
+    /* Only root may have immediate win of player to move (see init_leaf()) */
+    if (count_win_moves(board, disk, &block) > 0 ||
+            count_win_moves(board, PREV_PLAYER(board), &block) == 0) {
+        block = -1;
+    }
+    node->child = tree->used;
+    for (i = 0; i < get_cols(); ++i) {
+        /* Central columns first (see eval_rec()) */
+        column = get_cols() / 2 - (i + 1) / 2 * ((i % 2) * 2 - 1);
+        if ((block >= 0 && column != (unsigned int)block) ||
+                !set_cell(board, column, disk)) {
+            continue;
+        }
+        tree->nodes[tree->used].parent = index;
+        init_leaf(tree, &tree->nodes[tree->used], column);
+        ++(tree->used);
+        unset_cell(board, column);
+    }
+    node->children = tree->used - node->child;
+    return 1;
+}
+
+
+/* Function: update                                                           */
+/*   Recomputes proof numbers of expanded node from its children: attacker   */
+/*   needs one proven move and all disproven, defender the other way round.  */
+/* Parameter(s):                                                              */
+/*   tree  - search tree                                                      */
+/*   index - index of node (board is at position of node)                     */
+static void update(pns_tree* tree, int index) {
+    pns_node* node = &tree->nodes[index];
+    pns_node* child;
+    unsigned int i, min = PNS_INF, sum = 0;
+    int attacker = (CURR_PLAYER(tree->board) == tree->attacker);
+
+    if (node->child < 0) {
+        return;
+    }
+    for (i = 0; i < node->children; ++i) {
+        child = &tree->nodes[node->child + i];
+        if (attacker) {
+            min = (child->proof < min ? child->proof : min);
+            sum = add(sum, child->disproof);
+        } else {
+            min = (child->disproof < min ? child->disproof : min);
+            sum = add(sum, child->proof);
+        }
+    }
+    node->proof = (attacker ? min : sum);
+    node->disproof = (attacker ? sum : min);
+    return;
+}
+
+
+/* Function: most_proving                                                     */
+/*   Selects child of expanded node that is the cheapest to solve: child      */
+/*   with the least proof number for attacker, the least disproof number for  */
+/*   defender.                                                                */
+/* Parameter(s):                                                              */
+/*   tree  - search tree                                                      */
+/*   index - index of node (board is at position of node)                     */
+/* Returns:                                                                   */
+/*   Index of selected child.                                                 */
+static int most_proving(pns_tree* tree, int index) {
+    pns_node* node = &tree->nodes[index];
+    unsigned int i;
+    int best = node->child;
+    int attacker = (CURR_PLAYER(tree->board) == tree->attacker);
+
+    for (i = 1; i < node->children; ++i) {
+        if (attacker ? tree->nodes[node->child + i].proof <
+                    tree->nodes[best].proof :
+                tree->nodes[node->child + i].disproof <
+                    tree->nodes[best].disproof) {
+            best = node->child + i;
+        }
+    }
+    return best;
+}
+
+
+/* Function: prove                                                            */
+/*   Runs proof-number search of attacker's win from position on board until  */
+/*   root is solved, nodes run out or request is stopped. Every iteration     */
+/*   descends to the most proving leaf, expands it and updates proof numbers  */
+/*   back to root, so effort goes to the narrowest (most forcing) lines.      */
+/* Parameter(s):                                                              */
+/*   tree - search tree with allocated nodes                                  */
+/*   ctl  - limits of request, or NULL if there are none                      */
+/* Returns:                                                                   */
+/*   1 if win is proven, 0 otherwise.                                         */
+static int prove(pns_tree* tree, const move_ctl* ctl) {
+    pns_node* root = &tree->nodes[0];
+    unsigned int iterations = 0;
+    int index, expanded = 1;
+
+    root->parent = -1;
+    root->child = -1;
+    root->children = 0;
+    root->proof = root->disproof = 1;
+    tree->used = 1;
+
+    while (expanded && root->proof != 0 && root->disproof != 0) {
+        if (++iterations % PNS_CHECK == 0 &&
+                move_stopped_before(ctl, DEADLINE_MARGIN)) {
+            break;
+        }
+        /* Descend to the most proving leaf */
+        for (index = 0; tree->nodes[index].child >= 0; ) {
+            index = most_proving(tree, index);
+            set_cell(tree->board, tree->nodes[index].move,
+                    CURR_PLAYER(tree->board));
+        }
+        expanded = expand(tree, index);
+        /* Update proof numbers on the way back to root */
+        for (;;) {
+            update(tree, index);
+            if (index == 0) {
+                break;
+            }
+            unset_cell(tree->board, tree->nodes[index].move);
+            index = tree->nodes[index].parent;
+        }
+    }
+    return (root->proof == 0);
+}
+
+
+/* Function: resisting_move                                                   */
+/*   Selects move of root (after loss is proven) that resists the longest:   */
+/*   the one whose proof took the most nodes. Children are always stored     */
+/*   after their parent, so sizes of subtrees are summed by one backward     */
+/*   pass. Move that doesn't block immediate win of opponent is proven with  */
+/*   no children, so blocking move is preferred.                              */
+/* Parameter(s):                                                              */
+/*   tree - search tree with proven win of opponent of player to move        */
+/* Returns:                                                                   */
+/*   Column of move, or -1 if root has no moves or memory allocation failed.  */
+static int resisting_move(const pns_tree* tree) {
+    const pns_node* root = &tree->nodes[0];
+    unsigned int* size = malloc(tree->used * sizeof(*size));
+    unsigned int i, best = root->child;
+    int move;
+
+    if (size == NULL || root->children == 0) {
+        free(size);
+        return -1;
+    }
+    for (i = 0; i < tree->used; ++i) {
+        size[i] = 1;
+    }
+    for (i = tree->used - 1; i > 0; --i) {
+        size[tree->nodes[i].parent] += size[i];
+    }
+    for (i = 1; i < root->children; ++i) {
+        if (size[root->child + i] > size[best]) {
+            best = root->child + i;
+        }
+    }
+    move = tree->nodes[best].move;
+    free(size);
+    return move;
+}
+
+
+/* Function: pns_search                                                       */
+/*   Proof-number search for forced result. The first half of nodes is spent  */
+/*   on search of win of player to move, the second half on search of win of  */
+/*   opponent (which proves loss).                                            */
+/* Parameter(s):                                                              */
+/*   board - board structure (restored before return)                         */
+/*   nodes - maximal number of nodes of search tree                           */
+/*   ctl   - limits of request, or NULL if there are none                     */
+/*   move  - where winning move (if win is proven) or the longest resisting  */
+/*           move (if loss is proven, see resisting_move()) will be written   */
+/* Returns:                                                                   */
+/*   PNS_WIN, PNS_LOSS or PNS_UNKNOWN.                                        */
+int pns_search(conn4_state* board, unsigned int nodes, const move_ctl* ctl,
+        int* move) {
+    pns_tree tree;
+    unsigned int i;
+    int result = PNS_UNKNOWN;
+
+    tree.capacity = nodes / 2;
+    tree.nodes = malloc(tree.capacity * sizeof(*tree.nodes));
+    tree.board = board;
+    if (tree.nodes == NULL || tree.capacity <= get_cols()) {
+        free(tree.nodes);
+        return PNS_UNKNOWN;
+    }
+
+    tree.attacker = CURR_PLAYER(board);
+    if (prove(&tree, ctl)) {
+        for (i = 0; i < tree.nodes[0].children; ++i) {
+            if (tree.nodes[tree.nodes[0].child + i].proof == 0) {
+                *move = tree.nodes[tree.nodes[0].child + i].move;
+                break;
+            }
+        }
+        result = PNS_WIN;
+    } else if (!move_stopped_before(ctl, DEADLINE_MARGIN)) {
+        tree.attacker = PREV_PLAYER(board);
+        if (prove(&tree, ctl) && (*move = resisting_move(&tree)) >= 0) {
+            result = PNS_LOSS;
+        }
+    }
+
+    free(tree.nodes);
+    return result;
+}
+
+
+#endif /* _PNS_C_ */
@@ -0,0 +1,21 @@
+#ifndef _PNS_H_
+#define _PNS_H_
+
+#include "player.h"
+
+
+/* Number of nodes of proof-number search run before the main search          */
+#define PNS_NODES       (1U << 17)
+
+/* Results of proof-number search for player to move                          */
+#define PNS_UNKNOWN     0   /* Nothing is proven within limit of nodes */
+#define PNS_WIN         1   /* Player to move has a forced win */
+#define PNS_LOSS        2   /* Opponent has a forced win against every move */
+
+
+/* Searches for forced win or loss of player to move within limit of nodes.   */
+int pns_search(conn4_state* board, unsigned int nodes, const move_ctl* ctl,
+        int* move);
+
+
+#endif /* _PNS_H_ */
@@ -0,0 +1,285 @@
+#ifndef _RANKING_C_
+#define _RANKING_C_
+
+#include "ranking.h"
+#include <stdlib.h>     /* malloc(), free() */
+#include <string.h>     /* strcmp() */
+
+
+/* Maximal number of levels of skip list (enough for 4^16 players)            */
+#define MAX_LEVEL       16
+
+
+/* Link of skip list node at one level. Span is number of nodes passed by    */
+/* following the link, which gives positions of nodes in logarithmic time.  */
+typedef struct ranking_node_struct ranking_node;
+typedef struct {
+    ranking_node* next;
+    unsigned int span;
+} ranking_link;
+
+/* Node of skip list                                                          */
+struct ranking_node_struct {
+    const char* name;
+    unsigned int score;
+    unsigned int id;        /* Identifier of player given by caller */
+    ranking_link link[];    /* One link per level of node */
+};
+
+/* Index is skip list with spans (indexable skip list) headed by a node      */
+/* with all levels.                                                           */
+struct ranking_struct {
+    ranking_node* head;
+    unsigned int level;     /* Number of levels in use */
+    unsigned int size;      /* Number of players */
+    unsigned long long seed;/* State of random number generator */
+};
+
+
+/* Function: precedes                                                         */
+/*   Compares order of node and player.                                       */
+/* Parameter(s):                                                              */
+/*   node  - node of skip list                                                */
+/*   name  - name of player, or NULL to compare only scores                   */
+/*   score - score of player                                                  */
+/* Returns:                                                                   */
+/*   1 if node goes before player, 0 otherwise.                               */
+static int precedes(const ranking_node* node, const char* name,
+        unsigned int score) {
+    if (node->score != score) {
+        return (node->score > score);
+    }
+    return (name != NULL && strcmp(node->name, name) < 0);
+}
+
+
+/* Function: random_level                                                     */
+/*   Chooses number of levels of new node: each next level with probability   */
+/*   1/4.                                                                     */
+/* Parameter(s):                                                              */
+/*   index - index structure                                                  */
+/* Returns:                                                                   */
+/*   Number of levels.                                                        */
+static unsigned int random_level(ranking* index) {
+    unsigned int level = 1;
+    unsigned long long bits;
+
+    index->seed ^= index->seed >> 12;
+    index->seed ^= index->seed << 25;
+    index->seed ^= index->seed >> 27;
+    bits = index->seed * 2685821657736338717ULL;
+    while (level < MAX_LEVEL && (bits & 3) == 0) {
+        ++level;
+        bits >>= 2;
+    }
+    return level;
+}
+
+
+/* Function: create_ranking                                                   */
+/*   Creates empty index.                                                     */
+/* Returns:                                                                   */
+/*   New index, or NULL if memory can't be allocated.                         */
+ranking* create_ranking(void) {
+    unsigned int i;
+    ranking* index = malloc(sizeof(*index));
+
+    if (index == NULL) {
+        return NULL;
+    }
+    index->head = malloc(sizeof(*index->head) +
+            MAX_LEVEL * sizeof(ranking_link));
+    if (index->head == NULL) {
+        free(index);
+        return NULL;
+    }
+    for (i = 0; i < MAX_LEVEL; ++i) {
+        index->head->link[i].next = NULL;
+        index->head->link[i].span = 0;
+    }
+    index->level = 1;
+    index->size = 0;
+    index->seed = 0x9E3779B97F4A7C15ULL;
+    return index;
+}
+
+
+/* Function: destruct_ranking                                                 */
+/*   Releases index. Names of players are owned by caller and aren't freed.  */
+/* Parameter(s):                                                              */
+/*   index - index structure                                                  */
+void destruct_ranking(ranking* index) {
+    ranking_node* node;
+    ranking_node* next;
+
+    if (index != NULL) {
+        for (node = index->head; node != NULL; node = next) {
+            next = node->link[0].next;
+            free(node);
+        }
+        free(index);
+    }
+    return;
+}
+
+
+/* Function: ranking_insert                                                   */
+/*   Adds player to index in logarithmic time.                                */
+/* Parameter(s):                                                              */
+/*   index - index structure                                                  */
+/*   name  - name of player; string is kept by index, so it has to live      */
+/*           until player is removed                                          */
+/*   score - score of player                                                  */
+/*   id    - identifier of player (returned by ranking_top())                 */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory can't be allocated.                         */
+int ranking_insert(ranking* index, const char* name, unsigned int score,
+        unsigned int id) {
+    ranking_node* update[MAX_LEVEL];    /* Last node before player per level */
+    unsigned int position[MAX_LEVEL];   /* Position of that node */
+    ranking_node* node = index->head;
+    unsigned int i, level = random_level(index);
+    int l;
+
+    /* Find place of player on every level */
+    for (l = index->level - 1; l >= 0; --l) {
+        position[l] = (l == index->level - 1 ? 0 : position[l + 1]);
+        while (node->link[l].next != NULL &&
+                precedes(node->link[l].next, name, score)) {
+            position[l] += node->link[l].span;
+            node = node->link[l].next;
+        }
+        update[l] = node;
+    }
+    if (level > index->level) {
+        for (i = index->level; i < level; ++i) {
+            position[i] = 0;
+            update[i] = index->head;
+            update[i]->link[i].span = index->size;
+        }
+        index->level = level;
+    }
+
+    node = malloc(sizeof(*node) + level * sizeof(ranking_link));
+    if (node == NULL) {
+        return 0;
+    }
+    node->name = name;
+    node->score = score;
+    node->id = id;
+    for (i = 0; i < level; ++i) {
+        node->link[i].next = update[i]->link[i].next;
+        update[i]->link[i].next = node;
+        /* Split span of previous node around new node */
+        node->link[i].span = update[i]->link[i].span -
+                (position[0] - position[i]);
+        update[i]->link[i].span = position[0] - position[i] + 1;
+    }
+    /* Higher links pass over new node */
+    for (i = level; i < index->level; ++i) {
+        ++update[i]->link[i].span;
+    }
+    ++index->size;
+    return 1;
+}
+
+
+/* Function: ranking_remove                                                   */
+/*   Removes player from index in logarithmic time.                           */
+/* Parameter(s):                                                              */
+/*   index - index structure                                                  */
+/*   name  - name of player                                                   */
+/*   score - score of player (as it was inserted)                             */
+/* Returns:                                                                   */
+/*   1 if player is removed, 0 if player isn't found.                         */
+int ranking_remove(ranking* index, const char* name, unsigned int score) {
+    ranking_node* update[MAX_LEVEL];
+    ranking_node* node = index->head;
+    int l;
+
+    for (l = index->level - 1; l >= 0; --l) {
+        while (node->link[l].next != NULL &&
+                precedes(node->link[l].next, name, score)) {
+            node = node->link[l].next;
+        }
+        update[l] = node;
+    }
+    node = node->link[0].next;
+    if (node == NULL || node->score != score ||
+            strcmp(node->name, name) != 0) {
+        return 0;
+    }
+
+    for (l = 0; l < index->level; ++l) {
+        if (update[l]->link[l].next == node) {
+            update[l]->link[l].span += node->link[l].span - 1;
+            update[l]->link[l].next = node->link[l].next;
+        } else {
+            --update[l]->link[l].span;
+        }
+    }
+    while (index->level > 1 &&
+            index->head->link[index->level - 1].next == NULL) {
+        --index->level;
+    }
+    free(node);
+    --index->size;
+    return 1;
+}
+
+
+/* Function: ranking_rank                                                     */
+/*   Finds rank of score in logarithmic time. Players with equal score share */
+/*   the same rank.                                                           */
+/* Parameter(s):                                                              */
+/*   index - index structure                                                  */
+/*   score - score of player                                                  */
+/* Returns:                                                                   */
+/*   1 + number of players with higher score.                                 */
+unsigned int ranking_rank(const ranking* index, unsigned int score) {
+    const ranking_node* node = index->head;
+    unsigned int position = 0;
+    int l;
+
+    for (l = index->level - 1; l >= 0; --l) {
+        while (node->link[l].next != NULL &&
+                precedes(node->link[l].next, NULL, score)) {
+            position += node->link[l].span;
+            node = node->link[l].next;
+        }
+    }
+    return position + 1;
+}
+
+
+/* Function: ranking_top                                                      */
+/*   Lists players with the highest scores, best first.                       */
+/* Parameter(s):                                                              */
+/*   index - index structure                                                  */
+/*   k     - maximal number of players to list                                */
+/*   ids   - where identifiers of players will be written                     */
+/* Returns:                                                                   */
+/*   Number of listed players.                                                */
+unsigned int ranking_top(const ranking* index, unsigned int k,
+        unsigned int* ids) {
+    const ranking_node* node = index->head->link[0].next;
+    unsigned int i;
+
+    for (i = 0; i < k && node != NULL; ++i, node = node->link[0].next) {
+        ids[i] = node->id;
+    }
+    return i;
+}
+
+
+/* Function: ranking_size                                                     */
+/* Parameter(s):                                                              */
+/*   index - index structure                                                  */
+/* Returns:                                                                   */
+/*   Number of players in index.                                              */
+unsigned int ranking_size(const ranking* index) {
+    return index->size;
+}
+
+
+#endif /* _RANKING_C_ */
@@ -0,0 +1,33 @@
+#ifndef _RANKING_H_
+#define _RANKING_H_
+
+
+/* Order-statistics index of players by score: players with higher score go */
+/* first, players with equal score are ordered by name.                      */
+typedef struct ranking_struct ranking;
+
+/* Creates empty index.                                                       */
+ranking* create_ranking(void);
+
+/* Releases index (names are not freed).                                      */
+void destruct_ranking(ranking* index);
+
+/* Adds player with selected score and identifier (name is not copied).       */
+int ranking_insert(ranking* index, const char* name, unsigned int score,
+        unsigned int id);
+
+/* Removes player with selected score.                                        */
+int ranking_remove(ranking* index, const char* name, unsigned int score);
+
+/* Rank of score: 1 + number of players with higher score.                    */
+unsigned int ranking_rank(const ranking* index, unsigned int score);
+
+/* Lists identifiers of up to k players with the highest scores.             */
+unsigned int ranking_top(const ranking* index, unsigned int k,
+        unsigned int* ids);
+
+/* Number of players in index.                                                */
+unsigned int ranking_size(const ranking* index);
+
+
+#endif /* _RANKING_H_ */
@@ -0,0 +1,270 @@
+#ifndef _RATEBENCH_C_
+#define _RATEBENCH_C_
+
+#include "conn4.h"
+#include "rating.h"
+#include "async.h"
+#include <stdio.h>      /* printf(), fprintf(), snprintf(), fopen(), fscanf() */
+#include <stdlib.h>     /* atoi(), calloc(), free(), mkdtemp(), EXIT_* */
+#include <unistd.h>     /* chdir(), rmdir() */
+#include <pthread.h>    /* pthread_create(), pthread_join() */
+
+
+/* Maximal number of threads saving results                                   */
+#define MAX_THREADS     64
+/* Maximal number of players                                                  */
+#define MAX_PLAYERS     1000
+/* Default number of players                                                  */
+#define PLAYERS         16
+/* Size of name of player ("player" and number of player)                     */
+#define NAME_BYTES      (sizeof("player") + 10)
+/* Template of directory where score table is kept during run               */
+#define TEMP_DIR        "/tmp/ratebench.XXXXXX"
+
+/* Macros: Score of player in leaderboard (see POINTS in rating.c)            */
+#define POINTS(count)   (2 * (count)[0] + (count)[2])
+
+
+/* Results saved by one thread. Counts are wins, losses and draws.           */
+typedef struct {
+    pthread_t thread;
+    unsigned long long seed;            /* State of random number generator */
+    unsigned int games;                 /* Number of results to save */
+    unsigned int (*counts)[3];          /* Counts of results per player */
+} saver_t;
+
+
+/* Number of players                                                          */
+static unsigned int players = PLAYERS;
+/* Flag: all savers are finished                                              */
+static int finished = 0;
+
+
+/* Function: player_name                                                      */
+/*   Makes name of player with selected number.                               */
+/* Parameter(s):                                                              */
+/*   i    - number of player                                                  */
+/*   name - where name will be written (NAME_BYTES bytes)                     */
+static void player_name(unsigned int i, char* name) {
+    snprintf(name, NAME_BYTES, "player%u", i);
+    return;
+}
+
+
+/* Function: next_random                                                      */
+/*   Advances random number generator (LCG).                                  */
+/* Parameter(s):                                                              */
+/*   seed - state of generator                                                */
+/* Returns:                                                                   */
+/*   Random number (31 bits).                                                 */
+static unsigned int next_random(unsigned long long* seed) {
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned int)(*seed >> 33);
+}
+
+
+/* Function: run_saver                                                        */
+/*   Thread function that saves random results of games between random       */
+/*   players and counts them on its own.                                      */
+/* Parameter(s):                                                              */
+/*   arg - saver structure                                                    */
+static void* run_saver(void* arg) {
+    saver_t* saver = arg;
+    char x_name[NAME_BYTES], o_name[NAME_BYTES];
+    unsigned int i, x, o, result;
+    static const char winners[3] = { CELL_X, CELL_O, CELL_EMPTY };
+
+    for (i = 0; i < saver->games; ++i) {
+        x = next_random(&saver->seed) % players;
+        o = (x + 1 + next_random(&saver->seed) % (players - 1)) % players;
+        result = next_random(&saver->seed) % 3;
+        player_name(x, x_name);
+        player_name(o, o_name);
+        save_result(x_name, o_name, winners[result]);
+        if (result == 2) {
+            ++saver->counts[x][2];
+            ++saver->counts[o][2];
+        } else {
+            ++saver->counts[result == 0 ? x : o][0];
+            ++saver->counts[result == 0 ? o : x][1];
+        }
+    }
+    return NULL;
+}
+
+
+/* Function: run_reader                                                       */
+/*   Thread function that queries leaderboard while results are saved.       */
+/* Parameter(s):                                                              */
+/*   arg - where number of queries will be counted                            */
+static void* run_reader(void* arg) {
+    unsigned long long seed = 7;
+    char name[NAME_BYTES];
+
+    while (!__atomic_load_n(&finished, __ATOMIC_ACQUIRE)) {
+        player_name(next_random(&seed) % players, name);
+        player_rank(name);
+        ++*(unsigned int*)arg;
+    }
+    return NULL;
+}
+
+
+/* Function: check_ratings                                                    */
+/*   Checks that rank of every player agrees with expected scores and that   */
+/*   score table saved to file has expected counts.                           */
+/* Parameter(s):                                                              */
+/*   counts - expected counts of results per player                           */
+/* Returns:                                                                   */
+/*   1 if everything agrees, 0 otherwise (errors are printed).                */
+static int check_ratings(unsigned int (*counts)[3]) {
+    char name[NAME_BYTES], read[33];
+    unsigned int i, j, rank, better, found = 0;
+    unsigned int wins, losses, draws;
+    int ok = 1;
+    FILE* file;
+
+    /* Rank is one more than number of players with higher score */
+    for (i = 0; i < players; ++i) {
+        for (better = 0, j = 0; j < players; ++j) {
+            better += (POINTS(counts[j]) > POINTS(counts[i]));
+        }
+        player_name(i, name);
+        if ((rank = player_rank(name)) != better + 1) {
+            fprintf(stderr, "Error: %s has rank %u instead of %u.\n", name,
+                    rank, better + 1);
+            ok = 0;
+        }
+    }
+
+    /* Writes all results to file and releases table */
+    save_ratings();
+    file = fopen(FILENAME, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error: score table isn't saved.\n");
+        return 0;
+    }
+    while (fscanf(file, "%32s %u %u %u", read, &wins, &losses, &draws) == 4) {
+        if (sscanf(read, "player%u", &i) != 1 || i >= players) {
+            continue;   /* Computer players */
+        }
+        ++found;
+        if (wins != counts[i][0] || losses != counts[i][1] ||
+                draws != counts[i][2]) {
+            fprintf(stderr, "Error: %s has %u/%u/%u instead of %u/%u/%u.\n",
+                    read, wins, losses, draws,
+                    counts[i][0], counts[i][1], counts[i][2]);
+            ok = 0;
+        }
+    }
+    fclose(file);
+    if (found != players) {
+        fprintf(stderr, "Error: %u of %u players are saved.\n", found,
+                players);
+        ok = 0;
+    }
+    return ok;
+}
+
+
+/* Function: main                                                             */
+/*   Saves results of random games from many threads at once while another   */
+/*   thread queries leaderboard, then checks totals of every player and      */
+/*   order of leaderboard against counts kept by threads. Score table is     */
+/*   kept in temporary directory, so ratings of real players aren't touched. */
+/*   Usage: ratebench threads games [players]                                 */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    char dir[] = TEMP_DIR;
+    char name[NAME_BYTES];
+    unsigned int i, j, threads, games, queries = 0;
+    unsigned int (*counts)[3];
+    saver_t savers[MAX_THREADS];
+    pthread_t reader;
+    double start, elapsed;
+    FILE* file;
+    int ok;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s threads games [players]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    threads = atoi(argv[1]);
+    games = atoi(argv[2]);
+    if (argc > 3) {
+        players = atoi(argv[3]);
+    }
+    if (threads < 1 || threads > MAX_THREADS) {
+        fprintf(stderr, "Error: invalid number of threads (1-%d).\n",
+                MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+    if (atoi(argv[2]) < 1) {
+        fprintf(stderr, "Error: invalid number of games.\n");
+        return EXIT_FAILURE;
+    }
+    if (players < 2 || players > MAX_PLAYERS) {
+        fprintf(stderr, "Error: invalid number of players (2-%d).\n",
+                MAX_PLAYERS);
+        return EXIT_FAILURE;
+    }
+    if (mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        fprintf(stderr, "Error: can't create temporary directory.\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Score table of new players */
+    file = fopen(FILENAME, "w");
+    for (i = 0; file != NULL && i < players; ++i) {
+        player_name(i, name);
+        fprintf(file, "%s\t0\t0\t0\n", name);
+    }
+    if (file == NULL || fclose(file) != 0) {
+        fprintf(stderr, "Error: can't write score table.\n");
+        return EXIT_FAILURE;
+    }
+    load_ratings();
+
+    counts = calloc((size_t)threads * players, sizeof(*counts));
+    start = monotonic_time();
+    pthread_create(&reader, NULL, run_reader, &queries);
+    for (i = 0; i < threads; ++i) {
+        savers[i].seed = i + 1;
+        savers[i].games = games;
+        savers[i].counts = counts + (size_t)i * players;
+        pthread_create(&savers[i].thread, NULL, run_saver, &savers[i]);
+    }
+    for (i = 0; i < threads; ++i) {
+        pthread_join(savers[i].thread, NULL);
+    }
+    elapsed = monotonic_time() - start;
+    __atomic_store_n(&finished, 1, __ATOMIC_RELEASE);
+    pthread_join(reader, NULL);
+
+    /* Counts of all threads are summed in counts of the first one */
+    for (i = 1; i < threads; ++i) {
+        for (j = 0; j < players; ++j) {
+            counts[j][0] += counts[i * players + j][0];
+            counts[j][1] += counts[i * players + j][1];
+            counts[j][2] += counts[i * players + j][2];
+        }
+    }
+    printf("\n");
+    print_leaderboard(5);
+    ok = check_ratings(counts);
+    printf("Results: %u saved by %u threads in %.3f s (%.1f ns each), "
+            "%u rank queries meanwhile\n", threads * games, threads, elapsed,
+            elapsed / ((double)threads * games) * 1e9, queries);
+    printf("Totals and order of leaderboard: %s\n", ok ? "OK" : "MISMATCH");
+
+    free(counts);
+    remove(FILENAME);
+    chdir("/");
+    rmdir(dir);
+    return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+#endif /* _RATEBENCH_C_ */
@@ -3,96 +3,308 @@
 
 #include "conn4.h"
 #include "rating.h"
-#include <stdio.h>  /* printf(), fprintf(), scnaf(), fscanf(), FILE */
-#include <string.h> /* strcmp() */
-#include <stdlib.h> /* malloc() */
+#include "ranking.h"
+#include "trace.h"
+#include <stdio.h>  /* printf(), fprintf(), scnaf(), fscanf(), rename(), FILE */
+#include <string.h> /* strcmp(), strcpy() */
+#include <stdlib.h> /* malloc(), calloc(), free() */
+#include <pthread.h>/* pthread_mutex_*() */
 
 
 #define MAX_NAME_LENGTH 32
 
+/* Users are stored in chunks that never move, so entries may be used by    */
+/* other threads while table grows.                                          */
+#define CHUNK_USERS     1024
+#define MAX_CHUNKS      4096
 
-/* Use rentry structure */
+/* Index of names is split into shards with separate locks                    */
+#define SHARDS          64
+#define SHARD_SLOTS     16      /* Initial capacity of shard */
+
+/* Number of saved results that triggers flush of ratings to file             */
+#define FLUSH_BATCH     64
+
+/* Marks empty slot of shard and end of list of outdated users                */
+#define NO_USER         (~0U)
+
+/* Macros: Score of user in leaderboard (two points per win, one per draw)    */
+#define POINTS(user)    (2 * (user).wins + (user).draws)
+
+/* Macros: Entry of user with selected index                                  */
+#define USER(i)         (rated[(i) / CHUNK_USERS][(i) % CHUNK_USERS])
+
+
+/* Use rentry structure. Counters are updated by atomic operations.          */
 typedef struct {
     char* name;
     unsigned int wins;
     unsigned int losses;
     unsigned int draws;
+    unsigned int ranked;    /* Score of user in leaderboard */
+    unsigned int stale;     /* Flag: score has changed since it was ranked */
+    unsigned int next;      /* Next user with outdated score */
 } user_t;
 
+/* Shard of index of names: open addressing table of user indices            */
+typedef struct {
+    pthread_mutex_t lock;
+    unsigned int* slots;    /* User indices, NO_USER if slot is empty */
+    unsigned int size;      /* Number of users in shard */
+    unsigned int capacity;  /* Number of slots (power of 2) */
+} shard_t;
+
 
-/* List of rated users. */
-user_t* rated = NULL;
+/* List of rated users (in chunks). */
+user_t* rated[MAX_CHUNKS];
 /* Number of rates users. */
 unsigned int countRated = 0;
-/* Maximal number of rated users. */
-unsigned int maxRated = 0;
+/* Index of users by name. */
+shard_t shards[SHARDS];
+/* Serializes creation of new users. */
+pthread_mutex_t grow_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Leaderboard: rated users ordered by score. Scores of users are changed   */
+/* without lock, and users are put to lock-free list of outdated entries,   */
+/* which are moved in leaderboard when it is queried.                        */
+ranking* ranks = NULL;
+pthread_mutex_t rank_lock = PTHREAD_MUTEX_INITIALIZER;
+unsigned int stale_head = NO_USER;
+
+/* Number of results saved since the last flush to file. */
+unsigned int pending = 0;
+/* Serializes flushes to file. */
+pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* Function: hash_name                                                        */
+/*   Computes hash of name (FNV-1a).                                          */
+/* Parameter(s):                                                              */
+/*   name - name of user                                                      */
+/* Returns:                                                                   */
+/*   Hash value. Lower bits select shard, higher bits select slot.            */
+unsigned int hash_name(const char* name) {
+    unsigned int hash = 2166136261U;
+
+    while (*name != '\0') {
+        hash = (hash ^ (unsigned char)*name++) * 16777619U;
+    }
+    return hash;
+}
+
+
+/* Function: shard_find                                                       */
+/*   Searches for a user in shard. Lock of shard has to be held.              */
+/* Parameter(s):                                                              */
+/*   shard - shard of index                                                   */
+/*   name  - name of searched user                                            */
+/*   hash  - hash of name                                                     */
+/* Returns:                                                                   */
+/*   Slot of user if found, or empty slot where user would be placed.         */
+unsigned int* shard_find(shard_t* shard, const char* name, unsigned int hash) {
+    unsigned int i = (hash / SHARDS) & (shard->capacity - 1);
+
+    while (shard->slots[i] != NO_USER &&
+            strcmp(name, USER(shard->slots[i]).name) != 0) {
+        i = (i + 1) & (shard->capacity - 1);
+    }
+    return &shard->slots[i];
+}
+
+
+/* Function: shard_grow                                                       */
+/*   Doubles capacity of shard. Lock of shard has to be held.                 */
+/* Parameter(s):                                                              */
+/*   shard - shard of index                                                   */
+void shard_grow(shard_t* shard) {
+    unsigned int i, j, user;
+    unsigned int* old = shard->slots;
+    unsigned int capacity = shard->capacity;
+
+    shard->capacity *= 2;
+    shard->slots = malloc(shard->capacity * sizeof(*shard->slots));
+    for (i = 0; i < shard->capacity; ++i) {
+        shard->slots[i] = NO_USER;
+    }
+    for (i = 0; i < capacity; ++i) {
+        if ((user = old[i]) != NO_USER) {
+            j = (hash_name(USER(user).name) / SHARDS) &
+                    (shard->capacity - 1);
+            while (shard->slots[j] != NO_USER) {
+                j = (j + 1) & (shard->capacity - 1);
+            }
+            shard->slots[j] = user;
+        }
+    }
+    free(old);
+    return;
+}
+
+
+/* Function: init_shards                                                      */
+/*   Prepares empty index of names and leaderboard.                           */
+void init_shards(void) {
+    unsigned int i, j;
+
+    for (i = 0; i < SHARDS; ++i) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+        shards[i].capacity = SHARD_SLOTS;
+        shards[i].size = 0;
+        shards[i].slots = malloc(SHARD_SLOTS * sizeof(*shards[i].slots));
+        for (j = 0; j < SHARD_SLOTS; ++j) {
+            shards[i].slots[j] = NO_USER;
+        }
+    }
+    ranks = create_ranking();
+    return;
+}
 
 
 /* Function: find_user                                                        */
-/*   Searches for a user given his/hr name.                                   */
+/*   Searches for a user given his/hr name. Only shard of the name is locked. */
 /* Parameter(s):                                                              */
 /*   name - name of searched user (case sensitive)                            */
 /* Returns:                                                                   */
 /*   Index of user in score table if found, or -1 if not found.               */
 int find_user(const char* name) {
-    int i;
+    unsigned int hash = hash_name(name);
+    shard_t* shard = &shards[hash % SHARDS];
+    unsigned int user;
 
-    for (i = 0; i < countRated; ++i) {
-        if (strcmp(name, rated[i].name) == 0) {
-            return i;
-        }
-    }
+    pthread_mutex_lock(&shard->lock);
+    user = *shard_find(shard, name, hash);
+    pthread_mutex_unlock(&shard->lock);
 
-    return -1;
+    return (user == NO_USER ? -1 : (int)user);
 }
 
 
 /* Function: add_user                                                         */
-/*   Adds user entry to score table.                                          */
+/*   Adds user entry to score table unless user with the same name exists.   */
 /* Parameter(s):                                                              */
-/*   user - new user entry                                                    */
-void add_user(user_t* user) {
-    user_t* old;
-    if (countRated == maxRated) {
-        if (maxRated == 0) {
-            maxRated = 1;
-            rated = malloc(sizeof(*rated));
-        } else {
-            old = rated;
-            rated = malloc(2 * maxRated * sizeof(*rated));
-            for (countRated = 0; countRated < maxRated; ++countRated) {
-                rated[countRated] = old[countRated];
-            }
-            free(old);
-            maxRated *= 2;
+/*   name   - name of user                                                    */
+/*   wins   - number of wins                                                  */
+/*   losses - number of losses                                                */
+/*   draws  - number of draws                                                 */
+/* Returns:                                                                   */
+/*   Index of user in score table, or -1 if table is full or memory can't be  */
+/*   allocated.                                                               */
+int add_user(const char* name, unsigned int wins, unsigned int losses,
+        unsigned int draws) {
+    unsigned int hash = hash_name(name);
+    shard_t* shard = &shards[hash % SHARDS];
+    unsigned int* slot;
+    unsigned int i;
+    int ok;
+    user_t* user;
+
+    pthread_mutex_lock(&shard->lock);
+    slot = shard_find(shard, name, hash);
+    if (*slot != NO_USER) {
+        i = *slot;
+        pthread_mutex_unlock(&shard->lock);
+        return i;
+    }
+
+    pthread_mutex_lock(&grow_lock);
+    i = countRated;
+    if (i / CHUNK_USERS == MAX_CHUNKS) {
+        pthread_mutex_unlock(&grow_lock);
+        pthread_mutex_unlock(&shard->lock);
+        return -1;
+    }
+    /* Chunk may be left from earlier failed call */
+    if (rated[i / CHUNK_USERS] == NULL) {
+        rated[i / CHUNK_USERS] = calloc(CHUNK_USERS, sizeof(user_t));
+    }
+    user = (rated[i / CHUNK_USERS] != NULL ? &USER(i) : NULL);
+    ok = (user != NULL && (user->name = malloc(MAX_NAME_LENGTH+1)) != NULL);
+    if (ok) {
+        strcpy(user->name, name);
+        user->wins = wins;
+        user->losses = losses;
+        user->draws = draws;
+        user->ranked = POINTS(*user);
+        user->stale = 0;
+        pthread_mutex_lock(&rank_lock);
+        ok = ranking_insert(ranks, user->name, user->ranked, i);
+        pthread_mutex_unlock(&rank_lock);
+        if (!ok) {
+            free(user->name);
         }
     }
-    rated[countRated++] = *user;
-    return;
+    if (!ok) {
+        pthread_mutex_unlock(&grow_lock);
+        pthread_mutex_unlock(&shard->lock);
+        return -1;
+    }
+    /* Publish complete entry */
+    __atomic_store_n(&countRated, i + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&grow_lock);
+
+    *slot = i;
+    if (++shard->size * 4 > shard->capacity * 3) {
+        shard_grow(shard);
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return i;
 }
 
 
-/* Function: create_user                                                      */
-/*   Creates a new user entry for a given name.                               */
-/* Returns:                                                                   */
-/*   New user entry.                                                          */
-user_t* create_user(const char* name) {
-    user_t* user = malloc(sizeof(*user));
+/* Function: mark_stale                                                       */
+/*   Puts user to list of users whose place in leaderboard is outdated (if   */
+/*   user isn't there already). Function is lock-free.                       */
+/* Parameter(s):                                                              */
+/*   i - index of user                                                        */
+void mark_stale(unsigned int i) {
+    user_t* user = &USER(i);
+    unsigned int head;
 
-    user->name = malloc(MAX_NAME_LENGTH+1);
-    strcpy(user->name, name);
+    if (__atomic_exchange_n(&user->stale, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    head = __atomic_load_n(&stale_head, __ATOMIC_RELAXED);
+    do {
+        user->next = head;
+    } while (!__atomic_compare_exchange_n(&stale_head, &head, i, 1,
+            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return;
+}
 
-    user->wins = 0;
-    user->losses = 0;
-    user->draws = 0;
 
-    return user;
+/* Function: refresh_ranks                                                    */
+/*   Moves users with outdated scores in leaderboard. Lock of leaderboard    */
+/*   has to be held.                                                          */
+void refresh_ranks(void) {
+    unsigned int i = __atomic_exchange_n(&stale_head, NO_USER,
+            __ATOMIC_ACQUIRE);
+    unsigned int next, score;
+    user_t* user;
+
+    for (; i != NO_USER; i = next) {
+        user = &USER(i);
+        next = user->next;
+        /* Clear flag before reading score, so later update puts user to     */
+        /* list again                                                         */
+        __atomic_exchange_n(&user->stale, 0, __ATOMIC_ACQ_REL);
+        score = 2 * __atomic_load_n(&user->wins, __ATOMIC_RELAXED) +
+                __atomic_load_n(&user->draws, __ATOMIC_RELAXED);
+        if (score != user->ranked) {
+            ranking_remove(ranks, user->name, user->ranked);
+            user->ranked = score;
+            ranking_insert(ranks, user->name, score, i);
+        }
+    }
+    return;
 }
 
 
 /* Function: choose_name                                                      */
 /*   Asks user for a name and creates a new entry in score table if name is   */
-/*   new. After successful choosing, printf current rating of user.           */
+/*   new. If entry can't be created, user is asked again (existing name can  */
+/*   still be chosen). After successful choosing, printf current rating of   */
+/*   user.                                                                    */
 /* Returns:                                                                   */
 /*   Name selected by user. This string mustn't be freed by the caller.       */
 /*   It will be automatically freed after calling save_raings() function.     */
@@ -100,33 +312,72 @@ char* choose_name(void) {
     char name[MAX_NAME_LENGTH+1];
     int ok = 0;     /* Status of name creation */
     int i;
-    user_t* user;
 
     /* Ask for a name until valid name is entered */
     do {
         printf("Pick a name: ");
         scanf("%32s", name);
-        if ((ok = strcmp(name, COMPUTER_NAME)) == 0) {
+        if ((ok = strcmp(name, COMPUTER_NAME) && strcmp(name, MCTS_NAME))
+                == 0) {
             printf("This name is reserved for computer AI.\n");
+            continue;
+        }
+        /* If user is new - create new entry in score table */
+        if ((i = add_user(name, 0, 0, 0)) < 0) {
+            printf("Error: score table is full, pick existing name.\n");
+            ok = 0;
         }
     } while (!ok);
 
-    /* If user is new - create new entry in score table */
-    if ((i = find_user(name)) < 0) {
-        i = countRated;
-        add_user(create_user(name));
-    }
-
     /* Print current rating */
-    printf("\nYour current rating:\n   %d wins, %d losses, %d draws.\n\n",
-            rated[i].wins, rated[i].losses, rated[i].draws);
+    printf("\nYour current rating:\n   %u wins, %u losses, %u draws.\n",
+            __atomic_load_n(&USER(i).wins, __ATOMIC_RELAXED),
+            __atomic_load_n(&USER(i).losses, __ATOMIC_RELAXED),
+            __atomic_load_n(&USER(i).draws, __ATOMIC_RELAXED));
+    printf("   Rank %u of %u.\n\n", player_rank(name),
+            __atomic_load_n(&countRated, __ATOMIC_ACQUIRE));
+
+    return USER(i).name;
+}
+
+
+/* Function: flush_ratings                                                    */
+/*   Writes ratings of all users to file. File is replaced at once, so it is  */
+/*   never seen half-written. If another thread is flushing at the moment,   */
+/*   function returns at once.                                                */
+void flush_ratings(void) {
+    unsigned int i, count;
+    FILE* file;
 
-    return rated[i].name;
+    if (pthread_mutex_trylock(&flush_lock) != 0) {
+        return;
+    }
+    __atomic_store_n(&pending, 0, __ATOMIC_RELAXED);
+    count = __atomic_load_n(&countRated, __ATOMIC_ACQUIRE);
+    file = fopen(FILENAME ".tmp", "w");
+    if (file == NULL) {
+        printf("\nError: cannot save ratings.\n\n");
+    } else {
+        for (i = 0; i < count; ++i) {
+            fprintf(file, "%s\t%u\t%u\t%u\n", USER(i).name,
+                    __atomic_load_n(&USER(i).wins, __ATOMIC_RELAXED),
+                    __atomic_load_n(&USER(i).losses, __ATOMIC_RELAXED),
+                    __atomic_load_n(&USER(i).draws, __ATOMIC_RELAXED));
+        }
+        if (fclose(file) != 0 || rename(FILENAME ".tmp", FILENAME) != 0) {
+            printf("\nError: cannot save ratings.\n\n");
+        }
+    }
+    pthread_mutex_unlock(&flush_lock);
+
+    return;
 }
 
 
 /* Function: save_result                                                      */
-/*   Saves result of a game.                                                  */
+/*   Saves result of a game. Function may be called by many threads at once: */
+/*   counters are updated atomically, leaderboard is updated when queried,   */
+/*   and every FLUSH_BATCH results are written to file.                       */
 /* Parameter(s):                                                              */
 /*   playerX - name of player who played with disks of X type                 */
 /*   playerO - name of player who playe with disks of O type                  */
@@ -136,17 +387,81 @@ void save_result(const char* playerX, const char* playerO, char winner) {
     int iX = find_user(playerX);
     int iO = find_user(playerO);
 
+    /* Player without entry (score table was full) isn't rated */
+    if (iX < 0 || iO < 0) {
+        return;
+    }
+
     /* Udate ratings of two players */
     if (winner == CELL_X) {
-        rated[iX].wins++;
-        rated[iO].losses++;
+        __atomic_add_fetch(&USER(iX).wins, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&USER(iO).losses, 1, __ATOMIC_RELAXED);
     } else if (winner == CELL_O) {
-        rated[iO].wins++;
-        rated[iX].losses++;
+        __atomic_add_fetch(&USER(iO).wins, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&USER(iX).losses, 1, __ATOMIC_RELAXED);
     } else {
-        rated[iX].draws++;
-        rated[iO].draws++;
+        __atomic_add_fetch(&USER(iX).draws, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&USER(iO).draws, 1, __ATOMIC_RELAXED);
+    }
+    mark_stale(iX);
+    mark_stale(iO);
+
+    if (__atomic_add_fetch(&pending, 1, __ATOMIC_RELAXED) >= FLUSH_BATCH) {
+        flush_ratings();
+    }
+
+    return;
+}
+
+
+/* Function: player_rank                                                      */
+/*   Finds rank of user in leaderboard in logarithmic time. Users with equal  */
+/*   score share the same rank.                                               */
+/* Parameter(s):                                                              */
+/*   name - name of user                                                      */
+/* Returns:                                                                   */
+/*   Rank of user (1 is the best), or 0 if user isn't rated.                  */
+unsigned int player_rank(const char* name) {
+    int i = find_user(name);
+    unsigned int rank;
+
+    if (i < 0) {
+        return 0;
     }
+    pthread_mutex_lock(&rank_lock);
+    refresh_ranks();
+    rank = ranking_rank(ranks, USER(i).ranked);
+    pthread_mutex_unlock(&rank_lock);
+    return rank;
+}
+
+
+/* Function: print_leaderboard                                                */
+/*   Prints users with the highest scores.                                    */
+/* Parameter(s):                                                              */
+/*   k - maximal number of users to print                                     */
+void print_leaderboard(unsigned int k) {
+    unsigned int i, count, rank = 0;
+    unsigned int ids[k > 0 ? k : 1];    /* Indices of the best users */
+    user_t* user;
+
+    pthread_mutex_lock(&rank_lock);
+    refresh_ranks();
+    count = ranking_top(ranks, k, ids);
+    printf("  *** Score table (top %u of %u) ***\n", count,
+            __atomic_load_n(&countRated, __ATOMIC_ACQUIRE));
+    for (i = 0; i < count; ++i) {
+        user = &USER(ids[i]);
+        /* Users with equal score share the same rank */
+        if (i == 0 || user->ranked != USER(ids[i - 1]).ranked) {
+            rank = i + 1;
+        }
+        printf("    %u. %s: %u wins, %u losses, %u draws\n", rank,
+                user->name, __atomic_load_n(&user->wins, __ATOMIC_RELAXED),
+                __atomic_load_n(&user->losses, __ATOMIC_RELAXED),
+                __atomic_load_n(&user->draws, __ATOMIC_RELAXED));
+    }
+    pthread_mutex_unlock(&rank_lock);
 
     return;
 }
@@ -158,20 +473,18 @@ void save_result(const char* playerX, const char* playerO, char winner) {
 void load_ratings(void) {
     char name[MAX_NAME_LENGTH+1];
     unsigned int wins, losses, draws;
-    user_t* user;
-    int i;
+    FILE* file;
+
+    TRACE_BEGIN("load_ratings");
+    init_shards();
 
     /* Read users from file */
-    FILE* file = fopen(FILENAME, "r");
+    file = fopen(FILENAME, "r");
     if (file != NULL) {
         while (!feof(file)) {
             if (fscanf(file, "%32s %u %u %u", name,
                     &wins, &losses, &draws) == 4) {
-                user = create_user(name);
-                user->wins = wins;
-                user->losses = losses;
-                user->draws = draws;
-                add_user(user);
+                add_user(name, wins, losses, draws);
             } else {
                 break;
             }
@@ -179,45 +492,48 @@ void load_ratings(void) {
         fclose(file);
     }
 
-    /* Make sure that computer is rated as well */
-    if (find_user(COMPUTER_NAME) < 0) {
-        add_user(create_user(COMPUTER_NAME));
-    }
+    /* Make sure that computer players are rated as well */
+    add_user(COMPUTER_NAME, 0, 0, 0);
+    add_user(MCTS_NAME, 0, 0, 0);
 
-    /* Output all ratings */
-    printf("  *** Score table ***\n");
-    for (i = 0; i < countRated; ++i) {
-        printf("    %s: %d wins, %d losses, %d draws\n",
-                rated[i].name, rated[i].wins, rated[i].losses, rated[i].draws);
-    }
+    /* Output the best players */
+    print_leaderboard(TOP_PLAYERS);
 
+    TRACE_END("load_ratings");
     return;
 }
 
 
 /* Function: save_ratings                                                     */
 /*   Saves ratings of registered users to file. Call this function once at    */
-/*   exit because it will remove all ratings and free memory.                 */
+/*   exit (when no other threads use ratings) because it will remove all      */
+/*   ratings and free memory.                                                 */
 void save_ratings(void) {
-    int i;
+    unsigned int i;
+
+    TRACE_BEGIN("save_ratings");
     /* Write users to file */
-    FILE* file = fopen(FILENAME, "w");
-    if (file == NULL) {
-        printf("\nError: cannot save ratings.\n\n");
-    } else {
-        for (i = 0; i < countRated; ++i) {
-            fprintf(file, "%s\t%u\t%u\t%u\n", rated[i].name, rated[i].wins,
-                    rated[i].losses, rated[i].draws);
-            free(rated[i].name);
-        }
-        fclose(file);
+    flush_ratings();
 
-        /* Remove all ratings */
-        free(rated);
-        rated = NULL;
-        countRated = maxRated = 0;
+    /* Remove all ratings */
+    for (i = 0; i < countRated; ++i) {
+        free(USER(i).name);
+    }
+    /* Chunk may be allocated for entry that failed to be added */
+    for (i = 0; i < MAX_CHUNKS && rated[i] != NULL; ++i) {
+        free(rated[i]);
+        rated[i] = NULL;
+    }
+    for (i = 0; i < SHARDS; ++i) {
+        free(shards[i].slots);
+        pthread_mutex_destroy(&shards[i].lock);
     }
+    destruct_ranking(ranks);
+    ranks = NULL;
+    stale_head = NO_USER;
+    countRated = 0;
 
+    TRACE_END("save_ratings");
     return;
 }
 
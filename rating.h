@@ -3,7 +3,10 @@
 
 
 #define COMPUTER_NAME   "Albert-AI"
+#define MCTS_NAME       "Albert-MCTS"
 #define FILENAME        "ratings.txt"
+/* Number of the best players shown at start up                               */
+#define TOP_PLAYERS     10
 
 
 /* Asks user for name (nickname) until valid name is entered.                 */
@@ -12,6 +15,12 @@ char* choose_name(void);
 /* Writes result of game to score table.                                      */
 void save_result(const char* playerX, const char* playerO, char winner);
 
+/* Rank of player in leaderboard (1 is the best, 0 if player isn't rated).    */
+unsigned int player_rank(const char* name);
+
+/* Prints k players with the highest scores.                                  */
+void print_leaderboard(unsigned int k);
+
 /* Loads score tables from file ("ratings.txt")                               */
 void load_ratings(void);
 
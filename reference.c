@@ -0,0 +1,324 @@
+#ifndef _REFERENCE_C_
+#define _REFERENCE_C_
+
+#include "reference.h"
+#include <stdlib.h>     /* malloc(), calloc(), free() */
+
+
+/* Main points on scale of position estimation                                */
+#define WIN     +1.0
+#define DRAW     0.0
+#define LOSS    -1.0
+
+/* Macros: Determines player whose turn is now                                */
+#define CURR_PLAYER(board)  ((board)->moves % 2 == 0 ? CELL_X : CELL_O)
+
+/* Macros: Determines player whose turn is next                               */
+#define NEXT_PLAYER(board)  ((board)->moves % 2 != 0 ? CELL_X : CELL_O)
+
+/* Macros: Determines player whose turn was earlier                           */
+#define PREV_PLAYER(board)  NEXT_PLAYER(board)
+
+
+/* Function: ref_create                                                       */
+/*   Creates an empty reference board.                                        */
+/* Parameter(s):                                                              */
+/*   cols - number of columns                                                 */
+/*   rows - number of rows                                                    */
+/* Returns:                                                                   */
+/*   Pointer to created board.                                                */
+ref_board* ref_create(unsigned int cols, unsigned int rows) {
+    ref_board* board = malloc(sizeof(ref_board));
+    unsigned int i;
+
+    board->cols = cols;
+    board->rows = rows;
+    board->moves = 0;
+    board->heights = calloc(cols, sizeof(unsigned int));
+    board->cells = malloc(cols * rows);
+    for (i = 0; i < cols * rows; ++i) {
+        board->cells[i] = CELL_EMPTY;
+    }
+    return board;
+}
+
+
+/* Function: ref_destruct                                                     */
+/*   Releases memory of reference board.                                      */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+void ref_destruct(ref_board* board) {
+    free(board->heights);
+    free(board->cells);
+    free(board);
+}
+
+
+/* Function: ref_get_cell                                                     */
+/*   Gets type of disk at selected cell.                                      */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column index (zero-based, starts from left side)                */
+/*   row    - row index (zero-based, starts from bottom side)                 */
+/* Returns:                                                                   */
+/*   CELL_X, CELL_O or CELL_EMPTY.                                            */
+char ref_get_cell(const ref_board* board, unsigned int column,
+        unsigned int row) {
+    return board->cells[column * board->rows + row];
+}
+
+
+/* Function: ref_set_cell                                                     */
+/*   Places a disk of selected type on top of selected column.                */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column index (zero-based, starts from left side)                */
+/*   disk   - character of disk ('X' or 'O')                                  */
+/* Returns:                                                                   */
+/*   1 if move is valid, 0 otherwise.                                         */
+int ref_set_cell(ref_board* board, unsigned int column, char disk) {
+    if (board->heights[column] == board->rows) {
+        return 0;   /* Cannot place disk on top of full column */
+    }
+    board->cells[column * board->rows + board->heights[column]++] = disk;
+    ++(board->moves);
+    return 1;
+}
+
+
+/* Function: ref_unset_cell                                                   */
+/*   Removes last disk dropped into selected column.                          */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column index (zero-based, starts from left side)                */
+void ref_unset_cell(ref_board* board, unsigned int column) {
+    board->cells[column * board->rows + --(board->heights[column])] =
+            CELL_EMPTY;
+    --(board->moves);
+}
+
+
+/* Function: count_line                                                       */
+/*   Counts neighboring disks of same type in one direction from a cell.      */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of cell                                                  */
+/*   row    - row of cell                                                     */
+/*   dc, dr - direction                                                       */
+/* Returns:                                                                   */
+/*   Number of disks of the same type as disk at cell (the cell excluded).    */
+static int count_line(const ref_board* board, int column, int row,
+        int dc, int dr) {
+    char disk = ref_get_cell(board, column, row);
+    int c, r, count = 0;
+
+    for (c = column + dc, r = row + dr;
+            c >= 0 && r >= 0 && c < (int)board->cols && r < (int)board->rows;
+            c += dc, r += dr) {
+        if (ref_get_cell(board, c, r) != disk) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+
+/* Function: ref_check_win                                                    */
+/*   Checks if player won by gathering 4 disks in any available direction.    */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column index of last move                                       */
+/* Returns:                                                                   */
+/*   1 if win, 0 otherwise.                                                   */
+int ref_check_win(const ref_board* board, unsigned int column) {
+    int row = board->heights[column] - 1;
+
+    /* Vertical direction counts only disks under the last one */
+    return (count_line(board, column, row, 0, -1) + 1 >= COUNT_TO_WIN
+            || count_line(board, column, row, -1, 0)
+                + count_line(board, column, row, 1, 0) + 1 >= COUNT_TO_WIN
+            || count_line(board, column, row, -1, -1)
+                + count_line(board, column, row, 1, 1) + 1 >= COUNT_TO_WIN
+            || count_line(board, column, row, -1, 1)
+                + count_line(board, column, row, 1, -1) + 1 >= COUNT_TO_WIN);
+}
+
+
+/* Function: ref_count_win_moves                                              */
+/*   Searches for moves that yields winning alignment of disks immediately.   */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   disk  - type of disk to put                                              */
+/*   move  - where the last winning move will be written (if such exists)     */
+/* Returns:                                                                   */
+/*   Number of different moves that immediately yield winning alignment.      */
+int ref_count_win_moves(ref_board* board, char disk, int* move) {
+    int count = 0;
+    unsigned int column;
+
+    for (column = 0; column < board->cols; ++column) {
+        if (ref_set_cell(board, column, disk)) {
+            if (ref_check_win(board, column)) {
+                ++count;
+                *move = column;
+            }
+            ref_unset_cell(board, column);
+        }
+    }
+    return count;
+}
+
+
+/* Function: quick_win                                                        */
+/*   Checks if game is over or is won in one or two moves (see computer.c).   */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of last move                                             */
+/*   est    - where result of game (WIN/DRAW/LOSS) will be written            */
+/* Returns:                                                                   */
+/*   1 if game is over or will be finished in one or two moves, 0 otherwise.  */
+static int quick_win(ref_board* board, unsigned int column, float* est) {
+    int count, move, ret = 1;
+    char disk = PREV_PLAYER(board);
+    char opponent = CURR_PLAYER(board);
+
+    if (ref_check_win(board, column)) {
+        *est = WIN;
+    } else if (board->moves == board->cols * board->rows) {
+        *est = DRAW;
+    } else if (ref_count_win_moves(board, opponent, &move) > 0) {
+        *est = LOSS;
+    } else if ((count = ref_count_win_moves(board, disk, &move)) > 1) {
+        *est = WIN;
+    } else if (count == 1) {
+        ret = 0;
+        /* Opponent blocks the only winning move; check the cell above it */
+        ref_set_cell(board, move, opponent);
+        if (ref_set_cell(board, move, disk)) {
+            if (ref_check_win(board, move)) {
+                ret = 1;
+                *est = WIN;
+            }
+            ref_unset_cell(board, move);
+        }
+        ref_unset_cell(board, move);
+    } else {
+        ret = 0;
+    }
+    return ret;
+}
+
+
+/* Function: win_alignment                                                    */
+/*   Checks if selected cell completes winning alignment horizontally or      */
+/*   diagonally in one horizontal direction.                                  */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   col   - selected column                                                  */
+/*   row   - selected row                                                     */
+/*   disk  - player's disk type                                               */
+/*   dc    - horizontal direction (+1 to the right, -1 to the left)           */
+/* Returns:                                                                   */
+/*   1 if cell completes winning alignment, 0 otherwise.                      */
+static unsigned int win_alignment(const ref_board* board, int col, int row,
+        char disk, int dc) {
+    static const int slopes[3] = {0, 1, -1};   /* Horizontal, diagonals */
+    int i, dr, count;
+
+    if (col + dc * (COUNT_TO_WIN - 1) < 0
+            || col + dc * (COUNT_TO_WIN - 1) >= (int)board->cols) {
+        return 0;   /* Not enough space to make winning alignment */
+    }
+    for (i = 0; i < 3; ++i) {
+        dr = slopes[i];
+        if (row + dr * (COUNT_TO_WIN - 1) < 0
+                || row + dr * (COUNT_TO_WIN - 1) >= (int)board->rows) {
+            continue;
+        }
+        for (count = 1; count < COUNT_TO_WIN; ++count) {
+            if (ref_get_cell(board, col + dc * count, row + dr * count)
+                    != disk) {
+                break;
+            }
+        }
+        if (count == COUNT_TO_WIN) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/* Function: count_open_pos                                                   */
+/*   Counts cells above the lowest empty cell of every column that complete   */
+/*   winning alignment to the left or to the right.                           */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   disk  - player's disk type                                               */
+/* Returns:                                                                   */
+/*   Number of open cells.                                                    */
+static unsigned int count_open_pos(const ref_board* board, char disk) {
+    unsigned int count = 0U;
+    unsigned int column, row;
+
+    for (column = 0; column < board->cols; ++column) {
+        for (row = board->heights[column] + 1; row < board->rows; ++row) {
+            count += (win_alignment(board, column, row, disk, -1)
+                    | win_alignment(board, column, row, disk, +1));
+        }
+    }
+    return count;
+}
+
+
+/* Function: ref_eval                                                         */
+/*   Evaluates position on board from point of view of player who made last   */
+/*   move (see eval() in computer.c).                                         */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of last move                                             */
+/* Returns:                                                                   */
+/*   Estimation of "probability" on the scale -1...+1.                        */
+float ref_eval(ref_board* board, unsigned int column) {
+    float est;
+    int opens, opponent;
+
+    if (quick_win(board, column, &est)) {
+        return est;
+    }
+    opens = count_open_pos(board, CURR_PLAYER(board));
+    opponent = count_open_pos(board, NEXT_PLAYER(board));
+    return (float)(opens - opponent) / (opens + opponent + 1);
+}
+
+
+/* Function: ref_is_local                                                     */
+/*   Checks if move should be searched. On boards wider than MAX_COLUMNS only */
+/*   moves less than COUNT_TO_WIN columns away from some disk are searched   */
+/*   (the middle column on empty board).                                      */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column of move                                                  */
+/* Returns:                                                                   */
+/*   1 if move should be searched, 0 otherwise.                               */
+int ref_is_local(const ref_board* board, unsigned int column) {
+    unsigned int c;
+
+    if (board->cols <= MAX_COLUMNS) {
+        return 1;
+    }
+    if (board->moves == 0) {
+        return (column == board->cols / 2);
+    }
+    for (c = 0; c < board->cols; ++c) {
+        if (board->heights[c] > 0 && (c > column ? c - column : column - c)
+                < COUNT_TO_WIN) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+#endif /* _REFERENCE_C_ */
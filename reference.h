@@ -0,0 +1,48 @@
+#ifndef _REFERENCE_H_
+#define _REFERENCE_H_
+
+#include "conn4.h"
+
+
+/* Reference implementation of engine: plain grid of cells and straightforward*/
+/* loops of the original conn4.c and computer.c. It is kept frozen and used   */
+/* only to check optimized backends (see difftest.c).                         */
+typedef struct {
+    unsigned int cols;      /* Number of columns */
+    unsigned int rows;      /* Number of rows */
+    unsigned int moves;     /* Moves made on this board */
+    unsigned int* heights;  /* Heights of columns */
+    char* cells;            /* Cells stored column by column */
+} ref_board;
+
+
+/* Create an empty reference board of selected dimensions.                    */
+ref_board* ref_create(unsigned int cols, unsigned int rows);
+
+/* Destruct a reference board (release memory).                               */
+void ref_destruct(ref_board* board);
+
+/* Gets type of disk at selected cell.                                        */
+char ref_get_cell(const ref_board* board, unsigned int column,
+        unsigned int row);
+
+/* Places a disk of selected type on top of selected column (if it isn't full)*/
+int ref_set_cell(ref_board* board, unsigned int column, char disk);
+
+/* Removes last disk dropped into selected column.                            */
+void ref_unset_cell(ref_board* board, unsigned int column);
+
+/* Checks if the last move brings a victory.                                  */
+int ref_check_win(const ref_board* board, unsigned int column);
+
+/* Counts moves that yield winning alignment immediately (see computer.c).    */
+int ref_count_win_moves(ref_board* board, char disk, int* move);
+
+/* Evaluates position from point of view of player who made last move.       */
+float ref_eval(ref_board* board, unsigned int column);
+
+/* Checks if move is searched (see is_local() in computer.c).                 */
+int ref_is_local(const ref_board* board, unsigned int column);
+
+
+#endif /* _REFERENCE_H_ */
@@ -0,0 +1,156 @@
+#ifndef _RENDER_C_
+#define _RENDER_C_
+
+#include "render.h"
+#include <stdio.h>      /* printf(), sprintf(), fwrite(), fflush() */
+#include <stdlib.h>     /* malloc(), realloc(), free() */
+
+
+/* Length of the longest escape sequence that moves cursor and draws a cell  */
+#define ESCAPE_BYTES    32
+
+
+/* Current mode of rendering */
+static int mode = RENDER_PLAIN;
+
+/* Cells shown on terminal after the last frame (column-major order) and     */
+/* dimensions of the board they belong to. NULL if nothing is shown yet.      */
+static char* shown = NULL;
+static unsigned int shown_cols = 0;
+static unsigned int shown_rows = 0;
+
+/* Buffer where frames are built */
+static char* buf = NULL;
+static unsigned int buf_size = 0;
+
+
+/* Function: reserve                                                          */
+/*   Makes sure that frame buffer can hold selected number of characters.    */
+/* Parameter(s):                                                              */
+/*   size - required size of buffer                                           */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory allocation failed.                          */
+static int reserve(unsigned int size) {
+    char* tmp;
+
+    if (size > buf_size) {
+        tmp = realloc(buf, size);
+        if (tmp == NULL) {
+            return 0;
+        }
+        buf = tmp;
+        buf_size = size;
+    }
+    return 1;
+}
+
+
+/* Function: set_render_mode                                                  */
+/*   Selects mode of rendering. In ANSI mode the first frame clears screen    */
+/*   and draws the whole board on top of it, then the rest of screen becomes  */
+/*   a scrolling region for other output, and following frames redraw only   */
+/*   cells changed since previous frame.                                      */
+/* Parameter(s):                                                              */
+/*   new_mode - RENDER_PLAIN or RENDER_ANSI                                   */
+void set_render_mode(int new_mode) {
+    render_finish();
+    mode = new_mode;
+    return;
+}
+
+
+/* Function: render_full                                                      */
+/*   Draws the whole board at top of cleared screen and remembers its cells.  */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+static void render_full(conn4_state* board) {
+    unsigned int len, col, row;
+    unsigned int lines = 3 + 2 * get_rows();    /* Lines of one frame */
+
+    free(shown);
+    shown = malloc(get_size());
+    if (shown == NULL || !reserve(frame_bytes() + 3 * ESCAPE_BYTES)) {
+        free(shown);
+        shown = NULL;
+        print_board(board);
+        return;
+    }
+    shown_cols = get_cols();
+    shown_rows = get_rows();
+    for (col = 0; col < shown_cols; ++col) {
+        for (row = 0; row < shown_rows; ++row) {
+            shown[col * shown_rows + row] = get_cell(board, col, row);
+        }
+    }
+
+    /* Clear screen and move cursor home */
+    len = sprintf(buf, "\033[2J\033[H");
+    len += format_board(board, buf + len);
+    /* Let other output scroll below the board */
+    len += sprintf(buf + len, "\033[%u;r\033[%u;1H", lines + 1, lines + 1);
+    fwrite(buf, 1, len, stdout);
+    fflush(stdout);
+    return;
+}
+
+
+/* Function: render_board                                                     */
+/*   Renders board to standard output. In plain mode the whole frame is       */
+/*   printed; in ANSI mode only cells changed since the last frame are        */
+/*   redrawn. Every frame is written with a single call.                      */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+void render_board(conn4_state* board) {
+    unsigned int len, col, row;
+    char cell;
+
+    if (mode == RENDER_PLAIN) {
+        print_board(board);
+        return;
+    }
+    if (shown == NULL || shown_cols != get_cols() ||
+            shown_rows != get_rows()) {
+        render_full(board);
+        return;
+    }
+    if (!reserve((get_size() + 2) * ESCAPE_BYTES)) {
+        print_board(board);
+        return;
+    }
+
+    len = sprintf(buf, "\0337");    /* Save cursor */
+    for (col = 0; col < shown_cols; ++col) {
+        for (row = 0; row < shown_rows; ++row) {
+            cell = get_cell(board, col, row);
+            if (shown[col * shown_rows + row] != cell) {
+                shown[col * shown_rows + row] = cell;
+                /* See format_board() for position of cell within frame */
+                len += sprintf(buf + len, "\033[%u;%uH%c",
+                        4 + 2 * (shown_rows - 1 - row), 4 * col + 3, cell);
+            }
+        }
+    }
+    len += sprintf(buf + len, "\0338");    /* Restore cursor */
+    fwrite(buf, 1, len, stdout);
+    fflush(stdout);
+    return;
+}
+
+
+/* Function: render_finish                                                    */
+/*   Restores scrolling region of terminal if ANSI mode was used and          */
+/*   releases memory of renderer.                                             */
+void render_finish(void) {
+    if (shown != NULL) {
+        printf("\033[r\033[999;1H\n");
+        fflush(stdout);
+    }
+    free(shown);
+    free(buf);
+    shown = buf = NULL;
+    buf_size = 0;
+    return;
+}
+
+
+#endif /* _RENDER_C_ */
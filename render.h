@@ -0,0 +1,22 @@
+#ifndef _RENDER_H_
+#define _RENDER_H_
+
+#include "conn4.h"
+
+
+/* Modes of rendering                                                         */
+#define RENDER_PLAIN    0   /* Every frame is printed in full */
+#define RENDER_ANSI     1   /* Only changed cells are redrawn in place */
+
+
+/* Selects mode of rendering.                                                 */
+void set_render_mode(int mode);
+
+/* Renders board to standard output according to selected mode.               */
+void render_board(conn4_state* board);
+
+/* Restores terminal after rendering in ANSI mode.                            */
+void render_finish(void);
+
+
+#endif /* _RENDER_H_ */
@@ -0,0 +1,357 @@
+#ifndef _SCHED_C_
+#define _SCHED_C_
+
+#include "sched.h"
+#include "async.h"
+#include <stdlib.h>     /* malloc(), realloc(), free() */
+#include <pthread.h>    /* pthread_*() */
+
+
+/* Initial capacity of queue of requests                                      */
+#define QUEUE_SIZE      64
+
+
+/* Request of move. Search runs by quanta on any thread of scheduler and     */
+/* holds no thread between them.                                             */
+struct sched_request_struct {
+    scheduler* sched;
+    search_task* task;      /* Resumable search */
+    move_ctl ctl;           /* Limits of request */
+    unsigned long long seq; /* Order of queueing, for fairness among equals */
+    int fresh;              /* Flag: search has no move yet */
+    pthread_cond_t ready;   /* Signalled when move is ready */
+    int done;               /* Flag: move is ready */
+    int column;             /* Chosen move */
+};
+
+/* Scheduler. Queue is binary heap ordered by deadline (the earliest first), */
+/* so requests closest to their deadline are served first. Request that    */
+/* used its quantum is queued again behind requests with the same deadline. */
+/* Requests that have no move yet go before all others, so under overload  */
+/* every request gets a move in time and only depth of search suffers.      */
+struct scheduler_struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;        /* Signalled when queue isn't empty */
+    pthread_t* threads;
+    unsigned int count;         /* Number of threads */
+    unsigned int quantum;       /* Positions searched per quantum */
+    sched_request** queue;      /* Heap of waiting requests */
+    unsigned int size;          /* Number of waiting requests */
+    unsigned int capacity;      /* Capacity of heap */
+    unsigned long long seq;     /* Counter of queueings */
+    int stop;                   /* Flag: scheduler is being destructed */
+};
+
+
+/* Function: before                                                           */
+/*   Compares priorities of requests.                                         */
+/* Parameter(s):                                                              */
+/*   a, b - requests                                                          */
+/* Returns:                                                                   */
+/*   1 if request a should be served before request b, 0 otherwise.           */
+static int before(const sched_request* a, const sched_request* b) {
+    if (a->fresh != b->fresh) {
+        return a->fresh;
+    }
+    if (a->ctl.deadline != b->ctl.deadline) {
+        return (a->ctl.deadline < b->ctl.deadline);
+    }
+    return (a->seq < b->seq);
+}
+
+
+/* Function: push_request                                                     */
+/*   Puts request into queue. Lock of scheduler has to be held.              */
+/* Parameter(s):                                                              */
+/*   sched   - scheduler structure                                            */
+/*   request - request structure                                              */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory can't be allocated.                         */
+static int push_request(scheduler* sched, sched_request* request) {
+    unsigned int i, parent;
+    sched_request** queue;
+
+    if (sched->size == sched->capacity) {
+        queue = realloc(sched->queue, 2 * sched->capacity * sizeof(*queue));
+        if (queue == NULL) {
+            return 0;
+        }
+        sched->queue = queue;
+        sched->capacity *= 2;
+    }
+    request->seq = sched->seq++;
+    request->fresh = (search_move(request->task) < 0);
+    /* Sift up */
+    for (i = sched->size++; i > 0; i = parent) {
+        parent = (i - 1) / 2;
+        if (!before(request, sched->queue[parent])) {
+            break;
+        }
+        sched->queue[i] = sched->queue[parent];
+    }
+    sched->queue[i] = request;
+    pthread_cond_signal(&sched->work);
+    return 1;
+}
+
+
+/* Function: pop_request                                                      */
+/*   Takes request with the highest priority from non-empty queue. Lock of   */
+/*   scheduler has to be held.                                                */
+/* Parameter(s):                                                              */
+/*   sched - scheduler structure                                              */
+/* Returns:                                                                   */
+/*   Request structure.                                                       */
+static sched_request* pop_request(scheduler* sched) {
+    unsigned int i, child;
+    sched_request* top = sched->queue[0];
+    sched_request* last = sched->queue[--sched->size];
+
+    /* Sift down */
+    for (i = 0; (child = 2 * i + 1) < sched->size; i = child) {
+        if (child + 1 < sched->size &&
+                before(sched->queue[child + 1], sched->queue[child])) {
+            ++child;
+        }
+        if (!before(sched->queue[child], last)) {
+            break;
+        }
+        sched->queue[i] = sched->queue[child];
+    }
+    sched->queue[i] = last;
+    return top;
+}
+
+
+/* Function: finish_request                                                   */
+/*   Publishes move of finished request. Lock of scheduler has to be held.   */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+static void finish_request(sched_request* request) {
+    request->column = search_move(request->task);
+    request->done = 1;
+    pthread_cond_broadcast(&request->ready);
+    return;
+}
+
+
+/* Function: worker                                                           */
+/*   Thread function that serves requests by quanta in order of priority.    */
+/* Parameter(s):                                                              */
+/*   arg - scheduler structure                                                */
+static void* worker(void* arg) {
+    scheduler* sched = arg;
+    sched_request* request;
+    int finished;
+
+    pthread_mutex_lock(&sched->lock);
+    for (;;) {
+        while (sched->size == 0 && !sched->stop) {
+            pthread_cond_wait(&sched->work, &sched->lock);
+        }
+        if (sched->size == 0) {
+            break;  /* Stopped and nothing left to finish */
+        }
+        request = pop_request(sched);
+        pthread_mutex_unlock(&sched->lock);
+
+        finished = search_step(request->task, sched->quantum);
+
+        pthread_mutex_lock(&sched->lock);
+        if (sched->stop) {
+            __atomic_store_n(&request->ctl.cancelled, 1, __ATOMIC_RELEASE);
+        }
+        if (finished || !push_request(sched, request)) {
+            finish_request(request);
+        }
+    }
+    pthread_mutex_unlock(&sched->lock);
+    return NULL;
+}
+
+
+/* Function: create_scheduler                                                 */
+/*   Creates scheduler and starts its threads.                                */
+/* Parameter(s):                                                              */
+/*   threads - number of threads (the number of processor cores is usually   */
+/*             the best choice)                                               */
+/*   quantum - number of positions searched by request before it yields its  */
+/*             thread (SCHED_QUANTUM if 0)                                    */
+/* Returns:                                                                   */
+/*   New scheduler, or NULL if it can't be created.                           */
+scheduler* create_scheduler(unsigned int threads, unsigned int quantum) {
+    scheduler* sched = malloc(sizeof(*sched));
+
+    if (sched == NULL) {
+        return NULL;
+    }
+    sched->threads = malloc((threads > 0 ? threads : 1) *
+            sizeof(*sched->threads));
+    sched->queue = malloc(QUEUE_SIZE * sizeof(*sched->queue));
+    if (sched->threads == NULL || sched->queue == NULL) {
+        free(sched->threads);
+        free(sched->queue);
+        free(sched);
+        return NULL;
+    }
+    sched->quantum = (quantum > 0 ? quantum : SCHED_QUANTUM);
+    sched->size = 0;
+    sched->capacity = QUEUE_SIZE;
+    sched->seq = 0;
+    sched->stop = 0;
+    pthread_mutex_init(&sched->lock, NULL);
+    pthread_cond_init(&sched->work, NULL);
+    for (sched->count = 0; sched->count < threads; ++sched->count) {
+        if (pthread_create(&sched->threads[sched->count], NULL, worker,
+                sched) != 0) {
+            break;
+        }
+    }
+    if (sched->count == 0) {
+        destruct_scheduler(sched);
+        return NULL;
+    }
+    return sched;
+}
+
+
+/* Function: destruct_scheduler                                               */
+/*   Cancels waiting requests, lets threads finish them and stops threads.   */
+/*   Requests have to be released by caller anyway.                           */
+/* Parameter(s):                                                              */
+/*   sched - scheduler structure                                              */
+void destruct_scheduler(scheduler* sched) {
+    unsigned int i;
+
+    if (sched == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&sched->lock);
+    sched->stop = 1;
+    for (i = 0; i < sched->size; ++i) {
+        __atomic_store_n(&sched->queue[i]->ctl.cancelled, 1,
+                __ATOMIC_RELEASE);
+    }
+    pthread_cond_broadcast(&sched->work);
+    pthread_mutex_unlock(&sched->lock);
+    for (i = 0; i < sched->count; ++i) {
+        pthread_join(sched->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&sched->lock);
+    pthread_cond_destroy(&sched->work);
+    free(sched->threads);
+    free(sched->queue);
+    free(sched);
+    return;
+}
+
+
+/* Function: sched_submit                                                     */
+/*   Starts request of computer's move. Function returns at once; the move   */
+/*   is obtained by sched_poll() or sched_await().                            */
+/* Parameter(s):                                                              */
+/*   sched   - scheduler structure                                            */
+/*   board   - board structure (copied)                                       */
+/*   seconds - time limit, or 0 for SEARCH_TIME                               */
+/* Returns:                                                                   */
+/*   New request, or NULL if it can't be started.                             */
+sched_request* sched_submit(scheduler* sched, conn4_state* board,
+        double seconds) {
+    sched_request* request = malloc(sizeof(*request));
+
+    if (request == NULL) {
+        return NULL;
+    }
+    request->sched = sched;
+    request->ctl.deadline = monotonic_time() +
+            (seconds > 0.0 ? seconds : SEARCH_TIME);
+    request->ctl.cancelled = 0;
+    request->done = 0;
+    request->column = -1;
+    request->task = create_search(board, &request->ctl);
+    if (request->task == NULL) {
+        free(request);
+        return NULL;
+    }
+    pthread_cond_init(&request->ready, NULL);
+
+    pthread_mutex_lock(&sched->lock);
+    if (!push_request(sched, request)) {
+        pthread_mutex_unlock(&sched->lock);
+        pthread_cond_destroy(&request->ready);
+        destruct_search(request->task);
+        free(request);
+        return NULL;
+    }
+    pthread_mutex_unlock(&sched->lock);
+    return request;
+}
+
+
+/* Function: sched_poll                                                       */
+/*   Checks if move is ready without blocking.                                */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+/*   column  - where chosen move will be written if ready                     */
+/* Returns:                                                                   */
+/*   1 if move is ready, 0 otherwise.                                         */
+int sched_poll(sched_request* request, int* column) {
+    int done;
+
+    pthread_mutex_lock(&request->sched->lock);
+    done = request->done;
+    if (done) {
+        *column = request->column;
+    }
+    pthread_mutex_unlock(&request->sched->lock);
+    return done;
+}
+
+
+/* Function: sched_await                                                      */
+/*   Waits until move is ready.                                               */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+/* Returns:                                                                   */
+/*   Chosen move.                                                             */
+int sched_await(sched_request* request) {
+    int column;
+
+    pthread_mutex_lock(&request->sched->lock);
+    while (!request->done) {
+        pthread_cond_wait(&request->ready, &request->sched->lock);
+    }
+    column = request->column;
+    pthread_mutex_unlock(&request->sched->lock);
+    return column;
+}
+
+
+/* Function: sched_cancel                                                     */
+/*   Cancels request. Search is finished with the best move found so far at  */
+/*   its next quantum.                                                        */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+void sched_cancel(sched_request* request) {
+    __atomic_store_n(&request->ctl.cancelled, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+
+/* Function: sched_release                                                    */
+/*   Cancels request if it isn't finished, waits for it and releases it.     */
+/* Parameter(s):                                                              */
+/*   request - request structure                                              */
+void sched_release(sched_request* request) {
+    if (request != NULL) {
+        sched_cancel(request);
+        sched_await(request);
+        pthread_cond_destroy(&request->ready);
+        destruct_search(request->task);
+        free(request);
+    }
+    return;
+}
+
+
+#endif /* _SCHED_C_ */
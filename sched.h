@@ -0,0 +1,40 @@
+#ifndef _SCHED_H_
+#define _SCHED_H_
+
+#include "computer.h"
+
+
+/* Number of positions searched by request before it yields its thread       */
+#define SCHED_QUANTUM   1024
+
+
+/* Pool of threads interleaving searches of computer's moves                  */
+typedef struct scheduler_struct scheduler;
+
+/* Request of computer's move served by scheduler                             */
+typedef struct sched_request_struct sched_request;
+
+/* Creates scheduler with fixed number of threads.                            */
+scheduler* create_scheduler(unsigned int threads, unsigned int quantum);
+
+/* Finishes all requests and stops threads of scheduler.                      */
+void destruct_scheduler(scheduler* sched);
+
+/* Starts request of computer's move with selected time limit.                */
+sched_request* sched_submit(scheduler* sched, conn4_state* board,
+        double seconds);
+
+/* Checks if move is ready without blocking.                                  */
+int sched_poll(sched_request* request, int* column);
+
+/* Waits until move is ready.                                                 */
+int sched_await(sched_request* request);
+
+/* Cancels request; search stops at its next quantum.                         */
+void sched_cancel(sched_request* request);
+
+/* Waits for request to finish and releases it.                               */
+void sched_release(sched_request* request);
+
+
+#endif /* _SCHED_H_ */
@@ -0,0 +1,115 @@
+#ifndef _SCHEDBENCH_C_
+#define _SCHEDBENCH_C_
+
+#include "conn4.h"
+#include "sched.h"
+#include "async.h"
+#include "kernels.h"
+#include <stdio.h>      /* printf(), fprintf() */
+#include <stdlib.h>     /* malloc(), free(), atoi(), atof(), qsort(), EXIT_* */
+
+
+/* Number of random moves of opening of every request                         */
+#define OPENING_MOVES   6
+
+
+/* Function: compare_doubles                                                  */
+/*   Comparison function for qsort().                                         */
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+/* Function: main                                                             */
+/*   Submits many concurrent requests of computer's move to scheduler at     */
+/*   once and reports distribution of their latencies.                        */
+/*   Usage: schedbench columns rows requests seconds [threads] [quantum]      */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    unsigned int i, n, k, count, threads = 1, quantum = SCHED_QUANTUM;
+    unsigned long long seed = 12345;
+    double limit;
+    double* latency;        /* Time of submission, then latency of request */
+    int column;
+    sched_request** requests;
+    conn4_state* board;
+    scheduler* sched;
+
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s columns rows requests seconds [threads] "
+                "[quantum]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    set_dimensions(atoi(argv[1]), atoi(argv[2]));
+    count = atoi(argv[3]);
+    limit = atof(argv[4]);
+    if (argc > 5) {
+        threads = atoi(argv[5]);
+    }
+    if (argc > 6) {
+        quantum = atoi(argv[6]);
+    }
+    init_kernels();
+
+    requests = malloc(count * sizeof(*requests));
+    latency = malloc(count * sizeof(*latency));
+    board = create_board();
+    sched = create_scheduler(threads, quantum);
+    if (requests == NULL || latency == NULL ||
+            board == NULL || sched == NULL || count == 0) {
+        fprintf(stderr, "Error: can't start benchmark.\n");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < count; ++i) {
+        /* Random opening without immediate win */
+        while (board->moves > 0) {
+            for (k = 0; get_height(board, k) == 0; ++k) {
+            }
+            unset_cell(board, k);
+        }
+        for (k = 0; k < OPENING_MOVES; ++k) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            column = (seed >> 33) % get_cols();
+            if (set_cell(board, column,
+                    board->moves % 2 ? CELL_O : CELL_X) &&
+                    check_win(board, column)) {
+                unset_cell(board, column);
+            }
+        }
+        latency[i] = monotonic_time();
+        requests[i] = sched_submit(sched, board, limit);
+    }
+
+    /* Requests finish in order of deadlines, that is order of submission */
+    for (i = 0; i < count; ++i) {
+        if (requests[i] != NULL) {
+            sched_await(requests[i]);
+        }
+        latency[i] = monotonic_time() - latency[i];
+    }
+    for (i = 0, n = 0; i < count; ++i) {
+        n += (latency[i] > limit);
+        sched_release(requests[i]);
+    }
+    destruct_scheduler(sched);
+
+    qsort(latency, count, sizeof(*latency), compare_doubles);
+    printf("Requests: %u, threads: %u, quantum: %u\n", count, threads,
+            quantum);
+    printf("Latency: median %.3f s, 99%% %.3f s, max %.3f s\n",
+            latency[count / 2], latency[count * 99 / 100],
+            latency[count - 1]);
+    printf("Late requests: %u (deadline %.3f s)\n", n, limit);
+
+    destruct_board(board);
+    free(requests);
+    free(latency);
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _SCHEDBENCH_C_ */
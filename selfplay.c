@@ -0,0 +1,358 @@
+#ifndef _SELFPLAY_C_
+#define _SELFPLAY_C_
+
+#include "conn4.h"
+#include "computer.h"
+#include "kernels.h"
+#include "dataset.h"
+#include <stdio.h>      /* printf(), fprintf(), fwrite() */
+#include <stdlib.h>     /* malloc(), calloc(), free(), atoi(), strtoull() */
+#include <string.h>     /* memcpy() */
+#include <time.h>       /* clock_gettime() */
+#include <unistd.h>     /* sysconf() */
+#include <pthread.h>    /* pthread_create(), pthread_join(), pthread_mutex_* */
+
+
+/* Maximal number of threads                                                  */
+#define MAX_THREADS     64
+/* Default depth of search that chooses moves and scores positions           */
+#define DEFAULT_DEPTH   1
+/* Games begin with up to this number of random moves                         */
+#define OPENING_PLIES   8
+/* Probability (1/N) that move is random instead of the best move found      */
+#define EXPLORE         16
+/* Probability (1/N) that searched position is sampled                        */
+#define SAMPLE          2
+/* Number of records buffered by thread before they are written to file      */
+#define WRITE_BATCH     4096
+/* Generation stops after this number of consecutive games without new      */
+/* position (board has fewer distinct positions than requested)              */
+#define STALE_GAMES     1000
+
+
+/* State of generating thread                                                 */
+typedef struct {
+    pthread_t thread;
+    unsigned long long rng;         /* State of random number generator */
+    unsigned long long games;       /* Games played */
+    unsigned long long duplicates;  /* Sampled positions seen before */
+} selfplay_worker;
+
+
+/* Number of records to generate and number of records taken so far         */
+static unsigned long long target = 0;
+static unsigned long long taken = 0;
+/* Number of consecutive games (of all threads) without new position         */
+static unsigned long long stale_games = 0;
+/* Depth of search                                                            */
+static unsigned int depth = DEFAULT_DEPTH;
+
+/* Set of keys of sampled positions (open addressing, 0 marks free slot).    */
+/* Keys are inserted by compare-and-swap, so threads share it without locks. */
+static unsigned long long* seen = NULL;
+static unsigned long long seen_mask = 0;
+
+/* Output file shared by threads                                              */
+static FILE* output = NULL;
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+static int write_failed = 0;
+
+
+/* Function: seconds                                                          */
+/* Returns:                                                                   */
+/*   Current value of monotonic clock in seconds.                             */
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* Function: next_random                                                      */
+/*   Generates next pseudorandom number (splitmix64).                         */
+/* Parameter(s):                                                              */
+/*   rng - state of generator                                                 */
+/* Returns:                                                                   */
+/*   Pseudorandom 64-bit number.                                              */
+static unsigned long long next_random(unsigned long long* rng) {
+    unsigned long long z = (*rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+/* Function: position_key                                                     */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   Nonzero key of position with bits spread by final mixing of MurmurHash3. */
+static unsigned long long position_key(conn4_state* board) {
+    unsigned long long key = board_hash(board);
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (key != 0 ? key : 1);
+}
+
+
+/* Function: insert_key                                                       */
+/*   Adds key of position to set of sampled positions.                        */
+/* Parameter(s):                                                              */
+/*   key - nonzero key of position                                            */
+/* Returns:                                                                   */
+/*   1 if key is new, 0 if position was sampled before.                       */
+static int insert_key(unsigned long long key) {
+    unsigned long long i = key & seen_mask;
+    unsigned long long cur;
+
+    for (;;) {
+        cur = __atomic_load_n(&seen[i], __ATOMIC_RELAXED);
+        if (cur == 0 && __atomic_compare_exchange_n(&seen[i], &cur, key, 0,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+        /* Slot is taken (perhaps just now by other thread) */
+        if (cur == key) {
+            return 0;
+        }
+        i = (i + 1) & seen_mask;
+    }
+}
+
+
+/* Function: flush_records                                                    */
+/*   Appends buffered records of thread to output file.                       */
+/* Parameter(s):                                                              */
+/*   buf   - records                                                          */
+/*   count - number of records                                                */
+static void flush_records(const unsigned char* buf, unsigned int count) {
+    if (count == 0) {
+        return;
+    }
+    pthread_mutex_lock(&output_lock);
+    if (fwrite(buf, record_bytes(), count, output) != count) {
+        write_failed = 1;
+    }
+    pthread_mutex_unlock(&output_lock);
+    return;
+}
+
+
+/* Function: random_move                                                      */
+/*   Chooses random column that isn't full.                                   */
+/* Parameter(s):                                                              */
+/*   board - board structure (game isn't over)                                */
+/*   rng   - state of random number generator                                 */
+/* Returns:                                                                   */
+/*   Column of move.                                                          */
+static int random_move(conn4_state* board, unsigned long long* rng) {
+    unsigned int c, free_cols = 0, k;
+
+    for (c = 0; c < get_cols(); ++c) {
+        free_cols += (get_height(board, c) < (int)get_rows());
+    }
+    k = next_random(rng) % free_cols;
+    for (c = 0; ; ++c) {
+        if (get_height(board, c) < (int)get_rows() && k-- == 0) {
+            return c;
+        }
+    }
+}
+
+
+/* Function: generate                                                         */
+/*   Thread function that plays games (random opening, then the best moves   */
+/*   of search with occasional random moves) and samples positions searched  */
+/*   without forced move. Position is labeled by score of search and, at the */
+/*   end of game, by its result. New positions are written to output until   */
+/*   enough records are taken, or until STALE_GAMES consecutive games bring   */
+/*   no new position.                                                         */
+/* Parameter(s):                                                              */
+/*   arg - worker structure                                                   */
+static void* generate(void* arg) {
+    selfplay_worker* self = arg;
+    conn4_state* board = create_board();
+    unsigned int size = get_size(), bytes = record_bytes();
+    unsigned int i, n, opening, buffered = 0;
+    int* history = malloc(size * sizeof(*history));
+    /* Positions sampled in current game with keys and disk of player to move */
+    unsigned char* game = malloc((size_t)size * bytes);
+    unsigned long long* keys = malloc(size * sizeof(*keys));
+    char* sides = malloc(size);
+    unsigned char* batch = malloc((size_t)WRITE_BATCH * bytes);
+    unsigned char* rec;
+    dataset_label label;
+    int column, forced, fresh, done = 0;
+    char disk, winner;
+    float score;
+
+    if (board == NULL || history == NULL || game == NULL || keys == NULL ||
+            sides == NULL || batch == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        write_failed = 1;
+        done = 1;
+    }
+
+    while (!done && __atomic_load_n(&taken, __ATOMIC_RELAXED) < target &&
+            __atomic_load_n(&stale_games, __ATOMIC_RELAXED) < STALE_GAMES) {
+        opening = next_random(&self->rng) % (OPENING_PLIES + 1);
+        winner = CELL_EMPTY;
+        n = 0;
+        while (board->moves < size) {
+            disk = (board->moves % 2 == 0 ? CELL_X : CELL_O);
+            if (board->moves < opening ||
+                    next_random(&self->rng) % EXPLORE == 0) {
+                column = random_move(board, &self->rng);
+            } else {
+                forced = 0;
+                column = computer_move_rec(board, depth, &forced, &score);
+                if (!forced && next_random(&self->rng) % SAMPLE == 0) {
+                    rec = game + (size_t)n * bytes;
+                    board_pack(board, rec);
+                    label.depth = depth;
+                    label.score = (short)(score < -1.0f ? -DATASET_SCALE :
+                            score > 1.0f ? DATASET_SCALE :
+                            score * DATASET_SCALE);
+                    memcpy(rec + packed_bytes(), &label, sizeof(label));
+                    keys[n] = position_key(board);
+                    sides[n++] = disk;
+                }
+            }
+            set_cell(board, column, disk);
+            history[board->moves - 1] = column;
+            if (check_win(board, column)) {
+                winner = disk;
+                break;
+            }
+        }
+        while (board->moves > 0) {
+            unset_cell(board, history[board->moves - 1]);
+        }
+        ++self->games;
+
+        /* Label positions by result and take new ones */
+        for (fresh = 0, i = 0; i < n && !done; ++i) {
+            if (!insert_key(keys[i])) {
+                ++self->duplicates;
+                continue;
+            }
+            fresh = 1;
+            if (__atomic_fetch_add(&taken, 1, __ATOMIC_RELAXED) >= target) {
+                done = 1;
+                break;
+            }
+            rec = game + (size_t)i * bytes;
+            memcpy(&label, rec + packed_bytes(), sizeof(label));
+            label.result = (winner == CELL_EMPTY ? 0 :
+                    winner == sides[i] ? 1 : -1);
+            memcpy(rec + packed_bytes(), &label, sizeof(label));
+            memcpy(batch + (size_t)buffered * bytes, rec, bytes);
+            if (++buffered == WRITE_BATCH) {
+                flush_records(batch, buffered);
+                buffered = 0;
+            }
+        }
+        if (fresh) {
+            __atomic_store_n(&stale_games, 0, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_add(&stale_games, 1, __ATOMIC_RELAXED);
+        }
+    }
+    flush_records(batch, buffered);
+
+    destruct_board(board);
+    free(history);
+    free(game);
+    free(keys);
+    free(sides);
+    free(batch);
+    return NULL;
+}
+
+
+/* Function: main                                                             */
+/*   Generates dataset of distinct positions labeled by self-play games.      */
+/*   Usage: selfplay columns rows positions file [threads] [depth] [seed]     */
+/*   All processors are used by default.                                      */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int i;
+    unsigned long long seed = 1, games = 0, duplicates = 0, written, slots;
+    selfplay_worker workers[MAX_THREADS];
+    double start, elapsed;
+
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s columns rows positions file [threads] "
+                "[depth] [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    set_dimensions(atoi(argv[1]), atoi(argv[2]));
+    target = strtoull(argv[3], NULL, 10);
+    if (argc > 5) {
+        threads = atoi(argv[5]);
+    } else if (threads < 1 || threads > MAX_THREADS) {
+        threads = (threads < 1 ? 1 : MAX_THREADS);
+    }
+    if (argc > 6) {
+        depth = atoi(argv[6]);
+    }
+    if (argc > 7) {
+        seed = strtoull(argv[7], NULL, 10);
+    }
+    if (get_cols() < MIN_COLUMNS || get_rows() < MIN_ROWS ||
+            threads < 1 || threads > MAX_THREADS || depth > 255) {
+        fprintf(stderr, "Error: invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+    init_kernels();
+
+    /* Set of keys is kept at most half full */
+    for (slots = 1024; slots < 2 * (target + threads); slots *= 2) {
+    }
+    seen = calloc(slots, sizeof(*seen));
+    seen_mask = slots - 1;
+    output = dataset_create(argv[4]);
+    if (seen == NULL || output == NULL) {
+        fprintf(stderr, "Error: cannot create dataset %s.\n", argv[4]);
+        return EXIT_FAILURE;
+    }
+
+    start = seconds();
+    for (i = 0; i < threads; ++i) {
+        workers[i].rng = seed * 0x9E3779B97F4A7C15ULL + i;
+        workers[i].games = 0;
+        workers[i].duplicates = 0;
+        pthread_create(&workers[i].thread, NULL, generate, &workers[i]);
+    }
+    for (i = 0; i < threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+        games += workers[i].games;
+        duplicates += workers[i].duplicates;
+    }
+    elapsed = seconds() - start;
+    /* Threads that reached target counted one taken record each in vain */
+    written = (taken < target ? taken : target);
+
+    if (!dataset_finish(output, written) || write_failed) {
+        fprintf(stderr, "Error: cannot write dataset %s.\n", argv[4]);
+        return EXIT_FAILURE;
+    }
+    free(seen);
+
+    if (written < target) {
+        printf("Board has no more new positions: %llu of %llu written\n",
+                written, target);
+    }
+    printf("Positions: %llu from %llu games (%llu duplicates dropped)\n",
+            written, games, duplicates);
+    printf("Time: %.2f s (%.0f positions per hour)\n", elapsed,
+            written / elapsed * 3600.0);
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _SELFPLAY_C_ */
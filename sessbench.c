@@ -0,0 +1,107 @@
+#ifndef _SESSBENCH_C_
+#define _SESSBENCH_C_
+
+#include "conn4.h"
+#include "session.h"
+#include "async.h"
+#include <stdio.h>      /* printf(), fprintf() */
+#include <stdlib.h>     /* atoi(), EXIT_* */
+#include <string.h>     /* memcmp() */
+
+
+/* Number of different random games paused again and again                    */
+#define GAMES           1024
+
+
+/* Function: random_game                                                      */
+/*   Plays random moves on empty board (game may be over before the end).     */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   seed  - state of random number generator                                 */
+static void random_game(conn4_state* board, unsigned long long* seed) {
+    unsigned int moves, column;
+
+    init_board(board, board->info);
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    for (moves = (*seed >> 33) % (get_size() + 1); moves > 0; --moves) {
+        do {
+            *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            column = (*seed >> 33) % get_cols();
+        } while (get_height(board, column) == get_rows());
+        set_cell(board, column, board->moves % 2 == 0 ? CELL_X : CELL_O);
+    }
+    return;
+}
+
+
+/* Function: main                                                             */
+/*   Pauses many random games in store of sessions, resumes them all and      */
+/*   checks that every position is restored exactly.                          */
+/*   Usage: sessbench columns rows sessions [file]                            */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    unsigned int i, count;
+    unsigned long long seed = 12345;
+    double start, put, get;
+    conn4_state* games[GAMES];
+    conn4_state* check;
+    conn4_pool* pool;
+    session_store* store;
+
+    if (argc < 4 || atoi(argv[1]) < MIN_COLUMNS || atoi(argv[2]) < MIN_ROWS) {
+        fprintf(stderr, "Usage: %s columns rows sessions [file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    set_dimensions(atoi(argv[1]), atoi(argv[2]));
+    count = atoi(argv[3]);
+    store = create_store(argc > 4 ? argv[4] : NULL);
+    pool = create_pool(GAMES + 1);
+    if (store == NULL || pool == NULL) {
+        fprintf(stderr, "Error: can't create store of sessions.\n");
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < GAMES; ++i) {
+        games[i] = pool_acquire(pool);
+        random_game(games[i], &seed);
+    }
+    check = pool_acquire(pool);
+
+    start = monotonic_time();
+    for (i = 0; i < count; ++i) {
+        if (store_put(store, games[i % GAMES]) == SESSION_NONE) {
+            fprintf(stderr, "Error: store is full after %u sessions.\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    put = monotonic_time() - start;
+
+    start = monotonic_time();
+    for (i = 0; i < count; ++i) {
+        store_get(store, i, check);
+    }
+    get = monotonic_time() - start;
+
+    for (i = 0; i < count; ++i) {
+        store_get(store, i, check);
+        if (check->moves != games[i % GAMES]->moves || memcmp(check->info,
+                games[i % GAMES]->info, board_bytes()) != 0) {
+            fprintf(stderr, "Error: session %u isn't restored.\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Sessions: %u, %u bytes each (board in memory: %u + %u bytes)\n",
+            store_count(store), packed_bytes(), (unsigned int)sizeof(*check),
+            board_bytes());
+    printf("Pause: %.1f ns, resume: %.1f ns per session\n",
+            put / count * 1e9, get / count * 1e9);
+
+    destruct_pool(pool);
+    destruct_store(store);
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _SESSBENCH_C_ */
@@ -0,0 +1,293 @@
+#ifndef _SESSION_C_
+#define _SESSION_C_
+
+#include "session.h"
+#include <stdlib.h>     /* malloc(), realloc(), free() */
+#include <string.h>     /* memcpy(), memcmp(), memset() */
+#include <fcntl.h>      /* open() */
+#include <unistd.h>     /* close(), ftruncate(), pread() */
+#include <sys/mman.h>   /* mmap(), munmap() */
+#include <sys/stat.h>   /* fstat() */
+
+
+/* Signature of store file                                                    */
+#define STORE_MAGIC     "CONN4SS1"
+/* Number of slots of new store (store doubles when it gets full)            */
+#define STORE_SLOTS     1024
+
+/* States of slot (the first byte of slot)                                    */
+#define SLOT_FREE       0
+#define SLOT_USED       1
+
+
+/* Header of store, followed by slots. Slot is state byte and packed board;  */
+/* free slot holds index of the next free slot instead of board. Store has   */
+/* no pointers, so the same layout is kept in memory and in file.            */
+typedef struct {
+    char magic[8];          /* STORE_MAGIC */
+    unsigned int cols;      /* Dimensions of board */
+    unsigned int rows;
+    unsigned int slot;      /* Size of slot in bytes */
+    unsigned int capacity;  /* Number of allocated slots */
+    unsigned int used;      /* Number of slots ever used */
+    unsigned int count;     /* Number of stored sessions */
+    unsigned int free;      /* The first free slot, or SESSION_NONE */
+} store_header;
+
+struct session_store_struct {
+    store_header* header;   /* Slab of store */
+    size_t mapped;          /* Size of mapping of file */
+    int fd;                 /* Store file, or -1 if store is in memory */
+};
+
+
+/* Macros: Address of slot of session                                         */
+#define SLOT(store,id)  ((unsigned char*)((store)->header + 1) +             \
+                            (size_t)(id) * (store)->header->slot)
+
+
+/* Function: slab_bytes                                                       */
+/* Parameter(s):                                                              */
+/*   slot     - size of slot in bytes                                         */
+/*   capacity - number of slots                                               */
+/* Returns:                                                                   */
+/*   Size of slab of store in bytes.                                          */
+static size_t slab_bytes(unsigned int slot, unsigned int capacity) {
+    return sizeof(store_header) + (size_t)slot * capacity;
+}
+
+
+/* Function: resize                                                           */
+/*   Changes number of slots of store. Store in file is remapped; sessions   */
+/*   are addressed by index, so moving of slab is harmless.                   */
+/* Parameter(s):                                                              */
+/*   store    - store of sessions                                             */
+/*   capacity - new number of slots                                           */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise (store is unchanged).                       */
+static int resize(session_store* store, unsigned int capacity) {
+    size_t bytes = slab_bytes(store->header->slot, capacity);
+    void* slab;
+
+    if (store->fd < 0) {
+        slab = realloc(store->header, bytes);
+        if (slab == NULL) {
+            return 0;
+        }
+    } else {
+        if (ftruncate(store->fd, bytes) != 0) {
+            return 0;
+        }
+        slab = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                store->fd, 0);
+        if (slab == MAP_FAILED) {
+            return 0;
+        }
+        munmap(store->header, store->mapped);
+        store->mapped = bytes;
+    }
+    store->header = slab;
+    store->header->capacity = capacity;
+    return 1;
+}
+
+
+/* Function: open_file                                                        */
+/*   Maps store file. File with store of board of other dimensions (or not a  */
+/*   store at all) is replaced by an empty store.                             */
+/* Parameter(s):                                                              */
+/*   store - store with empty header describing expected layout              */
+/*   init  - expected header                                                  */
+/*   name  - name of file                                                     */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise.                                            */
+static int open_file(session_store* store, const store_header* init,
+        const char* name) {
+    store_header old;
+    struct stat st;
+    size_t bytes = slab_bytes(init->slot, init->capacity);
+    void* slab;
+    int valid;
+
+    store->fd = open(name, O_RDWR | O_CREAT, 0644);
+    if (store->fd < 0 || fstat(store->fd, &st) != 0) {
+        return 0;
+    }
+    valid = (pread(store->fd, &old, sizeof(old), 0) == sizeof(old) &&
+            memcmp(old.magic, init->magic, sizeof(old.magic)) == 0 &&
+            old.cols == init->cols && old.rows == init->rows &&
+            old.slot == init->slot && old.used <= old.capacity &&
+            (size_t)st.st_size == slab_bytes(old.slot, old.capacity));
+    if (valid) {
+        bytes = st.st_size;
+    } else if (ftruncate(store->fd, 0) != 0 ||
+            ftruncate(store->fd, bytes) != 0) {
+        return 0;
+    }
+    slab = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+    if (slab == MAP_FAILED) {
+        return 0;
+    }
+    store->header = slab;
+    store->mapped = bytes;
+    if (!valid) {
+        *store->header = *init;
+    }
+    return 1;
+}
+
+
+/* Function: create_store                                                     */
+/*   Creates a store of sessions of board of current dimensions. Store in    */
+/*   file lets operating system move idle sessions out of memory and keeps   */
+/*   them after restart. Store isn't synchronized.                            */
+/* Parameter(s):                                                              */
+/*   filename - name of store file, or NULL for store in memory               */
+/* Returns:                                                                   */
+/*   New store, or NULL if it can't be created.                               */
+session_store* create_store(const char* filename) {
+    store_header init;
+    session_store* store = malloc(sizeof(*store));
+
+    if (store == NULL) {
+        return NULL;
+    }
+    memset(&init, 0, sizeof(init));
+    memcpy(init.magic, STORE_MAGIC, sizeof(init.magic));
+    init.cols = get_cols();
+    init.rows = get_rows();
+    /* Free slot must have room for index of the next one */
+    init.slot = 1 + (packed_bytes() > sizeof(unsigned int) ?
+            packed_bytes() : sizeof(unsigned int));
+    init.capacity = STORE_SLOTS;
+    init.free = SESSION_NONE;
+    store->header = NULL;
+    store->mapped = 0;
+    store->fd = -1;
+
+    if (filename == NULL) {
+        store->header = malloc(slab_bytes(init.slot, init.capacity));
+        if (store->header != NULL) {
+            *store->header = init;
+            return store;
+        }
+    } else if (open_file(store, &init, filename)) {
+        return store;
+    }
+    destruct_store(store);
+    return NULL;
+}
+
+
+/* Function: destruct_store                                                   */
+/*   Releases store. Sessions of store in file stay in file.                  */
+/* Parameter(s):                                                              */
+/*   store - store of sessions                                                */
+void destruct_store(session_store* store) {
+    if (store->fd >= 0) {
+        if (store->header != NULL) {
+            munmap(store->header, store->mapped);
+        }
+        close(store->fd);
+    } else {
+        free(store->header);
+    }
+    free(store);
+    return;
+}
+
+
+/* Function: store_put                                                        */
+/*   Stores position of board as a new session. Slots of removed sessions are */
+/*   reused first; store doubles when all slots are used.                     */
+/* Parameter(s):                                                              */
+/*   store - store of sessions                                                */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   Identifier of session, or SESSION_NONE if store can't grow.              */
+unsigned int store_put(session_store* store, const conn4_state* board) {
+    store_header* header = store->header;
+    unsigned int id;
+
+    if (header->free != SESSION_NONE) {
+        id = header->free;
+        memcpy(&header->free, SLOT(store, id) + 1, sizeof(header->free));
+    } else {
+        if (header->used == header->capacity && (header->capacity >=
+                SESSION_NONE / 2 || !resize(store, 2 * header->capacity))) {
+            return SESSION_NONE;
+        }
+        header = store->header;
+        id = header->used++;
+    }
+    SLOT(store, id)[0] = SLOT_USED;
+    board_pack(board, SLOT(store, id) + 1);
+    ++(header->count);
+    return id;
+}
+
+
+/* Function: store_get                                                        */
+/*   Restores position of stored session.                                     */
+/* Parameter(s):                                                              */
+/*   store - store of sessions                                                */
+/*   id    - identifier of session                                            */
+/*   board - board structure (of current dimensions)                          */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if there is no such session.                          */
+int store_get(const session_store* store, unsigned int id, conn4_state* board) {
+    if (id >= store->header->used || SLOT(store, id)[0] != SLOT_USED) {
+        return 0;
+    }
+    board_unpack(board, SLOT(store, id) + 1);
+    return 1;
+}
+
+
+/* Function: store_update                                                     */
+/*   Replaces position of stored session (e.g. when game is paused again).    */
+/* Parameter(s):                                                              */
+/*   store - store of sessions                                                */
+/*   id    - identifier of session                                            */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if there is no such session.                          */
+int store_update(session_store* store, unsigned int id,
+        const conn4_state* board) {
+    if (id >= store->header->used || SLOT(store, id)[0] != SLOT_USED) {
+        return 0;
+    }
+    board_pack(board, SLOT(store, id) + 1);
+    return 1;
+}
+
+
+/* Function: store_remove                                                     */
+/*   Removes session; its slot goes to list of free slots.                    */
+/* Parameter(s):                                                              */
+/*   store - store of sessions                                                */
+/*   id    - identifier of session                                            */
+void store_remove(session_store* store, unsigned int id) {
+    if (id >= store->header->used || SLOT(store, id)[0] != SLOT_USED) {
+        return;
+    }
+    SLOT(store, id)[0] = SLOT_FREE;
+    memcpy(SLOT(store, id) + 1, &store->header->free,
+            sizeof(store->header->free));
+    store->header->free = id;
+    --(store->header->count);
+    return;
+}
+
+
+/* Function: store_count                                                      */
+/* Parameter(s):                                                              */
+/*   store - store of sessions                                                */
+/* Returns:                                                                   */
+/*   Number of stored sessions.                                               */
+unsigned int store_count(const session_store* store) {
+    return store->header->count;
+}
+
+
+#endif /* _SESSION_C_ */
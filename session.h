@@ -0,0 +1,39 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+#include "conn4.h"
+
+
+/* Identifier returned when session can't be stored                           */
+#define SESSION_NONE    0xffffffffU
+
+
+/* Store of idle games. Boards are kept packed (see packed_bytes()) in one    */
+/* contiguous slab, either in memory or in memory-mapped file.                */
+typedef struct session_store_struct session_store;
+
+/* Create a store in memory (filename is NULL) or in file (existing store of  */
+/* board of current dimensions is reopened).                                  */
+session_store* create_store(const char* filename);
+
+/* Destruct a store (file keeps stored sessions).                             */
+void destruct_store(session_store* store);
+
+/* Stores position of board as a new session and returns its identifier.      */
+unsigned int store_put(session_store* store, const conn4_state* board);
+
+/* Restores position of stored session to board.                              */
+int store_get(const session_store* store, unsigned int id, conn4_state* board);
+
+/* Replaces position of stored session by position of board.                  */
+int store_update(session_store* store, unsigned int id,
+        const conn4_state* board);
+
+/* Removes session from store.                                                */
+void store_remove(session_store* store, unsigned int id);
+
+/* Number of stored sessions.                                                 */
+unsigned int store_count(const session_store* store);
+
+
+#endif /* _SESSION_H_ */
@@ -0,0 +1,400 @@
+#ifndef _SOLVE_C_
+#define _SOLVE_C_
+
+#include "conn4.h"
+#include "solver.h"
+#include <stdio.h>      /* printf(), fprintf(), FILE, fopen(), fdopen() */
+#include <stdlib.h>     /* malloc(), realloc(), free(), atoi(), qsort() */
+#include <string.h>     /* memcpy() */
+#include <unistd.h>     /* fork(), pipe(), read(), write(), fsync() */
+#include <sys/wait.h>   /* waitpid() */
+
+
+/* Maximal number of worker processes                                         */
+#define MAX_WORKERS     256
+/* Size of transposition table of every worker (log2 of entries)             */
+#define TABLE_BITS      22
+/* Value of work unit that isn't solved yet                                   */
+#define UNSOLVED        (-2)
+
+
+/* Work unit: position at split ply given by sequence of moves               */
+typedef struct {
+    unsigned long long hash;    /* Hash of position */
+    unsigned char* moves;       /* Moves leading to position */
+    int value;                  /* Value for player to move, or UNSOLVED */
+} work_unit;
+
+/* Worker process                                                             */
+typedef struct {
+    pid_t pid;
+    int tasks;                  /* Pipe end where indices of units are sent */
+    int busy;                   /* Flag: worker solves a unit */
+} worker_t;
+
+
+/* List of work units                                                         */
+static work_unit* units = NULL;
+static unsigned int count_units = 0;
+static unsigned int max_units = 0;
+/* Ply where tree is split into units                                         */
+static unsigned int split = 0;
+
+
+/* Function: add_unit                                                         */
+/*   Adds position on board to list of work units unless it is there already */
+/*   (transpositions are solved once).                                        */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   moves - moves leading to position (split items)                          */
+static void add_unit(conn4_state* board, const unsigned char* moves) {
+    if (count_units == max_units) {
+        max_units = (max_units == 0 ? 1024 : 2 * max_units);
+        units = realloc(units, max_units * sizeof(*units));
+    }
+    units[count_units].hash = board_hash(board);
+    units[count_units].moves = malloc(split);
+    memcpy(units[count_units].moves, moves, split);
+    units[count_units].value = UNSOLVED;
+    ++count_units;
+    return;
+}
+
+
+/* Function: compare_units                                                    */
+/*   Helper function for qsort() that orders units by hash of position.       */
+static int compare_units(const void* a, const void* b) {
+    unsigned long long x = ((const work_unit*)a)->hash;
+    unsigned long long y = ((const work_unit*)b)->hash;
+    return (x > y) - (x < y);
+}
+
+
+/* Function: find_unit                                                        */
+/*   Finds work unit of position by hash (units must be sorted).              */
+/* Parameter(s):                                                              */
+/*   hash - hash of position                                                  */
+/* Returns:                                                                   */
+/*   Index of unit, or -1 if not found.                                       */
+static int find_unit(unsigned long long hash) {
+    int lo = 0, hi = (int)count_units - 1, mid;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (units[mid].hash == hash) {
+            return mid;
+        } else if (units[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+
+/* Function: enumerate                                                        */
+/*   Collects positions at split ply where game still goes on.                */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   moves - moves made so far                                                */
+static void enumerate(conn4_state* board, unsigned char* moves) {
+    unsigned int column;
+    char disk = (board->moves % 2 == 0 ? CELL_X : CELL_O);
+
+    if (board->moves == split) {
+        add_unit(board, moves);
+        return;
+    }
+    for (column = 0; column < get_cols(); ++column) {
+        if (set_cell(board, column, disk)) {
+            moves[board->moves - 1] = column;
+            if (!check_win(board, column) && board->moves < get_size()) {
+                enumerate(board, moves);
+            }
+            unset_cell(board, column);
+        }
+    }
+    return;
+}
+
+
+/* Function: dedup_units                                                      */
+/*   Sorts units by hash and removes transpositions.                          */
+static void dedup_units(void) {
+    unsigned int i, n = 0;
+
+    qsort(units, count_units, sizeof(*units), compare_units);
+    for (i = 0; i < count_units; ++i) {
+        if (n > 0 && units[n - 1].hash == units[i].hash) {
+            free(units[i].moves);
+        } else {
+            units[n++] = units[i];
+        }
+    }
+    count_units = n;
+    return;
+}
+
+
+/* Function: replay                                                           */
+/*   Sets up position of work unit on empty board.                            */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   unit  - work unit                                                        */
+static void replay(conn4_state* board, const work_unit* unit) {
+    unsigned int i;
+
+    init_board(board, board->info);
+    for (i = 0; i < split; ++i) {
+        set_cell(board, unit->moves[i], (i % 2 == 0 ? CELL_X : CELL_O));
+    }
+    return;
+}
+
+
+/* Function: load_checkpoint                                                  */
+/*   Reads values of units solved by previous runs. Checkpoint is a text     */
+/*   file with a header line "columns rows split" and lines "hash value".     */
+/* Parameter(s):                                                              */
+/*   filename - name of checkpoint file                                       */
+/* Returns:                                                                   */
+/*   Number of solved units, or -1 if checkpoint belongs to another setup.    */
+static int load_checkpoint(const char* filename) {
+    unsigned int columns, rows, ply;
+    unsigned long long hash;
+    int value, i, solved = 0;
+    FILE* file = fopen(filename, "r");
+
+    if (file == NULL) {
+        return 0;   /* Nothing solved yet */
+    }
+    if (fscanf(file, "%u %u %u", &columns, &rows, &ply) != 3 ||
+            columns != get_cols() || rows != get_rows() || ply != split) {
+        fclose(file);
+        return -1;
+    }
+    while (fscanf(file, "%llx %d", &hash, &value) == 2) {
+        if ((i = find_unit(hash)) >= 0 && units[i].value == UNSOLVED) {
+            units[i].value = value;
+            ++solved;
+        }
+    }
+    fclose(file);
+    return solved;
+}
+
+
+/* Function: run_worker                                                       */
+/*   Body of worker process: reads indices of units from task pipe, solves   */
+/*   them and reports "worker index value" lines to result pipe. Lines are   */
+/*   shorter than PIPE_BUF, so reports of different workers never mix.       */
+/* Parameter(s):                                                              */
+/*   id      - number of worker                                               */
+/*   tasks   - read end of task pipe                                          */
+/*   results - write end of result pipe                                       */
+static void run_worker(int id, int tasks, int results) {
+    unsigned int index;
+    unsigned long long nodes = 0;
+    char line[64];
+    int len;
+    conn4_state* board = create_board();
+
+    solver_init(TABLE_BITS);
+    while (read(tasks, &index, sizeof(index)) == sizeof(index)) {
+        replay(board, &units[index]);
+        len = sprintf(line, "%d %u %d\n", id, index,
+                solve_position(board, &nodes));
+        if (write(results, line, len) != len) {
+            break;
+        }
+    }
+    solver_free();
+    destruct_board(board);
+    return;
+}
+
+
+/* Function: merge                                                            */
+/*   Computes values of positions above split ply from values of units and    */
+/*   writes them to book. Every line of book is value for player to move      */
+/*   followed by moves (one-based columns) leading to position.               */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   moves - moves made so far                                                */
+/*   book  - book file                                                        */
+/* Returns:                                                                   */
+/*   Value of position for player to move.                                    */
+static int merge(conn4_state* board, unsigned char* moves, FILE* book) {
+    unsigned int column, i;
+    int value, best = SOLVED_LOSS;
+    char disk = (board->moves % 2 == 0 ? CELL_X : CELL_O);
+
+    if (board->moves == split) {
+        return units[find_unit(board_hash(board))].value;
+    }
+    for (column = 0; column < get_cols(); ++column) {
+        if (set_cell(board, column, disk)) {
+            moves[board->moves - 1] = column;
+            if (check_win(board, column)) {
+                value = SOLVED_WIN;
+            } else if (board->moves == get_size()) {
+                value = SOLVED_DRAW;
+            } else {
+                value = -merge(board, moves, book);
+            }
+            unset_cell(board, column);
+            if (value > best) {
+                best = value;
+            }
+        }
+    }
+
+    fprintf(book, "%d", best);
+    for (i = 0; i < board->moves; ++i) {
+        fprintf(book, " %u", moves[i] + 1);
+    }
+    fprintf(book, "\n");
+    return best;
+}
+
+
+/* Function: main                                                             */
+/*   Solves root position of board of selected dimensions. Game tree is split */
+/*   at selected ply into work units that are solved by worker processes.     */
+/*   Every solved unit is appended to checkpoint file at once, so interrupted */
+/*   solve continues from where it stopped. At the end all values are merged  */
+/*   into book of positions above split ply.                                  */
+/*   Usage: solve columns rows split-ply workers checkpoint-file book-file    */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    unsigned int workers, i, next = 0, solved, index;
+    int w, value, fds[2], results;
+    unsigned char moves[256];
+    worker_t pool[MAX_WORKERS];
+    conn4_state* board;
+    FILE *checkpoint, *book, *input;
+
+    if (argc != 7) {
+        fprintf(stderr, "Usage: %s columns rows split-ply workers "
+                "checkpoint-file book-file\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    set_dimensions(atoi(argv[1]), atoi(argv[2]));
+    split = atoi(argv[3]);
+    workers = atoi(argv[4]);
+    if (get_cols() < MIN_COLUMNS || get_rows() < MIN_ROWS ||
+            get_rows() > 255 || split >= get_size() ||
+            split > sizeof(moves) || workers < 1 || workers > MAX_WORKERS) {
+        fprintf(stderr, "Error: invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Split the tree and restore progress of previous runs */
+    board = create_board();
+    enumerate(board, moves);
+    dedup_units();
+    if ((w = load_checkpoint(argv[5])) < 0) {
+        fprintf(stderr, "Error: checkpoint belongs to another setup.\n");
+        return EXIT_FAILURE;
+    }
+    solved = w;
+    printf("Work units: %u, solved earlier: %u\n", count_units, solved);
+    checkpoint = fopen(argv[5], "a");
+    if (checkpoint == NULL) {
+        fprintf(stderr, "Error: cannot open checkpoint file.\n");
+        return EXIT_FAILURE;
+    }
+    if (ftell(checkpoint) == 0) {
+        fprintf(checkpoint, "%u %u %u\n", get_cols(), get_rows(), split);
+    }
+
+    /* Start workers */
+    if (pipe(fds) != 0) {
+        return EXIT_FAILURE;
+    }
+    results = fds[0];
+    for (i = 0; i < workers; ++i) {
+        int task[2];
+        if (pipe(task) != 0) {
+            return EXIT_FAILURE;
+        }
+        fflush(NULL);
+        pool[i].pid = fork();
+        if (pool[i].pid == 0) {
+            close(results);
+            close(task[1]);
+            for (w = 0; w < (int)i; ++w) {
+                close(pool[w].tasks);
+            }
+            run_worker(i, task[0], fds[1]);
+            _exit(EXIT_SUCCESS);
+        }
+        close(task[0]);
+        pool[i].tasks = task[1];
+        pool[i].busy = 0;
+    }
+    close(fds[1]);
+
+    /* Hand out units one by one and collect results */
+    input = fdopen(results, "r");
+    for (;;) {
+        for (i = 0; i < workers; ++i) {
+            while (!pool[i].busy && next < count_units) {
+                if (units[next].value == UNSOLVED) {
+                    write(pool[i].tasks, &next, sizeof(next));
+                    pool[i].busy = 1;
+                }
+                ++next;
+            }
+            if (!pool[i].busy && pool[i].tasks >= 0) {
+                close(pool[i].tasks);   /* No more work for this worker */
+                pool[i].tasks = -1;
+            }
+        }
+        if (fscanf(input, "%d %u %d", &w, &index, &value) != 3) {
+            break;  /* All workers have exited */
+        }
+        units[index].value = value;
+        pool[w].busy = 0;
+        fprintf(checkpoint, "%016llx %d\n", units[index].hash, value);
+        fflush(checkpoint);
+        fsync(fileno(checkpoint));
+        printf("Solved %u/%u\n", ++solved, count_units);
+    }
+    fclose(input);
+    fclose(checkpoint);
+    for (i = 0; i < workers; ++i) {
+        waitpid(pool[i].pid, NULL, 0);
+    }
+    if (solved < count_units) {
+        fprintf(stderr, "Error: %u units are not solved.\n",
+                count_units - solved);
+        return EXIT_FAILURE;
+    }
+
+    /* Merge values into book */
+    book = fopen(argv[6], "w");
+    if (book == NULL) {
+        fprintf(stderr, "Error: cannot open book file.\n");
+        return EXIT_FAILURE;
+    }
+    init_board(board, board->info);
+    value = merge(board, moves, book);
+    fclose(book);
+    printf("Value of root position for the first player: %s\n",
+            value == SOLVED_WIN ? "win" :
+            (value == SOLVED_DRAW ? "draw" : "loss"));
+
+    for (i = 0; i < count_units; ++i) {
+        free(units[i].moves);
+    }
+    free(units);
+    destruct_board(board);
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _SOLVE_C_ */
@@ -0,0 +1,142 @@
+#ifndef _SOLVER_C_
+#define _SOLVER_C_
+
+#include "solver.h"
+#include "threats.h"
+#include <stdlib.h>     /* calloc(), free() */
+
+
+/* Kinds of values stored in transposition table                              */
+#define BOUND_EXACT 1
+#define BOUND_LOWER 2
+#define BOUND_UPPER 3
+
+
+/* Entry of transposition table                                               */
+typedef struct {
+    unsigned long long key; /* Hash of position */
+    signed char value;      /* Value of position for player to move */
+    unsigned char bound;    /* Kind of value, 0 marks free entry */
+} solver_entry;
+
+
+/* Transposition table of solver (one per process)                            */
+static solver_entry* table = NULL;
+static unsigned long long table_mask = 0;
+
+
+/* Function: solver_init                                                      */
+/*   Allocates transposition table of solver.                                 */
+/* Parameter(s):                                                              */
+/*   bits - logarithm of number of entries                                    */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory allocation failed.                          */
+int solver_init(unsigned int bits) {
+    solver_free();
+    table = calloc(1ULL << bits, sizeof(*table));
+    table_mask = (1ULL << bits) - 1;
+    return (table != NULL);
+}
+
+
+/* Function: solver_free                                                      */
+/*   Releases transposition table of solver.                                  */
+void solver_free(void) {
+    free(table);
+    table = NULL;
+    return;
+}
+
+
+/* Function: negamax                                                          */
+/*   Computes value of position for player to move with alpha-beta pruning.  */
+/*   Values are exact: -1 (loss), 0 (draw) or +1 (win).                       */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   alpha - lower bound of interesting values                                */
+/*   beta  - upper bound of interesting values                                */
+/*   nodes - counter of visited positions                                     */
+/* Returns:                                                                   */
+/*   Value of position if it is within (alpha,beta), otherwise a bound.       */
+static int negamax(conn4_state* board, int alpha, int beta,
+        unsigned long long* nodes) {
+    unsigned int i, move;
+    int value, best = SOLVED_LOSS - 1;
+    int alpha0 = alpha;
+    unsigned long long key = 0;
+    solver_entry* entry = NULL;
+    char disk = (board->moves % 2 == 0 ? CELL_X : CELL_O);
+
+    ++(*nodes);
+    if (board->moves == get_size()) {
+        return SOLVED_DRAW;
+    }
+    /* Immediate win */
+    for (move = 0; move < get_cols(); ++move) {
+        if (set_cell(board, move, disk)) {
+            value = check_win(board, move);
+            unset_cell(board, move);
+            if (value) {
+                return SOLVED_WIN;
+            }
+        }
+    }
+    /* Static proof (from point of view of player who made last move) */
+    switch (prove_position(board)) {
+        case PROVEN_WIN:
+            return SOLVED_LOSS;
+        case PROVEN_DRAW:
+            return SOLVED_DRAW;
+    }
+    /* Transposition table */
+    if (table != NULL) {
+        key = board_hash(board);
+        entry = &table[key & table_mask];
+        if (entry->bound != 0 && entry->key == key) {
+            if (entry->bound == BOUND_EXACT ||
+                    (entry->bound == BOUND_LOWER && entry->value >= beta) ||
+                    (entry->bound == BOUND_UPPER && entry->value <= alpha)) {
+                return entry->value;
+            }
+        }
+    }
+
+    for (i = 0; i < get_cols() && alpha < beta; ++i) {
+        /* Central columns first (see eval_rec() in computer.c) */
+        move = get_cols() / 2 - (i + 1) / 2 * ((i % 2) * 2 - 1);
+        if (set_cell(board, move, disk)) {
+            value = -negamax(board, -beta, -alpha, nodes);
+            unset_cell(board, move);
+            if (value > best) {
+                best = value;
+            }
+            if (value > alpha) {
+                alpha = value;
+            }
+        }
+    }
+
+    if (entry != NULL) {
+        entry->key = key;
+        entry->value = best;
+        entry->bound = (best <= alpha0 ? BOUND_UPPER
+                : (best >= beta ? BOUND_LOWER : BOUND_EXACT));
+    }
+    return best;
+}
+
+
+/* Function: solve_position                                                   */
+/*   Computes exact value of position with best play of both players. It is   */
+/*   assumed that nobody has won yet.                                         */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/*   nodes - counter of visited positions (incremented)                       */
+/* Returns:                                                                   */
+/*   SOLVED_WIN, SOLVED_DRAW or SOLVED_LOSS for player to move.               */
+int solve_position(conn4_state* board, unsigned long long* nodes) {
+    return negamax(board, SOLVED_LOSS, SOLVED_WIN, nodes);
+}
+
+
+#endif /* _SOLVER_C_ */
@@ -0,0 +1,23 @@
+#ifndef _SOLVER_H_
+#define _SOLVER_H_
+
+#include "conn4.h"
+
+
+/* Exact values of position from point of view of player to move              */
+#define SOLVED_LOSS -1
+#define SOLVED_DRAW  0
+#define SOLVED_WIN   1
+
+
+/* Allocates transposition table of solver with 2^bits entries.               */
+int solver_init(unsigned int bits);
+
+/* Releases transposition table of solver.                                    */
+void solver_free(void);
+
+/* Computes exact value of position for player to move.                       */
+int solve_position(conn4_state* board, unsigned long long* nodes);
+
+
+#endif /* _SOLVER_H_ */
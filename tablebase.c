@@ -0,0 +1,459 @@
+#ifndef _TABLEBASE_C_
+#define _TABLEBASE_C_
+
+#include "tablebase.h"
+#include "playout.h"
+#include <stdio.h>      /* printf(), FILE, fopen(), fwrite(), fclose() */
+#include <stdlib.h>     /* malloc(), realloc(), calloc(), free(), qsort() */
+#include <string.h>     /* memcpy(), memcmp() */
+#include <fcntl.h>      /* open() */
+#include <unistd.h>     /* close() */
+#include <sys/mman.h>   /* mmap(), munmap() */
+#include <sys/stat.h>   /* fstat() */
+
+
+/* Signature of tablebase file                                                */
+#define TB_MAGIC        "CONN4TB1"
+/* Average number of positions in one bucket of tablebase                    */
+#define BUCKET_LOAD     4
+/* Maximal number of bits of position key stored in entry; the other bits    */
+/* are given by index of bucket                                               */
+#define REMAINDER_BITS  30
+
+
+/* Tablebase file consists of header, directory of buckets and entries. Key  */
+/* of position is scrambled by a bijective hash; its high bits select bucket */
+/* and its low bits are stored in entry together with value (2 bits), so     */
+/* every entry takes 4 bytes and probe scans BUCKET_LOAD entries on average. */
+typedef struct {
+    char magic[8];              /* TB_MAGIC */
+    unsigned int cols;          /* Dimensions of board */
+    unsigned int rows;
+    unsigned int bucket_bits;   /* Log2 of number of buckets */
+    unsigned int count;         /* Number of positions */
+} tb_header;
+
+/* All positions with the same number of disks, ordered by key               */
+typedef struct {
+    unsigned long long* keys;   /* Keys of positions */
+    unsigned char* values;      /* Values for player to move */
+    size_t count;               /* Number of positions */
+} tb_layer;
+
+
+/* Mapped tablebase file, or NULL if tablebase is closed                      */
+static tb_header* header = NULL;
+static const unsigned int* directory = NULL;   /* First entry of buckets */
+static const unsigned int* entries = NULL;     /* Remainders and values */
+static size_t mapped = 0;
+
+
+/* Function: key_bits                                                         */
+/* Returns:                                                                   */
+/*   Number of bits of position key (column of board takes rows + 1 bits).   */
+static unsigned int key_bits(void) {
+    return get_cols() * (get_rows() + 1);
+}
+
+
+/* Function: mix                                                              */
+/*   Scrambles key of position. Multiplication by odd number and xorshift are */
+/*   invertible modulo 2^bits, so different keys never collide.               */
+/* Parameter(s):                                                              */
+/*   key - key of position                                                    */
+/* Returns:                                                                   */
+/*   Scrambled key of the same number of bits.                                */
+static unsigned long long mix(unsigned long long key) {
+    unsigned int bits = key_bits();
+    unsigned long long mask = (bits == 64 ? ~0ULL : (1ULL << bits) - 1);
+
+    key = (key * 0x9E3779B97F4A7C15ULL) & mask;
+    key ^= key >> (bits + 1) / 2;
+    return (key * 0xBF58476D1CE4E5B9ULL) & mask;
+}
+
+
+/* Function: canonical                                                        */
+/*   Computes key of position that is the same for position and its mirror    */
+/*   image. Key is sum of bitboards (see playout.h) of player to move and of  */
+/*   all disks: every column turns into its height marker plus disks of       */
+/*   player to move, so key is unique.                                        */
+/* Parameter(s):                                                              */
+/*   own - disks of player to move                                            */
+/*   all - disks of both players                                              */
+/* Returns:                                                                   */
+/*   The least of keys of position and of its mirror image.                   */
+static unsigned long long canonical(unsigned long long own,
+        unsigned long long all) {
+    unsigned int h = get_rows() + 1, c;
+    unsigned long long field = (1ULL << h) - 1;
+    unsigned long long key = own + all, image = 0;
+
+    for (c = 0; c < get_cols(); ++c) {
+        image |= ((key >> (c * h)) & field) << ((get_cols() - 1 - c) * h);
+    }
+    return (image < key ? image : key);
+}
+
+
+/* Function: decode                                                           */
+/*   Restores bitboards of position from its key.                             */
+/* Parameter(s):                                                              */
+/*   key - key of position                                                    */
+/*   own - where disks of player to move will be written                      */
+/*   all - where disks of both players will be written                        */
+static void decode(unsigned long long key, unsigned long long* own,
+        unsigned long long* all) {
+    unsigned int h = get_rows() + 1, c;
+    unsigned long long field = (1ULL << h) - 1, f, height;
+
+    *own = *all = 0;
+    for (c = 0; c < get_cols(); ++c) {
+        /* Field of column is (2^height - 1) plus disks of player to move */
+        f = (key >> (c * h)) & field;
+        height = 1ULL << (63 - __builtin_clzll(f + 1));
+        *all |= (height - 1) << (c * h);
+        *own |= (f - (height - 1)) << (c * h);
+    }
+    return;
+}
+
+
+/* Function: compare_keys                                                     */
+/*   Helper function for qsort() and bsearch() that orders keys.              */
+static int compare_keys(const void* a, const void* b) {
+    unsigned long long x = *(const unsigned long long*)a;
+    unsigned long long y = *(const unsigned long long*)b;
+    return (x > y) - (x < y);
+}
+
+
+/* Function: expand                                                           */
+/*   Generates all positions reachable by one move from positions of layer,  */
+/*   except of positions where the game is already won.                       */
+/* Parameter(s):                                                              */
+/*   layer - layer of positions                                               */
+/*   next  - where the next layer will be written                             */
+/*   board - mask of cells of board                                           */
+/*   bottom- mask of bottom cells of board                                    */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory can't be allocated.                         */
+static int expand(const tb_layer* layer, tb_layer* next,
+        unsigned long long board, unsigned long long bottom) {
+    size_t i, capacity = 1024;
+    unsigned long long own, all, moves, cell;
+    unsigned long long* keys;
+
+    next->count = 0;
+    next->keys = malloc(capacity * sizeof(*next->keys));
+    if (next->keys == NULL) {
+        return 0;
+    }
+    for (i = 0; i < layer->count; ++i) {
+        decode(layer->keys[i], &own, &all);
+        for (moves = (all + bottom) & board; moves != 0; moves &= moves - 1) {
+            cell = moves & (~moves + 1);
+            if (bits_won(own | cell)) {
+                continue;   /* Game is over, position isn't stored */
+            }
+            if (next->count == capacity) {
+                capacity *= 2;
+                keys = realloc(next->keys, capacity * sizeof(*keys));
+                if (keys == NULL) {
+                    return 0;
+                }
+                next->keys = keys;
+            }
+            /* Opponent becomes player to move */
+            next->keys[next->count++] = canonical(all ^ own, all | cell);
+        }
+    }
+    /* Remove transpositions */
+    qsort(next->keys, next->count, sizeof(*next->keys), compare_keys);
+    for (i = 0, capacity = 0; i < next->count; ++i) {
+        if (capacity == 0 || next->keys[i] != next->keys[capacity - 1]) {
+            next->keys[capacity++] = next->keys[i];
+        }
+    }
+    next->count = capacity;
+    return 1;
+}
+
+
+/* Function: solve                                                            */
+/*   Computes exact values of positions of layer from values of the next     */
+/*   layer (retrograde analysis).                                             */
+/* Parameter(s):                                                              */
+/*   layer - layer of positions                                               */
+/*   next  - the next layer (solved already), or NULL for full board          */
+/*   board - mask of cells of board                                           */
+/*   bottom- mask of bottom cells of board                                    */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory can't be allocated.                         */
+static int solve(tb_layer* layer, const tb_layer* next,
+        unsigned long long board, unsigned long long bottom) {
+    size_t i;
+    unsigned long long own, all, moves, cell, key;
+    const unsigned long long* found;
+    int best;
+
+    layer->values = malloc(layer->count + 1);
+    if (layer->values == NULL) {
+        return 0;
+    }
+    for (i = 0; i < layer->count; ++i) {
+        decode(layer->keys[i], &own, &all);
+        best = (all == board ? TB_DRAW : TB_LOSS);
+        for (moves = (all + bottom) & board; moves != 0 && best != TB_WIN;
+                moves &= moves - 1) {
+            cell = moves & (~moves + 1);
+            if (bits_won(own | cell)) {
+                best = TB_WIN;
+                break;
+            }
+            key = canonical(all ^ own, all | cell);
+            found = bsearch(&key, next->keys, next->count,
+                    sizeof(*next->keys), compare_keys);
+            /* Value for opponent turns into opposite value for player */
+            if (TB_WIN - next->values[found - next->keys] > best) {
+                best = TB_WIN - next->values[found - next->keys];
+            }
+        }
+        layer->values[i] = best;
+    }
+    return 1;
+}
+
+
+/* Function: write_table                                                      */
+/*   Writes solved positions to tablebase file.                               */
+/* Parameter(s):                                                              */
+/*   filename - name of tablebase file                                        */
+/*   layers   - solved layers of positions                                    */
+/*   count    - number of layers                                              */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise.                                            */
+static int write_table(const char* filename, const tb_layer* layers,
+        unsigned int count) {
+    tb_header head;
+    unsigned int* dir;
+    unsigned int* table;
+    unsigned long long total = 0, scrambled;
+    unsigned int n, buckets, bucket, shift, bits = key_bits();
+    size_t i;
+    FILE* file;
+    int ok;
+
+    for (n = 0; n < count; ++n) {
+        total += layers[n].count;
+    }
+    if (total >= 0xffffffffULL) {
+        return 0;
+    }
+    memcpy(head.magic, TB_MAGIC, sizeof(head.magic));
+    head.cols = get_cols();
+    head.rows = get_rows();
+    head.count = (unsigned int)total;
+    for (head.bucket_bits = 0; head.bucket_bits < bits &&
+            (bits - head.bucket_bits > REMAINDER_BITS ||
+            (1ULL << head.bucket_bits) * BUCKET_LOAD < total);
+            ++head.bucket_bits) {
+    }
+    buckets = 1U << head.bucket_bits;
+    shift = bits - head.bucket_bits;
+
+    dir = calloc(buckets + 1, sizeof(*dir));
+    table = malloc((total + 1) * sizeof(*table));
+    if (dir == NULL || table == NULL) {
+        free(dir);
+        free(table);
+        return 0;
+    }
+    /* Counting sort of positions by buckets */
+    for (n = 0; n < count; ++n) {
+        for (i = 0; i < layers[n].count; ++i) {
+            ++dir[(mix(layers[n].keys[i]) >> shift) + 1];
+        }
+    }
+    for (bucket = 0; bucket < buckets; ++bucket) {
+        dir[bucket + 1] += dir[bucket];
+    }
+    for (n = 0; n < count; ++n) {
+        for (i = 0; i < layers[n].count; ++i) {
+            scrambled = mix(layers[n].keys[i]);
+            bucket = (unsigned int)(scrambled >> shift);
+            /* Directory temporarily points to free entry of bucket */
+            table[dir[bucket]++] = (unsigned int)
+                    ((scrambled & ((1ULL << shift) - 1)) << 2) |
+                    layers[n].values[i];
+        }
+    }
+    /* Restore beginnings of buckets */
+    for (bucket = buckets; bucket > 0; --bucket) {
+        dir[bucket] = dir[bucket - 1];
+    }
+    dir[0] = 0;
+
+    file = fopen(filename, "wb");
+    ok = (file != NULL &&
+            fwrite(&head, sizeof(head), 1, file) == 1 &&
+            fwrite(dir, sizeof(*dir), buckets + 1, file) == buckets + 1 &&
+            fwrite(table, sizeof(*table), total, file) == total);
+    if (file != NULL && fclose(file) != 0) {
+        ok = 0;
+    }
+    free(dir);
+    free(table);
+    return ok;
+}
+
+
+/* Function: tb_generate                                                      */
+/*   Enumerates all legal positions of board of current dimensions layer by   */
+/*   layer (by number of disks), then computes their exact values backwards   */
+/*   from full board and writes tablebase file. Position and its mirror      */
+/*   image are stored once. Board must fit in 64-bit bitboard.                */
+/* Parameter(s):                                                              */
+/*   filename - name of tablebase file                                        */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise.                                            */
+int tb_generate(const char* filename) {
+    unsigned int size = get_size(), n, h = get_rows() + 1;
+    unsigned long long board = 0, bottom = 0;
+    tb_layer* layers;
+    int ok = 1;
+
+    if (!playout_supported()) {
+        return 0;
+    }
+    for (n = 0; n < get_cols(); ++n) {
+        bottom |= 1ULL << (n * h);
+        board |= ((1ULL << get_rows()) - 1) << (n * h);
+    }
+    layers = calloc(size + 1, sizeof(*layers));
+    if (layers == NULL) {
+        return 0;
+    }
+    layers[0].keys = malloc(sizeof(*layers[0].keys));
+    if (layers[0].keys == NULL) {
+        free(layers);
+        return 0;
+    }
+    layers[0].keys[0] = 0;  /* Empty board */
+    layers[0].count = 1;
+
+    for (n = 0; ok && n < size; ++n) {
+        ok = expand(&layers[n], &layers[n + 1], board, bottom);
+        printf("Disks %2u: %lu positions\n", n + 1,
+                (unsigned long)layers[n + 1].count);
+    }
+    for (n = size + 1; ok && n-- > 0; ) {
+        ok = solve(&layers[n], (n < size ? &layers[n + 1] : NULL),
+                board, bottom);
+    }
+    if (ok) {
+        printf("Value of empty board: %s\n",
+                (layers[0].values[0] == TB_WIN ? "first player wins" :
+                layers[0].values[0] == TB_DRAW ? "draw" :
+                "second player wins"));
+        ok = write_table(filename, layers, size + 1);
+    }
+
+    for (n = 0; n <= size; ++n) {
+        free(layers[n].keys);
+        free(layers[n].values);
+    }
+    free(layers);
+    return ok;
+}
+
+
+/* Function: tb_open                                                          */
+/*   Opens tablebase file and maps it to memory (read only, so it is shared   */
+/*   by all processes and probed without locks).                              */
+/* Parameter(s):                                                              */
+/*   filename - name of tablebase file                                        */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if there is no valid tablebase of current board.      */
+int tb_open(const char* filename) {
+    struct stat st;
+    void* map;
+    int fd;
+
+    tb_close();
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(tb_header)) {
+        close(fd);
+        return 0;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+    header = map;
+    mapped = st.st_size;
+    directory = (const unsigned int*)(header + 1);
+    /* Check that file is tablebase of current board of consistent size */
+    if (memcmp(header->magic, TB_MAGIC, sizeof(header->magic)) != 0 ||
+            header->cols != get_cols() || header->rows != get_rows() ||
+            !playout_supported() || header->bucket_bits > key_bits() ||
+            header->bucket_bits >= 32 ||
+            key_bits() - header->bucket_bits > REMAINDER_BITS ||
+            mapped != sizeof(*header) + ((size_t)(1U << header->bucket_bits)
+                + 1 + header->count) * sizeof(*directory)) {
+        tb_close();
+        return 0;
+    }
+    entries = directory + (1U << header->bucket_bits) + 1;
+    return 1;
+}
+
+
+/* Function: tb_close                                                         */
+/*   Unmaps tablebase file.                                                   */
+void tb_close(void) {
+    if (header != NULL) {
+        munmap(header, mapped);
+    }
+    header = NULL;
+    directory = NULL;
+    entries = NULL;
+    return;
+}
+
+
+/* Function: tb_probe                                                         */
+/*   Looks up exact value of position in tablebase. Only positions where the  */
+/*   game isn't over are stored.                                              */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   TB_WIN, TB_DRAW or TB_LOSS for player to move, or TB_NONE if there is no */
+/*   tablebase of current board or position isn't stored.                     */
+int tb_probe(conn4_state* board) {
+    unsigned long long own, all, scrambled, remainder;
+    unsigned int shift, i, last;
+
+    if (header == NULL || header->cols != get_cols() ||
+            header->rows != get_rows()) {
+        return TB_NONE;
+    }
+    board_to_bits(board, &own, &all);
+    scrambled = mix(canonical(own, all));
+    shift = key_bits() - header->bucket_bits;
+    remainder = scrambled & ((1ULL << shift) - 1);
+    last = directory[(scrambled >> shift) + 1];
+    for (i = directory[scrambled >> shift]; i < last; ++i) {
+        if ((entries[i] >> 2) == remainder) {
+            return (int)(entries[i] & 3);
+        }
+    }
+    return TB_NONE;
+}
+
+
+#endif /* _TABLEBASE_C_ */
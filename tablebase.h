@@ -0,0 +1,30 @@
+#ifndef _TABLEBASE_H_
+#define _TABLEBASE_H_
+
+#include "conn4.h"
+
+
+/* Name of tablebase file of board of selected dimensions (columns, rows)    */
+#define TB_FILENAME     "tb%ux%u.bin"
+
+/* Values of positions for player to move                                     */
+#define TB_NONE     (-1)    /* Position isn't in tablebase */
+#define TB_LOSS     0
+#define TB_DRAW     1
+#define TB_WIN      2
+
+
+/* Generates tablebase of board of current dimensions and writes it to file.  */
+int tb_generate(const char* filename);
+
+/* Opens tablebase file of board of current dimensions.                       */
+int tb_open(const char* filename);
+
+/* Closes tablebase file.                                                     */
+void tb_close(void);
+
+/* Looks up exact value of position for player to move.                       */
+int tb_probe(conn4_state* board);
+
+
+#endif /* _TABLEBASE_H_ */
@@ -0,0 +1,36 @@
+#ifndef _TBGEN_C_
+#define _TBGEN_C_
+
+#include "conn4.h"
+#include "tablebase.h"
+#include <stdio.h>      /* printf(), fprintf(), sprintf() */
+#include <stdlib.h>     /* atoi(), EXIT_* */
+
+
+/* Function: main                                                             */
+/*   Generates tablebase of small board by retrograde analysis.               */
+/*   Usage: tbgen columns rows [file]                                         */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    char filename[64];
+
+    if (argc < 3 || atoi(argv[1]) < MIN_COLUMNS || atoi(argv[2]) < MIN_ROWS) {
+        fprintf(stderr, "Usage: %s columns rows [file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    set_dimensions(atoi(argv[1]), atoi(argv[2]));
+    sprintf(filename, TB_FILENAME, get_cols(), get_rows());
+
+    if (!tb_generate(argc > 3 ? argv[3] : filename)) {
+        fprintf(stderr, "Error: can't generate tablebase (board must fit in "
+                "64 bits and all positions in memory).\n");
+        return EXIT_FAILURE;
+    }
+    printf("Tablebase written to %s\n", argc > 3 ? argv[3] : filename);
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _TBGEN_C_ */
@@ -0,0 +1,223 @@
+#ifndef _THREATS_C_
+#define _THREATS_C_
+
+#include "threats.h"
+#include "kernels.h"
+#include <stdlib.h>     /* malloc(), free() */
+
+
+/* Number of directions of alignments: horizontal, vertical, two diagonals   */
+#define DIRECTIONS  4
+
+/* Steps along columns and rows for each direction of alignment               */
+static const int DCOL[DIRECTIONS] = { 1, 0, 1,  1 };
+static const int DROW[DIRECTIONS] = { 0, 1, 1, -1 };
+
+
+/* Function: count_run                                                        */
+/*   Counts disks of selected type that go in a row from selected cell        */
+/*   (exclusively) in selected direction.                                     */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column index of starting cell                                   */
+/*   row    - row index of starting cell                                      */
+/*   dcol   - step along columns                                              */
+/*   drow   - step along rows                                                 */
+/*   disk   - type of disk                                                    */
+/* Returns:                                                                   */
+/*   Number of consecutive disks of selected type.                            */
+static int count_run(conn4_state* board, int column, int row, int dcol,
+        int drow, char disk) {
+    int count = 0;
+
+    for (column += dcol, row += drow;
+            column >= 0 && column < (int)get_cols() &&
+            row >= 0 && row < (int)get_rows();
+            column += dcol, row += drow) {
+        if (get_cell(board, column, row) != disk) {
+            break;
+        }
+        ++count;
+    }
+
+    return count;
+}
+
+
+/* Function: is_threat                                                        */
+/*   Checks if disk put at selected empty cell would complete winning         */
+/*   alignment. Board isn't modified.                                         */
+/* Parameter(s):                                                              */
+/*   board  - board structure                                                 */
+/*   column - column index (zero-based, starts from left side)                */
+/*   row    - row index (zero-based, starts from bottom side)                 */
+/*   disk   - player's disk type                                              */
+/* Returns:                                                                   */
+/*   1 if cell completes winning alignment, 0 otherwise.                      */
+int is_threat(conn4_state* board, unsigned int column, unsigned int row,
+        char disk) {
+    int d;
+
+    for (d = 0; d < DIRECTIONS; ++d) {
+        if (1 + count_run(board, column, row, DCOL[d], DROW[d], disk)
+                + count_run(board, column, row, -DCOL[d], -DROW[d], disk)
+                >= COUNT_TO_WIN) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* Function: count_threats                                                    */
+/*   Counts empty cells that would complete winning alignment of selected     */
+/*   player. Threats are classified by parity of row (rows are counted from   */
+/*   bottom starting with 1) and by whether they can be played immediately.  */
+/*   Counting is done by kernel selected for this processor. Grid is kept on  */
+/*   stack if board fits in GRID_MAX_BYTES, on heap otherwise; if it can't be */
+/*   allocated, cells are checked one by one.                                 */
+/* Parameter(s):                                                              */
+/*   board   - board structure                                                */
+/*   disk    - player's disk type                                             */
+/*   threats - where counts of threats will be written                        */
+void count_threats(conn4_state* board, char disk, threat_count* threats) {
+    unsigned char local[GRID_MAX_BYTES + MAX_COLUMNS];
+    unsigned char* grid = local;
+    unsigned char* heights;
+    unsigned int counts[3];
+    unsigned int column, row;
+
+    if (!GRID_FITS()) {
+        grid = malloc(GRID_BYTES(get_cols(), get_rows()) + get_cols());
+    }
+    if (grid == NULL) {
+        threats->odd = threats->even = threats->playable = 0;
+        for (column = 0; column < get_cols(); ++column) {
+            for (row = get_height(board, column); row < get_rows(); ++row) {
+                if (is_threat(board, column, row, disk)) {
+                    /* Zero-based even row is odd when counted from 1 */
+                    if (row % 2 == 0) {
+                        ++(threats->odd);
+                    } else {
+                        ++(threats->even);
+                    }
+                    if (row == get_height(board, column)) {
+                        ++(threats->playable);
+                    }
+                }
+            }
+        }
+        return;
+    }
+    heights = grid + GRID_BYTES(get_cols(), get_rows());
+    board_to_grid(board, disk, grid, heights);
+    kernels.count_threats(grid, heights, get_cols(), get_rows(), counts);
+    threats->odd = counts[0];
+    threats->even = counts[1];
+    threats->playable = counts[2];
+    if (grid != local) {
+        free(grid);
+    }
+    return;
+}
+
+
+/* Function: prove_position                                                   */
+/*   Tries to prove result of game by static analysis of all groups of four   */
+/*   cells (possible winning alignments). Two rules are applied, both exact:  */
+/*   1. If no group can be completed by any player, game is a draw.           */
+/*   2. If every column has even number of empty cells, player who made last  */
+/*      move can always reply on top of opponent's disk in the same column    */
+/*      ("claimeven"). Then opponent gets only cells on rows of the same      */
+/*      parity as number of rows, and player gets all other empty cells. If   */
+/*      no group of opponent can be completed with opponent's cells, opponent */
+/*      can't win: player then wins if some group of player can be completed */
+/*      with player's cells, and the game is a draw if player has no groups   */
+/*      at all.                                                               */
+/*   It is assumed that nobody has won yet.                                   */
+/* Parameter(s):                                                              */
+/*   board - board structure                                                  */
+/* Returns:                                                                   */
+/*   PROVEN_WIN if player who made last move wins, PROVEN_DRAW if the game is */
+/*   a draw, PROVEN_NONE if nothing can be proven.                            */
+int prove_position(conn4_state* board) {
+    int column, row, d, k;
+    int c, r;
+    int claimeven = 1;      /* Flag: claimeven is applicable */
+    int live[2] = {0, 0};   /* Flags: player/opponent has a live group */
+    int opp_can = 0;        /* Flag: opponent completes a group by claimeven */
+    int plr_wins = 0;       /* Flag: player completes a group by claimeven */
+    int own, other;         /* Counts of disks of player/opponent in group */
+    int opp_cells, plr_cells;   /* Counts of empty cells of each parity */
+    int parity = get_rows() % 2;/* Parity of rows that opponent gets */
+    char cell;
+    /* Player who made last move and opponent who makes next move */
+    char player = (board->moves % 2 != 0 ? CELL_X : CELL_O);
+
+    for (column = 0; column < get_cols(); ++column) {
+        if ((get_rows() - get_height(board, column)) % 2 != 0) {
+            claimeven = 0;
+            break;
+        }
+    }
+    /* Groups can die out only late in the game, so without claimeven there  */
+    /* is no reason to scan the board early.                                 */
+    if (!claimeven && board->moves < get_size() / 2) {
+        return PROVEN_NONE;
+    }
+
+    for (column = 0; column < get_cols(); ++column) {
+        for (row = 0; row < get_rows(); ++row) {
+            for (d = 0; d < DIRECTIONS; ++d) {
+                c = column + (COUNT_TO_WIN - 1) * DCOL[d];
+                r = row + (COUNT_TO_WIN - 1) * DROW[d];
+                if (c >= get_cols() || r < 0 || r >= get_rows()) {
+                    continue;   /* Group doesn't fit on the board */
+                }
+                own = other = opp_cells = plr_cells = 0;
+                for (k = 0, c = column, r = row; k < COUNT_TO_WIN;
+                        ++k, c += DCOL[d], r += DROW[d]) {
+                    cell = get_cell(board, c, r);
+                    if (cell == player) {
+                        ++own;
+                    } else if (cell != CELL_EMPTY) {
+                        ++other;
+                    } else if (r % 2 == parity) {
+                        ++opp_cells;
+                    } else {
+                        ++plr_cells;
+                    }
+                }
+                if (own == COUNT_TO_WIN || other == COUNT_TO_WIN) {
+                    return PROVEN_NONE; /* Game is already over */
+                }
+                if (other == 0) {
+                    live[0] = 1;
+                    plr_wins |= (opp_cells == 0);
+                }
+                if (own == 0) {
+                    live[1] = 1;
+                    opp_can |= (plr_cells == 0);
+                }
+            }
+        }
+    }
+
+    if (!live[0] && !live[1]) {
+        return PROVEN_DRAW;     /* Nobody can complete any group */
+    }
+    if (claimeven && !opp_can) {
+        if (plr_wins) {
+            return PROVEN_WIN;
+        }
+        if (!live[0]) {
+            return PROVEN_DRAW;
+        }
+    }
+
+    return PROVEN_NONE;
+}
+
+
+#endif /* _THREATS_C_ */
@@ -0,0 +1,31 @@
+#ifndef _THREATS_H_
+#define _THREATS_H_
+
+#include "conn4.h"
+
+
+/* Results of static proof of a position                                      */
+#define PROVEN_NONE 0   /* Nothing is proven, search is necessary */
+#define PROVEN_WIN  1   /* Player who made last move wins */
+#define PROVEN_DRAW 2   /* Game ends as a draw with best play */
+
+/* Threats of one player classified by parity of row and playability.        */
+/* Rows are counted from bottom starting with 1, so the lowest row is odd.    */
+typedef struct {
+    unsigned int odd;       /* Threats on odd rows */
+    unsigned int even;      /* Threats on even rows */
+    unsigned int playable;  /* Threats that can be played immediately */
+} threat_count;
+
+/* Checks if disk put at selected empty cell completes winning alignment.    */
+int is_threat(conn4_state* board, unsigned int column, unsigned int row,
+        char disk);
+
+/* Counts threats of selected player classified by row parity.               */
+void count_threats(conn4_state* board, char disk, threat_count* threats);
+
+/* Tries to prove result of game without search.                             */
+int prove_position(conn4_state* board);
+
+
+#endif /* _THREATS_H_ */
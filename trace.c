@@ -0,0 +1,120 @@
+#ifndef _TRACE_C_
+#define _TRACE_C_
+
+#include "trace.h"
+#include "conn4.h"      /* THREAD_LOCAL */
+#include <stdio.h>      /* fopen(), fprintf(), fclose() */
+#include <stdlib.h>     /* getenv() */
+#include <time.h>       /* clock_gettime() */
+
+
+/* Event of span                                                              */
+typedef struct {
+    const char* name;       /* Name of span */
+    const char* arg;        /* Name of argument, or NULL if there is none */
+    long value;             /* Value of argument */
+    long long time;         /* Monotonic time in nanoseconds */
+    unsigned int thread;    /* Number of thread (starting from 1) */
+    char phase;             /* 'B' (begin) or 'E' (end) */
+} trace_record;
+
+
+/* Buffer of events. Slots are taken by atomic increment of counter, so      */
+/* threads record events without locks.                                       */
+static trace_record events[TRACE_EVENTS];
+static unsigned int recorded = 0;
+/* Number of threads that recorded events                                     */
+static unsigned int threads = 0;
+/* Number of thread in trace, 0 until thread records the first event         */
+static THREAD_LOCAL unsigned int thread_id = 0;
+
+
+/* Function: trace_event                                                      */
+/*   Records event of span in calling thread. Event is dropped if buffer is   */
+/*   full.                                                                    */
+/* Parameter(s):                                                              */
+/*   name  - name of span (string literal)                                    */
+/*   phase - 'B' if span begins, 'E' if it ends                               */
+/*   arg   - name of argument (string literal), or NULL if there is none     */
+/*   value - value of argument                                                */
+void trace_event(const char* name, char phase, const char* arg, long value) {
+    struct timespec ts;
+    trace_record* event;
+    unsigned int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    i = __atomic_fetch_add(&recorded, 1, __ATOMIC_RELAXED);
+    if (i >= TRACE_EVENTS) {
+        return;
+    }
+    if (thread_id == 0) {
+        thread_id = __atomic_add_fetch(&threads, 1, __ATOMIC_RELAXED);
+    }
+    event = &events[i];
+    event->name = name;
+    event->arg = arg;
+    event->value = value;
+    event->time = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    event->thread = thread_id;
+    event->phase = phase;
+    return;
+}
+
+
+/* Function: trace_save                                                       */
+/*   Writes recorded events as JSON object of Chrome trace format. Times are  */
+/*   given in microseconds since the first event. Call this function when no  */
+/*   other threads record events.                                             */
+/* Parameter(s):                                                              */
+/*   filename - file of trace, or NULL for file named by environment         */
+/*              variable TRACE_ENV (TRACE_FILENAME if it is not set)          */
+/* Returns:                                                                   */
+/*   1 if trace is written, 0 otherwise.                                      */
+int trace_save(const char* filename) {
+    unsigned int i, count = recorded;
+    long long start;
+    FILE* file;
+
+    if (filename == NULL) {
+        filename = getenv(TRACE_ENV);
+    }
+    if (filename == NULL || *filename == '\0') {
+        filename = TRACE_FILENAME;
+    }
+    file = fopen(filename, "w");
+    if (file == NULL) {
+        return 0;
+    }
+    if (count > TRACE_EVENTS) {
+        fprintf(stderr, "Warning: %u trace events are dropped.\n",
+                count - TRACE_EVENTS);
+        count = TRACE_EVENTS;
+    }
+
+    start = (count > 0 ? events[0].time : 0);
+    for (i = 1; i < count; ++i) {
+        if (events[i].time < start) {
+            start = events[i].time;
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":1,\"args\":{\"name\":\"conn4\"}}");
+    for (i = 0; i < count; ++i) {
+        fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+                "\"pid\":1,\"tid\":%u", events[i].name, events[i].phase,
+                (events[i].time - start) * 1e-3, events[i].thread);
+        if (events[i].arg != NULL) {
+            fprintf(file, ",\"args\":{\"%s\":%ld}", events[i].arg,
+                    events[i].value);
+        }
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+}
+
+
+#endif /* _TRACE_C_ */
@@ -0,0 +1,38 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+
+/* Default file of trace (Chrome trace format, opens in Perfetto UI too)     */
+#define TRACE_FILENAME  "trace.json"
+/* Environment variable that overrides file of trace                          */
+#define TRACE_ENV       "CONN4_TRACE_FILE"
+/* Capacity of buffer of events; events beyond it are dropped                 */
+#define TRACE_EVENTS    (1U << 16)
+
+
+/* Macros: Spans are recorded only if program is built with CONN4_TRACE      */
+/* defined ("make TRACE=-DCONN4_TRACE"), otherwise they cost nothing.        */
+/* Span is opened by TRACE_BEGIN (optionally with one integer argument) and  */
+/* closed by TRACE_END of the same name in the same thread.                   */
+#ifdef CONN4_TRACE
+#define TRACE_BEGIN(name)               trace_event((name), 'B', NULL, 0)
+#define TRACE_BEGIN_ARG(name, arg, val) trace_event((name), 'B', (arg), (val))
+#define TRACE_END(name)                 trace_event((name), 'E', NULL, 0)
+#define TRACE_SAVE()                    trace_save(NULL)
+#else
+#define TRACE_BEGIN(name)               ((void)0)
+#define TRACE_BEGIN_ARG(name, arg, val) ((void)0)
+#define TRACE_END(name)                 ((void)0)
+#define TRACE_SAVE()                    ((void)0)
+#endif
+
+
+/* Records event of span (phase 'B' or 'E') in calling thread. Name and name */
+/* of argument must be string literals.                                       */
+void trace_event(const char* name, char phase, const char* arg, long value);
+
+/* Writes recorded events to file (TRACE_ENV or TRACE_FILENAME if NULL).     */
+int trace_save(const char* filename);
+
+
+#endif /* _TRACE_H_ */
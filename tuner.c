@@ -0,0 +1,452 @@
+#ifndef _TUNER_C_
+#define _TUNER_C_
+
+#include "conn4.h"
+#include "kernels.h"
+#include "dataset.h"
+#include "nnue.h"
+#include <stdio.h>      /* printf(), fprintf(), fread(), fclose() */
+#include <stdlib.h>     /* malloc(), calloc(), free(), atoi(), atof(), EXIT_* */
+#include <string.h>     /* memcpy(), memset() */
+#include <math.h>       /* sqrtf(), powf() */
+#include <time.h>       /* clock_gettime() */
+#include <unistd.h>     /* sysconf() */
+#include <pthread.h>    /* pthread_create(), pthread_join(), pthread_barrier */
+
+
+/* Maximal number of threads                                                  */
+#define MAX_THREADS     64
+/* Default number of passes over dataset                                      */
+#define DEFAULT_EPOCHS  20
+/* Default weight of result of game in target (the rest is score of search)  */
+#define DEFAULT_LAMBDA  0.5f
+/* Number of positions per step of gradient descent                           */
+#define BATCH           16384
+/* One of VALIDATION positions is held out to measure error                  */
+#define VALIDATION      16
+/* Parameters of Adam optimizer                                               */
+#define LEARNING_RATE   0.01f
+#define BETA1           0.9f
+#define BETA2           0.999f
+#define EPSILON         1e-8f
+
+/* Layout of flat vector of weights: hidden bias, weights of features,       */
+/* output weights (per player to move) and output bias (see nnue_params)    */
+#define W_BIAS          0
+#define W_FEATURES      NNUE_HIDDEN
+#define W_OUTPUT        (W_FEATURES + features)
+#define W_OUT_BIAS      (W_OUTPUT + 2 * NNUE_HIDDEN)
+
+
+/* State of tuning thread                                                     */
+typedef struct {
+    pthread_t thread;
+    unsigned int id;        /* Number of thread */
+    float* grad;            /* Gradient of loss over slice of batch */
+    double loss;            /* Sum of squared errors over slice */
+} tuner_worker;
+
+
+/* Dataset: training records first, then held out ones                        */
+static unsigned char* records = NULL;
+static unsigned long long train = 0, valid = 0;
+static unsigned int bytes = 0;
+
+/* Weights with moments of Adam optimizer                                     */
+static float* weights = NULL;
+static float* moment1 = NULL;
+static float* moment2 = NULL;
+static unsigned int features = 0;   /* Number of weights of features */
+static unsigned int count = 0;      /* Number of all weights */
+
+static unsigned int threads = 1;
+static unsigned int epochs = DEFAULT_EPOCHS;
+static float lambda = DEFAULT_LAMBDA;
+static tuner_worker workers[MAX_THREADS];
+static pthread_barrier_t barrier;
+
+
+/* Function: seconds                                                          */
+/* Returns:                                                                   */
+/*   Current value of monotonic clock in seconds.                             */
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* Function: next_random                                                      */
+/*   Generates next pseudorandom number (splitmix64).                         */
+/* Parameter(s):                                                              */
+/*   rng - state of generator                                                 */
+/* Returns:                                                                   */
+/*   Pseudorandom 64-bit number.                                              */
+static unsigned long long next_random(unsigned long long* rng) {
+    unsigned long long z = (*rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+/* Function: load_records                                                     */
+/*   Reads dataset into memory and shuffles it. The last 1/VALIDATION of     */
+/*   records is held out and doesn't take part in training.                   */
+/* Parameter(s):                                                              */
+/*   filename - name of dataset file                                          */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise.                                            */
+static int load_records(const char* filename) {
+    dataset_header header;
+    unsigned long long i, j, total, rng = 1;
+    unsigned char* tmp;
+    FILE* file = dataset_open(filename, &header);
+
+    if (file == NULL) {
+        return 0;
+    }
+    bytes = header.record_bytes;
+    total = header.count;
+    records = malloc((size_t)total * bytes);
+    tmp = malloc(bytes);
+    if (records == NULL || tmp == NULL ||
+            fread(records, bytes, total, file) != total) {
+        fclose(file);
+        free(tmp);
+        return 0;
+    }
+    fclose(file);
+
+    /* Fisher-Yates shuffle; records of one game come together in file */
+    for (i = total; i > 1; --i) {
+        j = next_random(&rng) % i;
+        memcpy(tmp, records + (i - 1) * bytes, bytes);
+        memcpy(records + (i - 1) * bytes, records + j * bytes, bytes);
+        memcpy(records + j * bytes, tmp, bytes);
+    }
+    free(tmp);
+    valid = total / VALIDATION;
+    train = total - valid;
+    return (train > 0);
+}
+
+
+/* Function: init_weights                                                     */
+/*   Takes weights from weights file (to continue tuning) or initializes them */
+/*   randomly: hidden neurons start in the middle of their linear range.      */
+/* Parameter(s):                                                              */
+/*   filename - name of weights file                                          */
+/* Returns:                                                                   */
+/*   1 if successful, 0 if memory allocation failed.                          */
+static int init_weights(const char* filename) {
+    nnue_params params;
+    unsigned long long rng = 12345;
+    unsigned int i;
+
+    features = 2 * get_size() * NNUE_HIDDEN;
+    count = W_OUT_BIAS + 2;
+    weights = malloc(count * sizeof(*weights));
+    moment1 = calloc(count, sizeof(*moment1));
+    moment2 = calloc(count, sizeof(*moment2));
+    if (weights == NULL || moment1 == NULL || moment2 == NULL) {
+        return 0;
+    }
+    if (nnue_read(filename, &params)) {
+        printf("Continuing from weights %s.\n", filename);
+        memcpy(weights + W_BIAS, params.bias, sizeof(params.bias));
+        memcpy(weights + W_FEATURES, params.features,
+                features * sizeof(float));
+        memcpy(weights + W_OUTPUT, params.output, sizeof(params.output));
+        memcpy(weights + W_OUT_BIAS, params.out_bias,
+                sizeof(params.out_bias));
+        nnue_free(&params);
+        return 1;
+    }
+    for (i = 0; i < count; ++i) {
+        /* Uniform in -0.1...+0.1 */
+        weights[i] = (next_random(&rng) >> 40) / (float)(1 << 24) * 0.2f -
+                0.1f;
+    }
+    for (i = 0; i < NNUE_HIDDEN; ++i) {
+        weights[W_BIAS + i] = 0.5f;
+    }
+    weights[W_OUT_BIAS] = weights[W_OUT_BIAS + 1] = 0.0f;
+    return 1;
+}
+
+
+/* Function: save_weights                                                     */
+/*   Writes weights to weights file that engine loads (see nnue_open()).     */
+/* Parameter(s):                                                              */
+/*   filename - name of weights file                                          */
+/* Returns:                                                                   */
+/*   1 if successful, 0 otherwise.                                            */
+static int save_weights(const char* filename) {
+    nnue_params params;
+
+    params.features = weights + W_FEATURES;
+    memcpy(params.bias, weights + W_BIAS, sizeof(params.bias));
+    memcpy(params.output, weights + W_OUTPUT, sizeof(params.output));
+    memcpy(params.out_bias, weights + W_OUT_BIAS, sizeof(params.out_bias));
+    return nnue_write(filename, &params);
+}
+
+
+/* Function: process                                                          */
+/*   Evaluates records by network and accumulates squared error and (if      */
+/*   gradient is given) its gradient by weights.                              */
+/* Parameter(s):                                                              */
+/*   board - board used for decoding of records                               */
+/*   first - index of the first record                                        */
+/*   last  - index after the last record                                      */
+/*   grad  - gradient to add to, or NULL to measure error only                */
+/* Returns:                                                                   */
+/*   Sum of squared errors.                                                   */
+static double process(conn4_state* board, unsigned long long first,
+        unsigned long long last, float* grad) {
+    unsigned int active[2 * MAX_COLUMNS * MAX_ROWS];
+    float z[NNUE_HIDDEN], a[NNUE_HIDDEN];
+    unsigned int i, h, n, c, r, height, side;
+    unsigned long long k;
+    const unsigned char* rec;
+    const float *w, *out;
+    float v, p, y, g, *gw;
+    dataset_label label;
+    double loss = 0.0;
+
+    for (k = first; k < last; ++k) {
+        rec = records + k * bytes;
+        board_unpack(board, rec);
+        memcpy(&label, rec + packed_bytes(), sizeof(label));
+        side = board->moves % 2;
+
+        /* Hidden layer: bias and weights of features of all disks */
+        n = 0;
+        for (c = 0; c < get_cols(); ++c) {
+            height = get_height(board, c);
+            for (r = 0; r < height; ++r) {
+                active[n++] = 2 * (c * get_rows() + r) +
+                        (get_cell(board, c, r) == CELL_O);
+            }
+        }
+        memcpy(z, weights + W_BIAS, sizeof(z));
+        for (i = 0; i < n; ++i) {
+            w = weights + W_FEATURES + active[i] * NNUE_HIDDEN;
+            for (h = 0; h < NNUE_HIDDEN; ++h) {
+                z[h] += w[h];
+            }
+        }
+
+        /* Output layer of player to move */
+        out = weights + W_OUTPUT + side * NNUE_HIDDEN;
+        v = weights[W_OUT_BIAS + side];
+        for (h = 0; h < NNUE_HIDDEN; ++h) {
+            a[h] = (z[h] < 0.0f ? 0.0f : z[h] > 1.0f ? 1.0f : z[h]);
+            v += a[h] * out[h];
+        }
+        p = NNUE_SQUASH(v);
+        y = lambda * label.result +
+                (1.0f - lambda) * label.score / DATASET_SCALE;
+        loss += (p - y) * (p - y);
+        if (grad == NULL) {
+            continue;
+        }
+
+        /* Back propagation: d(squash(v))/dv = 1 / (1 + |v|)^2 */
+        g = 1.0f + (v < 0.0f ? -v : v);
+        g = 2.0f * (p - y) / (g * g);
+        grad[W_OUT_BIAS + side] += g;
+        for (h = 0; h < NNUE_HIDDEN; ++h) {
+            grad[W_OUTPUT + side * NNUE_HIDDEN + h] += g * a[h];
+            /* Clipped neurons pass no gradient */
+            z[h] = (z[h] > 0.0f && z[h] < 1.0f ? g * out[h] : 0.0f);
+            grad[W_BIAS + h] += z[h];
+        }
+        for (i = 0; i < n; ++i) {
+            gw = grad + W_FEATURES + active[i] * NNUE_HIDDEN;
+            for (h = 0; h < NNUE_HIDDEN; ++h) {
+                gw[h] += z[h];
+            }
+        }
+    }
+
+    return loss;
+}
+
+
+/* Function: apply_gradient                                                   */
+/*   Sums gradients of all threads and makes step of Adam optimizer.          */
+/* Parameter(s):                                                              */
+/*   size - number of records of batch                                        */
+/*   step - number of step (starting from 1)                                  */
+static void apply_gradient(unsigned long long size, unsigned long long step) {
+    unsigned int i, t;
+    float g, m, v;
+    /* Bias correction of moments */
+    float c1 = 1.0f - powf(BETA1, step), c2 = 1.0f - powf(BETA2, step);
+
+    for (i = 0; i < count; ++i) {
+        g = 0.0f;
+        for (t = 0; t < threads; ++t) {
+            g += workers[t].grad[i];
+        }
+        g /= size;
+        m = moment1[i] = BETA1 * moment1[i] + (1.0f - BETA1) * g;
+        v = moment2[i] = BETA2 * moment2[i] + (1.0f - BETA2) * g * g;
+        weights[i] -= LEARNING_RATE * (m / c1) / (sqrtf(v / c2) + EPSILON);
+    }
+    return;
+}
+
+
+/* Function: slice                                                            */
+/*   Splits range of records between threads.                                 */
+/* Parameter(s):                                                              */
+/*   id    - number of thread                                                 */
+/*   begin - the first record of range                                        */
+/*   end   - record after the last one                                        */
+/*   first - where the first record of thread will be written                 */
+/*   last  - where record after the last one of thread will be written        */
+static void slice(unsigned int id, unsigned long long begin,
+        unsigned long long end, unsigned long long* first,
+        unsigned long long* last) {
+    *first = begin + (end - begin) * id / threads;
+    *last = begin + (end - begin) * (id + 1) / threads;
+    return;
+}
+
+
+/* Function: tune                                                             */
+/*   Thread function. Every step, all threads compute gradient over their    */
+/*   slices of batch, then thread 0 applies it; after every epoch error is   */
+/*   measured on held out records in the same way.                            */
+/* Parameter(s):                                                              */
+/*   arg - worker structure                                                   */
+static void* tune(void* arg) {
+    tuner_worker* self = arg;
+    conn4_state* board = create_board();
+    unsigned long long begin, first, last, step = 0;
+    unsigned int epoch, t;
+    double start = seconds(), train_loss, valid_loss;
+
+    for (epoch = 1; epoch <= epochs; ++epoch) {
+        train_loss = 0.0;
+        for (begin = 0; begin < train; begin += BATCH) {
+            memset(self->grad, 0, count * sizeof(float));
+            slice(self->id, begin, (begin + BATCH < train ? begin + BATCH :
+                    train), &first, &last);
+            self->loss = process(board, first, last, self->grad);
+            pthread_barrier_wait(&barrier);
+            if (self->id == 0) {
+                for (t = 0; t < threads; ++t) {
+                    train_loss += workers[t].loss;
+                }
+                apply_gradient((begin + BATCH < train ? BATCH : train - begin),
+                        ++step);
+            }
+            pthread_barrier_wait(&barrier);
+        }
+
+        slice(self->id, train, train + valid, &first, &last);
+        self->loss = process(board, first, last, NULL);
+        pthread_barrier_wait(&barrier);
+        if (self->id == 0) {
+            valid_loss = 0.0;
+            for (t = 0; t < threads; ++t) {
+                valid_loss += workers[t].loss;
+            }
+            printf("Epoch %u: error %.5f, held out %.5f (%.1f s)\n", epoch,
+                    train_loss / train, (valid > 0 ? valid_loss / valid : 0.0),
+                    seconds() - start);
+            fflush(stdout);
+        }
+        pthread_barrier_wait(&barrier);
+    }
+
+    destruct_board(board);
+    return NULL;
+}
+
+
+/* Function: main                                                             */
+/*   Fits weights of evaluation network to dataset of self-play positions    */
+/*   (see selfplay) and writes weights file that engine loads at start up.    */
+/*   Target of position is lambda * result + (1 - lambda) * score of search.  */
+/*   Usage: tuner dataset weights [epochs] [threads] [lambda]                 */
+/*   Existing weights file is tuned further. All processors are used by       */
+/*   default.                                                                 */
+/* Parameter(s):                                                              */
+/*   argc - number of command line arguments                                  */
+/*   argv - command line arguments                                            */
+int main(int argc, char* argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int t;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s dataset weights [epochs] [threads] "
+                "[lambda]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    threads = (cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : cpus);
+    if (argc > 3) {
+        epochs = atoi(argv[3]);
+    }
+    if (argc > 4) {
+        threads = atoi(argv[4]);
+    }
+    if (argc > 5) {
+        lambda = atof(argv[5]);
+    }
+    if (threads < 1 || threads > MAX_THREADS || lambda < 0.0f ||
+            lambda > 1.0f) {
+        fprintf(stderr, "Error: invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+    init_kernels();
+
+    if (!load_records(argv[1])) {
+        fprintf(stderr, "Error: cannot read dataset %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (get_cols() > MAX_COLUMNS || get_rows() > MAX_ROWS ||
+            !init_weights(argv[2])) {
+        fprintf(stderr, "Error: cannot tune weights of %ux%u board.\n",
+                get_cols(), get_rows());
+        return EXIT_FAILURE;
+    }
+    printf("Tuning on %llu positions of %ux%u board (%llu held out), "
+            "%u threads.\n", train, get_cols(), get_rows(), valid, threads);
+
+    pthread_barrier_init(&barrier, NULL, threads);
+    for (t = 0; t < threads; ++t) {
+        workers[t].id = t;
+        workers[t].grad = malloc(count * sizeof(float));
+        if (workers[t].grad == NULL) {
+            fprintf(stderr, "Error: out of memory.\n");
+            return EXIT_FAILURE;
+        }
+    }
+    for (t = 0; t < threads; ++t) {
+        pthread_create(&workers[t].thread, NULL, tune, &workers[t]);
+    }
+    for (t = 0; t < threads; ++t) {
+        pthread_join(workers[t].thread, NULL);
+        free(workers[t].grad);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    if (!save_weights(argv[2])) {
+        fprintf(stderr, "Error: cannot write weights %s.\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    printf("Weights written to %s.\n", argv[2]);
+    free(records);
+    free(weights);
+    free(moment1);
+    free(moment2);
+    return EXIT_SUCCESS;
+}
+
+
+#endif /* _TUNER_C_ */